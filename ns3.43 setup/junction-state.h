@@ -0,0 +1,158 @@
+#ifndef JUNCTION_STATE_H
+#define JUNCTION_STATE_H
+
+// Recent sensor state per junction for the traffic light controller.
+// Junction names are interned once into dense integer IDs; each junction
+// keeps a fixed-size ring of its last `window` samples with a running sum
+// (sliding mean), a monotonic queue (sliding max) and an EWMA, all updated
+// in O(1) per sample. Controller ticks then read a smoothed vehicle count
+// and a held emergency flag by ID, without hashing strings or allocating,
+// so one noisy reading no longer flips a light's program.
+//
+// Times are plain seconds so the store has no ns-3 dependency.
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class JunctionStateStore {
+public:
+    // Which windowed value Vehicles() reports.
+    enum Statistic { kLatest, kMean, kMax, kEwma };
+
+    // `window` samples per junction (at least 1); `ewmaAlpha` weights the
+    // newest sample; an emergency reading is held for `emergencyHold`
+    // seconds after it arrives (0 follows the latest sample only).
+    explicit JunctionStateStore(uint32_t window = 4, Statistic statistic = kMean, double ewmaAlpha = 0.5,
+                                double emergencyHold = 0.0)
+        : m_window(window ? window : 1), m_statistic(statistic), m_alpha(ewmaAlpha), m_hold(emergencyHold) {}
+
+    static bool ParseStatistic(const std::string &name, Statistic &statistic) {
+        if (name == "latest")
+            statistic = kLatest;
+        else if (name == "mean")
+            statistic = kMean;
+        else if (name == "max")
+            statistic = kMax;
+        else if (name == "ewma")
+            statistic = kEwma;
+        else
+            return false;
+        return true;
+    }
+
+    // ID of a junction, adding it on first use. IDs are dense and assigned
+    // in first-seen order.
+    uint32_t Intern(const std::string &junction) {
+        auto inserted = m_ids.emplace(junction, static_cast<uint32_t>(m_names.size()));
+        if (inserted.second) {
+            m_names.push_back(junction);
+            m_state.emplace_back();
+            m_samples.resize(m_samples.size() + m_window, 0);
+            m_maxQueue.resize(m_maxQueue.size() + m_window, 0);
+        }
+        return inserted.first->second;
+    }
+
+    // ID of a known junction, or -1.
+    int32_t Find(const std::string &junction) const {
+        auto it = m_ids.find(junction);
+        return it == m_ids.end() ? -1 : static_cast<int32_t>(it->second);
+    }
+
+    const std::string &Name(uint32_t id) const { return m_names[id]; }
+    size_t Size() const { return m_names.size(); }
+    uint32_t Window() const { return m_window; }
+
+    // Adds a sample, evicting the oldest once the window is full.
+    void Push(uint32_t id, uint32_t vehicles, bool emergency, double now) {
+        State &s = m_state[id];
+        uint32_t *samples = &m_samples[size_t(id) * m_window];
+        uint64_t *queue = &m_maxQueue[size_t(id) * m_window];
+        uint64_t seq = s.pushed;
+
+        if (seq >= m_window) {
+            s.sum -= samples[seq % m_window];
+            if (queue[s.maxFront % m_window] + m_window == seq)
+                s.maxFront++;
+        }
+        while (s.maxBack > s.maxFront && samples[queue[(s.maxBack - 1) % m_window] % m_window] <= vehicles)
+            s.maxBack--;
+        samples[seq % m_window] = vehicles;
+        queue[s.maxBack++ % m_window] = seq;
+        s.sum += vehicles;
+        s.ewma = seq == 0 ? vehicles : s.ewma + m_alpha * (vehicles - s.ewma);
+        s.pushed++;
+
+        s.emergency = emergency;
+        if (emergency)
+            s.emergencyUntil = now + m_hold;
+    }
+
+    uint32_t Samples(uint32_t id) const {
+        return m_state[id].pushed < m_window ? uint32_t(m_state[id].pushed) : m_window;
+    }
+    uint32_t Latest(uint32_t id) const {
+        const State &s = m_state[id];
+        return s.pushed ? m_samples[size_t(id) * m_window + (s.pushed - 1) % m_window] : 0;
+    }
+    double Mean(uint32_t id) const {
+        uint32_t n = Samples(id);
+        return n ? double(m_state[id].sum) / n : 0.0;
+    }
+    uint32_t Max(uint32_t id) const {
+        const State &s = m_state[id];
+        if (s.maxBack == s.maxFront)
+            return 0;
+        uint64_t seq = m_maxQueue[size_t(id) * m_window + s.maxFront % m_window];
+        return m_samples[size_t(id) * m_window + seq % m_window];
+    }
+    double Ewma(uint32_t id) const { return m_state[id].ewma; }
+
+    // The configured statistic, rounded to whole vehicles.
+    uint32_t Vehicles(uint32_t id) const {
+        switch (m_statistic) {
+        case kLatest:
+            return Latest(id);
+        case kMean:
+            return uint32_t(Mean(id) + 0.5);
+        case kMax:
+            return Max(id);
+        case kEwma:
+            return uint32_t(Ewma(id) + 0.5);
+        }
+        return Latest(id);
+    }
+
+    // True while the latest sample reports an emergency or an earlier one
+    // is still within its hold time.
+    bool Emergency(uint32_t id, double now) const {
+        const State &s = m_state[id];
+        return s.emergency || now < s.emergencyUntil;
+    }
+
+private:
+    struct State {
+        uint64_t pushed = 0;    // Samples ever pushed; sample k sits in slot k % window
+        uint64_t sum = 0;       // Over the samples in the window
+        uint64_t maxFront = 0;  // Sequence numbers [maxFront, maxBack) of the max queue, values decreasing
+        uint64_t maxBack = 0;
+        double ewma = 0.0;
+        bool emergency = false;
+        double emergencyUntil = -std::numeric_limits<double>::infinity();
+    };
+
+    uint32_t m_window;
+    Statistic m_statistic;
+    double m_alpha;
+    double m_hold;
+    std::unordered_map<std::string, uint32_t> m_ids;
+    std::vector<std::string> m_names;
+    std::vector<State> m_state;
+    std::vector<uint32_t> m_samples;   // `window` slots per junction, by ID
+    std::vector<uint64_t> m_maxQueue;  // `window` slots per junction, by ID
+};
+
+#endif // JUNCTION_STATE_H
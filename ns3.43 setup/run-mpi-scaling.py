@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+
+# Strong and weak scaling of partitioned wsn-implementation runs.
+#
+# Runs wsn-implementation --partitioned under mpirun for each rank count on
+# this machine and reports simulator events per wall-clock second. Strong
+# scaling keeps one topology (--topology); weak scaling (--weak-rows) grows
+# a generate_grid.py junction grid with the rank count, so every rank keeps
+# about the same share. Each rank writes summary.json under
+# <output-dir>/np<N>/rank-<r>; the totals go to <output-dir>/scaling.csv.
+#
+#   ./run-mpi-scaling.py --topology city/sensor_map.csv --ranks 1 2 4 8
+#   ./run-mpi-scaling.py --weak-rows 8 --cols 16 --ranks 1 2 4 8
+
+import argparse
+import csv
+import glob
+import json
+import os
+import shutil
+import subprocess
+import sys
+
+FIELDS = ['ranks', 'nodes', 'cutLinks', 'radioLinks', 'events', 'wallSeconds', 'eventsPerSecond',
+          'speedup', 'efficiency']
+
+
+def find_binary(ns3_dir):
+    candidates = [p for p in glob.glob(os.path.join(ns3_dir, 'build', 'scratch', '*wsn-implementation*'))
+                  if os.path.isfile(p) and os.access(p, os.X_OK)]
+    return max(candidates, key=os.path.getmtime) if candidates else None
+
+
+def generate_topology(rows, cols, output_dir):
+    script = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'sumo setup', 'generate_grid.py')
+    subprocess.run([sys.executable, script, '--rows', str(rows), '--cols', str(cols), '--output-dir', output_dir],
+                   check=True, stdout=subprocess.DEVNULL)
+    return os.path.join(output_dir, 'sensor_map.csv')
+
+
+def run_ranks(ranks, topology, args, binary, env):
+    run_dir = os.path.join(args.output_dir, f'np{ranks}')
+    os.makedirs(run_dir, exist_ok=True)
+    cmd = [args.mpirun, '-np', str(ranks), binary,
+           '--partitioned=true',
+           f'--topologyFile={topology}',
+           f'--simTime={args.sim_time}',
+           f'--outputDir={run_dir}',
+           f'--sensorLogFormat={args.sensor_log_format}',
+           '--verbose=false']
+    with open(os.path.join(run_dir, 'stdout.log'), 'w') as log:
+        result = subprocess.run(cmd, stdout=log, stderr=subprocess.STDOUT, env=env)
+    if result.returncode != 0:
+        return None
+
+    # Ranks run in lockstep, so the slowest one sets the wall-clock time.
+    summaries = []
+    for path in glob.glob(os.path.join(run_dir, 'rank-*', 'summary.json')):
+        with open(path) as f:
+            summaries.append(json.load(f))
+    if len(summaries) != ranks:
+        return None
+    events = sum(s['events'] for s in summaries)
+    wall = max(s['wallSeconds'] for s in summaries)
+    return {'ranks': ranks,
+            'nodes': sum(s['numFPC'] + s['numFFD'] + s['numRFD'] for s in summaries),
+            'cutLinks': summaries[0]['cutLinks'],
+            'radioLinks': summaries[0]['radioLinks'],
+            'events': events,
+            'wallSeconds': wall,
+            'eventsPerSecond': events / wall if wall > 0 else 0.0}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Strong and weak scaling of MPI-partitioned WSN runs')
+    parser.add_argument('--ns3-dir', default=f"/home/{os.environ.get('USER', '')}/ns-allinone-3.43/ns-allinone-3.43/ns-3.43",
+                        help='ns-3.43 source tree configured with --enable-mpi')
+    parser.add_argument('--binary', help='wsn-implementation executable (default: built from --ns3-dir)')
+    parser.add_argument('--mpirun', default='mpirun', help='MPI launcher')
+    parser.add_argument('--ranks', type=int, nargs='+', default=[1, 2, 4])
+    parser.add_argument('--topology', help='sensor_map.csv for strong scaling')
+    parser.add_argument('--weak-rows', type=int,
+                        help='Weak scaling: junction rows per rank of a generated grid (instead of --topology)')
+    parser.add_argument('--cols', type=int, default=16, help='Junction columns of the weak-scaling grid')
+    parser.add_argument('--sim-time', type=float, default=100.0)
+    parser.add_argument('--sensor-log-format', default='binary', choices=['binary', 'csv', 'both'])
+    parser.add_argument('--output-dir', default='scaling', help='Directory for per-run outputs and scaling.csv')
+    args = parser.parse_args()
+    if (args.topology is None) == (args.weak_rows is None):
+        parser.error('give either --topology (strong scaling) or --weak-rows (weak scaling)')
+
+    env = dict(os.environ)
+    binary = args.binary
+    if binary is None:
+        setup_dir = os.path.dirname(os.path.abspath(__file__))
+        scratch = os.path.join(args.ns3_dir, 'scratch')
+        shutil.copy(os.path.join(setup_dir, 'wsn-implementation.cc'), scratch)
+        for header in glob.glob(os.path.join(setup_dir, '*.h')):
+            shutil.copy(header, scratch)
+        subprocess.run(['./ns3', 'build', 'scratch/wsn-implementation'], cwd=args.ns3_dir, check=True)
+        binary = find_binary(args.ns3_dir)
+        if binary is None:
+            print('Could not find the built wsn-implementation under build/scratch', file=sys.stderr)
+            return 1
+        lib_dir = os.path.join(args.ns3_dir, 'build', 'lib')
+        env['LD_LIBRARY_PATH'] = lib_dir + os.pathsep + env.get('LD_LIBRARY_PATH', '')
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    results = []
+    for ranks in sorted(args.ranks):
+        topology = args.topology
+        if args.weak_rows is not None:
+            topology = generate_topology(args.weak_rows * ranks, args.cols,
+                                         os.path.join(args.output_dir, f'grid-np{ranks}'))
+        row = run_ranks(ranks, os.path.abspath(topology), args, binary, env)
+        if row is None:
+            print(f'{ranks} ranks: run failed, see {args.output_dir}/np{ranks}/stdout.log', file=sys.stderr)
+            continue
+        results.append(row)
+
+    if not results:
+        return 1
+    # Strong scaling: speedup in wall-clock time. Weak scaling: events per
+    # second relative to the smallest run times its share of the work.
+    base = results[0]
+    for row in results:
+        if args.weak_rows is None:
+            row['speedup'] = base['wallSeconds'] / row['wallSeconds'] if row['wallSeconds'] > 0 else 0.0
+        else:
+            row['speedup'] = row['eventsPerSecond'] / base['eventsPerSecond'] if base['eventsPerSecond'] > 0 else 0.0
+        row['efficiency'] = row['speedup'] * base['ranks'] / row['ranks']
+        print(f"{row['ranks']:3d} ranks: {row['nodes']} nodes, {row['events']} events in {row['wallSeconds']:.2f} s "
+              f"({row['eventsPerSecond']:.0f} events/s), speedup {row['speedup']:.2f}, "
+              f"efficiency {row['efficiency']:.0%}, {row['cutLinks']} of {row['radioLinks']} links cut")
+
+    path = os.path.join(args.output_dir, 'scaling.csv')
+    with open(path, 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=FIELDS)
+        writer.writeheader()
+        writer.writerows(results)
+    print(f"{'Weak' if args.weak_rows is not None else 'Strong'} scaling results written to {path}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
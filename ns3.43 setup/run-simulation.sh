@@ -8,6 +8,7 @@ NS3_SETUP_DIR="/home/$USER/TS&A/ns3.43 setup"  # Path to your NS3 code
 SUMO_CONFIG_DIR="/home/$USER/TS&A/sumo setup"  # Path to SUMO config directory
 OUTPUT_DIR="/home/$USER/TS&A"  # Directory for all output files
 SIM_SPEED="normal"  # Can be "slow", "normal", "fast", "very-fast"
+HEADLESS_ARGS=()  # Set by --headless: plain sumo, no delays, throughput stats only
 
 # Process command line arguments
 while [[ $# -gt 0 ]]; do
@@ -16,6 +17,14 @@ while [[ $# -gt 0 ]]; do
       SIM_SPEED="${1#*=}"
       shift
       ;;
+    --headless)
+      HEADLESS_ARGS+=("--headless")
+      shift
+      ;;
+    --end-time=*)
+      HEADLESS_ARGS+=("--end-time=${1#*=}")
+      shift
+      ;;
     *)
       shift
       ;;
@@ -28,6 +37,7 @@ echo "Running WSN simulation to generate traffic data..."
 
 # Copy the implementation files to the NS3 scratch directory
 cp "$NS3_SETUP_DIR/wsn-implementation.cc" "$NS3_DIR/scratch/"
+cp "$NS3_SETUP_DIR/"*.h "$NS3_DIR/scratch/"
 echo "Copied simulation files to NS3 scratch directory"
 
 # Build the NS3 WSN project
@@ -47,11 +57,13 @@ else
   exit 1
 fi
 
-# Move the traffic_sensor_data.csv file to the OUTPUT_DIR if it's not already there
-if [ -f "$NS3_DIR/traffic_sensor_data.csv" ] && [ "$NS3_DIR/traffic_sensor_data.csv" != "$OUTPUT_DIR/traffic_sensor_data.csv" ]; then
-  mv "$NS3_DIR/traffic_sensor_data.csv" "$OUTPUT_DIR/"
-  echo "Moved traffic sensor data to $OUTPUT_DIR"
-fi
+# Move the sensor log (binary by default, CSV with --sensorLogFormat=csv) to the OUTPUT_DIR if it's not already there
+for LOG_FILE in traffic_sensor_data.tslog traffic_sensor_data.csv; do
+  if [ -f "$NS3_DIR/$LOG_FILE" ] && [ "$NS3_DIR/$LOG_FILE" != "$OUTPUT_DIR/$LOG_FILE" ]; then
+    mv "$NS3_DIR/$LOG_FILE" "$OUTPUT_DIR/"
+    echo "Moved $LOG_FILE to $OUTPUT_DIR"
+  fi
+done
 
 # Create an enhanced visualization script if it doesn't exist
 cat > "$OUTPUT_DIR/visualize_traffic_enhanced.py" << 'EOF'
@@ -63,11 +75,46 @@ import time
 import traci
 import subprocess
 import csv
+import mmap
+import struct
 import random
 import argparse
 
+def iter_sensor_log_chunks(file_path):
+    """Yield (time, node_id, vehicle_count, emergency) columns for each chunk of
+    a binary sensor log (see sensor-log.h). The columns are memoryviews into an
+    mmap of the file, so no row data is copied up front."""
+    with open(file_path, 'rb') as f:
+        buf = memoryview(mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ))
+    offset = 16  # File header
+    while offset + 24 <= len(buf):
+        magic, rows = struct.unpack_from('<4sI', buf, offset)
+        if magic != b'TSCK':
+            break  # Index/footer
+        size = (24 + rows * 15 + 7) & ~7
+        if offset + size > len(buf):
+            break  # Chunk still being written
+        base = offset + 24
+        yield (buf[base:base + rows * 8].cast('d'),
+               buf[base + rows * 8:base + rows * 12].cast('I'),
+               buf[base + rows * 12:base + rows * 14].cast('H'),
+               buf[base + rows * 14:base + rows * 15])
+        offset += size
+
+def is_binary_sensor_log(file_path):
+    with open(file_path, 'rb') as f:
+        return f.read(4) == b'TSLG'
+
 def read_traffic_data(file_path):
     data = {}
+    if is_binary_sensor_log(file_path):
+        for times, node_ids, counts, emergencies in iter_sensor_log_chunks(file_path):
+            for time_stamp, node_id, count, emergency in zip(times, node_ids, counts, emergencies):
+                if time_stamp not in data:
+                    data[time_stamp] = {}
+                data[time_stamp][f'J{node_id}'] = {'count': count, 'emergency': emergency != 0}
+        return data
+
     with open(file_path, 'r') as f:
         next(f)  # Skip header
         for line in f:
@@ -85,17 +132,33 @@ def read_traffic_data(file_path):
                 data[time_stamp][f'J{node_id}'] = {'count': count, 'emergency': emergency}
     return data
 
+def controlled_lanes(tls_id):
+    """Incoming lanes of a traffic light's controlled links, in link order
+    without duplicates. The links never change during a run, so callers fetch
+    this once per light."""
+    lanes = []
+    for link in traci.trafficlight.getControlledLinks(tls_id):
+        if link and link[0] and link[0][0] not in lanes:
+            lanes.append(link[0][0])
+    return lanes
+
 def main():
     # Parse command line arguments
     parser = argparse.ArgumentParser(description='SUMO Traffic Visualization with TraCI')
     parser.add_argument('--sumo-config', default="/home/vijay/TS&A/sumo setup/example.sumocfg", 
                         help='Path to SUMO config file')
-    parser.add_argument('--traffic-data', default="/home/vijay/TS&A/traffic_sensor_data.csv",
+    parser.add_argument('--traffic-data', default="/home/vijay/TS&A/traffic_sensor_data.tslog",
                         help='Path to traffic sensor data file')
     parser.add_argument('--speed', choices=['slow', 'normal', 'fast', 'very-fast'], default='normal',
                         help='Simulation speed (default: normal)')
     parser.add_argument('--verbose', action='store_true',
                         help='Show detailed output')
+    parser.add_argument('--headless', action='store_true',
+                        help='Batch mode: plain sumo, no delays or visual effects, '
+                             'advance SUMO to each sensor time point')
+    parser.add_argument('--end-time', type=float, default=None,
+                        help='Keep simulating with the last light settings until this '
+                             'SUMO time once the sensor data runs out (headless only)')
     args = parser.parse_args()
     
     # Set delay based on speed setting
@@ -107,10 +170,15 @@ def main():
         step_delay = 0.05
     elif args.speed == 'very-fast':
         step_delay = 0.01
+    if args.headless:
+        step_delay = 0.0
     
-    # Start SUMO with GUI
-    sumo_cmd = ["sumo-gui", "-c", args.sumo_config, "--start", "--remote-port", "8813"]
-    if args.speed == 'very-fast':
+    # Start SUMO with GUI, or plain SUMO in headless mode
+    sumo_binary = "sumo" if args.headless else "sumo-gui"
+    sumo_cmd = [sumo_binary, "-c", args.sumo_config, "--start", "--remote-port", "8813"]
+    if args.headless:
+        sumo_cmd.append("--no-step-log")
+    elif args.speed == 'very-fast':
         sumo_cmd.append("--step-length")
         sumo_cmd.append("0.05")  # Faster SUMO steps for very fast mode
     
@@ -129,7 +197,10 @@ def main():
         time_points = sorted(traffic_data.keys())
         
         print(f"Loaded {len(time_points)} time points of traffic data")
-        print(f"Simulation speed: {args.speed} (delay: {step_delay:.3f}s per step)")
+        if args.headless:
+            print("Simulation speed: headless (no delay)")
+        else:
+            print(f"Simulation speed: {args.speed} (delay: {step_delay:.3f}s per step)")
         
         # Set up colors for visualization
         colors = {
@@ -142,13 +213,29 @@ def main():
         # Add vehicles to represent traffic state
         vehicles_added = []
         
+        # The lights and the lanes they control are fixed for the run, so
+        # fetch them once instead of on every step
+        tls_ids = traci.trafficlight.getIDList()
+        tls_lanes = {tls_id: controlled_lanes(tls_id) for tls_id in tls_ids}
+        lane_state = {}  # Color last applied to each light's lanes
+        
+        def paint(tls_id, state):
+            # Recolor a light's lanes only when its traffic state changes
+            if args.headless or lane_state.get(tls_id) == state:
+                return
+            for lane_id in tls_lanes[tls_id]:
+                traci.lane.setColor(lane_id, colors[state])
+            lane_state[tls_id] = state
+        
+        start_wall = time.perf_counter()
+        start_sim = traci.simulation.getTime()
+        sumo_steps = 0
+        
         # Process each time point
         for t in time_points:
             # Delay based on selected speed
-            time.sleep(step_delay)
-            
-            # Get traffic light IDs
-            tls_ids = traci.trafficlight.getIDList()
+            if step_delay > 0:
+                time.sleep(step_delay)
             
             for tls_id in tls_ids:
                 # Map traffic light to junction
@@ -183,10 +270,7 @@ def main():
                         traci.trafficlight.setPhaseDuration(tls_id, 3)  # Short duration
                         
                         # Visual indicator - change junction color to red
-                        for edge_id in traci.trafficlight.getControlledLinks(tls_id):
-                            if edge_id and len(edge_id) > 0 and edge_id[0]:
-                                for lane_id in traci.edge.getLaneIDs(edge_id[0][0]):
-                                    traci.lane.setColor(lane_id, colors['EMERGENCY'])
+                        paint(tls_id, 'EMERGENCY')
                     except Exception as e:
                         if args.verbose:
                             print(f"Error adjusting {tls_id}: {e}")
@@ -201,10 +285,7 @@ def main():
                             traci.trafficlight.setPhaseDuration(tls_id, 10)
                             
                         # Visual indicator - change junction color to orange
-                        for edge_id in traci.trafficlight.getControlledLinks(tls_id):
-                            if edge_id and len(edge_id) > 0 and edge_id[0]:
-                                for lane_id in traci.edge.getLaneIDs(edge_id[0][0]):
-                                    traci.lane.setColor(lane_id, colors['HEAVY'])
+                        paint(tls_id, 'HEAVY')
                     except Exception as e:
                         if args.verbose:
                             print(f"Error adjusting {tls_id}: {e}")
@@ -219,10 +300,7 @@ def main():
                             traci.trafficlight.setPhaseDuration(tls_id, 3)
                             
                         # Visual indicator - change junction color to cyan
-                        for edge_id in traci.trafficlight.getControlledLinks(tls_id):
-                            if edge_id and len(edge_id) > 0 and edge_id[0]:
-                                for lane_id in traci.edge.getLaneIDs(edge_id[0][0]):
-                                    traci.lane.setColor(lane_id, colors['LIGHT'])
+                        paint(tls_id, 'LIGHT')
                     except Exception as e:
                         if args.verbose:
                             print(f"Error adjusting {tls_id}: {e}")
@@ -230,22 +308,17 @@ def main():
                     # Normal traffic
                     try:
                         # Visual indicator - change junction color to green
-                        for edge_id in traci.trafficlight.getControlledLinks(tls_id):
-                            if edge_id and len(edge_id) > 0 and edge_id[0]:
-                                for lane_id in traci.edge.getLaneIDs(edge_id[0][0]):
-                                    traci.lane.setColor(lane_id, colors['NORMAL'])
+                        paint(tls_id, 'NORMAL')
                     except Exception as e:
                         if args.verbose:
                             print(f"Error setting colors: {e}")
                 
                 # Dynamically add/remove vehicles to visualize traffic density
                 try:
-                    if args.speed != 'very-fast':  # Skip vehicle management in very-fast mode
+                    # Skip vehicle management in very-fast and headless modes
+                    if args.speed != 'very-fast' and not args.headless:
                         # Add vehicles proportional to the count
-                        edge_ids = []
-                        for edge_id in traci.trafficlight.getControlledLinks(tls_id):
-                            if edge_id and len(edge_id) > 0 and edge_id[0]:
-                                edge_ids.append(edge_id[0][0])
+                        edge_ids = tls_lanes[tls_id]
                         
                         if edge_ids:
                             # Add vehicles for visualization
@@ -262,14 +335,27 @@ def main():
                     if args.verbose:
                         print(f"Error managing vehicles: {e}")
             
-            traci.simulationStep()
+            if args.headless:
+                # Advance SUMO to the sensor time in one call
+                traci.simulationStep(t)
+            else:
+                traci.simulationStep()
+            sumo_steps += 1
             
             # Print progress indicator (without flooding the console)
-            if int(t) % 10 == 0:
+            if not args.headless and int(t) % 10 == 0:
                 print(f"Simulation time: {t:.1f}s", end="\r")
         
+        if args.headless and args.end_time is not None and traci.simulation.getTime() < args.end_time:
+            traci.simulationStep(args.end_time)
+            sumo_steps += 1
+        
+        sim_seconds = traci.simulation.getTime() - start_sim
+        wall_seconds = time.perf_counter() - start_wall
         print("\nVisualization complete")
-        if args.speed != 'very-fast':
+        print(f"Simulated {sim_seconds:.1f}s of traffic in {wall_seconds:.2f}s wall-clock "
+              f"({sim_seconds / max(wall_seconds, 1e-9):.1f} sim-s/wall-s, {sumo_steps} TraCI steps)")
+        if args.speed != 'very-fast' and not args.headless:
             time.sleep(3)  # Keep SUMO open briefly to see the final state
         traci.close()
         
@@ -295,6 +381,6 @@ echo "Created enhanced visualization script"
 # Run the visualization automatically with the specified speed
 echo "Starting traffic visualization with speed: $SIM_SPEED..."
 cd "$OUTPUT_DIR"
-python3 "$OUTPUT_DIR/visualize_traffic_enhanced.py" --sumo-config="$SUMO_CONFIG_DIR/example.sumocfg" --traffic-data="$OUTPUT_DIR/traffic_sensor_data.csv" --speed="$SIM_SPEED"
+python3 "$OUTPUT_DIR/visualize_traffic_enhanced.py" --sumo-config="$SUMO_CONFIG_DIR/example.sumocfg" --traffic-data="$OUTPUT_DIR/traffic_sensor_data.tslog" --speed="$SIM_SPEED" "${HEADLESS_ARGS[@]}"
 
 echo "Simulation and visualization completed."
\ No newline at end of file
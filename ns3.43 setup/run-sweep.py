@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+
+# Parameter sweep driver for the WSN scenario.
+#
+# Runs every (numRFD, numFFD, dataRate, reportInterval, dutyCycle, seed) combination of wsn-implementation
+# as an independent process, spread over all local cores. Each run gets its
+# own --RngRun and output directory and writes summary.json there; completed
+# runs are skipped on restart, so an interrupted sweep resumes where it left off.
+#
+#   ./run-sweep.py --num-rfd 10 100 1000 --num-ffd 3 10 --data-rate 1kbps 5kbps --seeds 5
+#   ./run-sweep.py --report-interval 1 10 60 300 --duty-cycle on off   # battery lifetime tradeoff
+#   ./run-sweep.py --num-rfd 100 400 1600 --num-ffd 16 64 --mesh-routing --field-size 400 --output-dir mesh
+
+import argparse
+import collections
+import csv
+import glob
+import itertools
+import json
+import os
+import random
+import shutil
+import subprocess
+import sys
+import threading
+import time
+
+SUMMARY_FIELDS = ['numRFD', 'numFFD', 'dataRate', 'reportInterval', 'dutyCycle', 'seed', 'simTime',
+                  'packetsSent', 'packetsReceived', 'pdr', 'meanLatencyMs', 'readingPdr', 'delayP50Ms', 'delayP99Ms',
+                  'ccaFailures', 'macTxDrop', 'phyRxDrop', 'txBacklogDrop', 'rfdMeanLifetimeDays',
+                  'rfdMinLifetimeDays', 'meanHops', 'maxHops', 'perHopLatencyMs', 'sinkThroughputKbps',
+                  'unreachableNodes', 'emergencyEvents', 'emergencyDelivered', 'emergencyP50Ms', 'emergencyP99Ms',
+                  'emergencyMaxMs', 'topologyMs', 'wallSeconds', 'events', 'eventsPerSecond']
+
+
+class WorkStealingQueue:
+    """One deque per worker. Workers pop from the front of their own deque and,
+    when it runs dry, steal from the back of the fullest other deque."""
+
+    def __init__(self, jobs, workers):
+        self.lock = threading.Lock()
+        self.deques = [collections.deque() for _ in range(workers)]
+        for i, job in enumerate(jobs):
+            self.deques[i % workers].append(job)
+
+    def get(self, worker):
+        with self.lock:
+            own = self.deques[worker]
+            if own:
+                return own.popleft()
+            victim = max(self.deques, key=len)
+            if victim:
+                return victim.pop()
+            return None
+
+
+def run_name(job):
+    return (f"rfd{job['numRFD']}_ffd{job['numFFD']}_rate{job['dataRate']}_ri{job['reportInterval']:g}"
+            f"_{'dc' if job['dutyCycle'] else 'on'}_seed{job['seed']}")
+
+
+def find_binary(ns3_dir):
+    candidates = [p for p in glob.glob(os.path.join(ns3_dir, 'build', 'scratch', '*wsn-implementation*'))
+                  if os.path.isfile(p) and os.access(p, os.X_OK)]
+    return max(candidates, key=os.path.getmtime) if candidates else None
+
+
+def run_job(job, args, binary, env):
+    run_dir = os.path.join(args.output_dir, 'runs', run_name(job))
+    os.makedirs(run_dir, exist_ok=True)
+    cmd = [binary,
+           f"--numRFD={job['numRFD']}",
+           f"--numFFD={job['numFFD']}",
+           f"--dataRate={job['dataRate']}",
+           f"--reportInterval={job['reportInterval']}",
+           f"--dutyCycle={'true' if job['dutyCycle'] else 'false'}",
+           f"--simTime={args.sim_time}",
+           f"--RngRun={job['seed']}",
+           f"--outputDir={run_dir}",
+           f"--sensorLogFormat={args.sensor_log_format}",
+           f"--meshRouting={'true' if args.mesh_routing else 'false'}",
+           f"--radioRange={args.radio_range}",
+           f"--pathLossExponent={args.path_loss_exponent}",
+           f"--fieldSize={args.field_size}",
+           f"--emergencyRate={args.emergency_rate}",
+           "--verbose=false"]
+    with open(os.path.join(run_dir, 'stdout.log'), 'w') as log:
+        result = subprocess.run(cmd, stdout=log, stderr=subprocess.STDOUT, env=env)
+    return result.returncode
+
+
+def load_summary(job, output_dir):
+    path = os.path.join(output_dir, 'runs', run_name(job), 'summary.json')
+    if not os.path.exists(path):
+        return None
+    with open(path) as f:
+        summary = json.load(f)
+    summary['seed'] = job['seed']
+    return summary
+
+
+def write_results(jobs, output_dir):
+    path = os.path.join(output_dir, 'results.csv')
+    with open(path + '.tmp', 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=SUMMARY_FIELDS, extrasaction='ignore')
+        writer.writeheader()
+        for job in jobs:
+            summary = load_summary(job, output_dir)
+            if summary is not None:
+                writer.writerow(summary)
+    os.replace(path + '.tmp', path)
+    return path
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Parallel parameter sweep for the WSN scenario')
+    parser.add_argument('--ns3-dir', default=f"/home/{os.environ.get('USER', '')}/ns-allinone-3.43/ns-allinone-3.43/ns-3.43",
+                        help='Path to the NS-3 directory')
+    parser.add_argument('--binary', help='wsn-implementation executable (default: built from --ns3-dir)')
+    parser.add_argument('--output-dir', default='sweep', help='Directory for per-run outputs and results.csv')
+    parser.add_argument('--num-rfd', type=int, nargs='+', default=[10])
+    parser.add_argument('--num-ffd', type=int, nargs='+', default=[3])
+    parser.add_argument('--data-rate', nargs='+', default=['1kbps'])
+    parser.add_argument('--report-interval', type=float, nargs='+', default=[0.0],
+                        help='Seconds between RFD reports (0 derives it from packet size and data rate)')
+    parser.add_argument('--duty-cycle', nargs='+', default=['off'], choices=['on', 'off'],
+                        help='Whether RFD radios sleep between reports')
+    parser.add_argument('--seeds', type=int, default=1, help='Replications (RngRun 1..N) per combination')
+    parser.add_argument('--sim-time', type=float, default=100.0)
+    parser.add_argument('--sensor-log-format', default='binary', choices=['binary', 'csv', 'both'])
+    parser.add_argument('--mesh-routing', action='store_true',
+                        help='Route over the 6LoWPAN collection tree (applies to every run)')
+    parser.add_argument('--radio-range', type=float, default=0.0, help='Metres beyond which frames are lost')
+    parser.add_argument('--path-loss-exponent', type=float, default=3.0)
+    parser.add_argument('--field-size', type=float, default=100.0, help='Side of the default layout in metres')
+    parser.add_argument('--emergency-rate', type=float, default=0.0,
+                        help='Emergency detections per second per RFD, to measure priority latency under load')
+    parser.add_argument('--jobs', type=int, default=os.cpu_count(), help='Parallel runs (default: all cores)')
+    args = parser.parse_args()
+
+    env = dict(os.environ)
+    binary = args.binary
+    if binary is None:
+        setup_dir = os.path.dirname(os.path.abspath(__file__))
+        scratch = os.path.join(args.ns3_dir, 'scratch')
+        shutil.copy(os.path.join(setup_dir, 'wsn-implementation.cc'), scratch)
+        for header in glob.glob(os.path.join(setup_dir, '*.h')):
+            shutil.copy(header, scratch)
+        subprocess.run(['./ns3', 'build', 'scratch/wsn-implementation'], cwd=args.ns3_dir, check=True)
+        binary = find_binary(args.ns3_dir)
+        if binary is None:
+            print('Could not find the built wsn-implementation under build/scratch', file=sys.stderr)
+            return 1
+        lib_dir = os.path.join(args.ns3_dir, 'build', 'lib')
+        env['LD_LIBRARY_PATH'] = lib_dir + os.pathsep + env.get('LD_LIBRARY_PATH', '')
+
+    jobs = [{'numRFD': rfd, 'numFFD': ffd, 'dataRate': rate, 'reportInterval': interval,
+             'dutyCycle': duty == 'on', 'seed': seed}
+            for rfd, ffd, rate, interval, duty, seed in itertools.product(
+                args.num_rfd, args.num_ffd, args.data_rate, args.report_interval, args.duty_cycle,
+                range(1, args.seeds + 1))]
+    os.makedirs(args.output_dir, exist_ok=True)
+    pending = [job for job in jobs if load_summary(job, args.output_dir) is None]
+    print(f"{len(jobs)} runs in sweep, {len(jobs) - len(pending)} already complete, "
+          f"{len(pending)} to run on {args.jobs} workers")
+
+    # Largest scenarios first so the long runs do not end up as stragglers;
+    # shuffle equal sizes so seeds of one combination spread across workers.
+    random.shuffle(pending)
+    pending.sort(key=lambda job: job['numRFD'] + job['numFFD'], reverse=True)
+    queue = WorkStealingQueue(pending, max(args.jobs, 1))
+    failures = []
+    done = [0]
+    progress_lock = threading.Lock()
+    start = time.time()
+
+    def worker(index):
+        while True:
+            job = queue.get(index)
+            if job is None:
+                return
+            code = run_job(job, args, binary, env)
+            with progress_lock:
+                done[0] += 1
+                if code != 0:
+                    failures.append((run_name(job), code))
+                print(f"[{done[0]}/{len(pending)}] {run_name(job)} "
+                      f"{'ok' if code == 0 else f'failed ({code})'} after {time.time() - start:.1f}s")
+
+    threads = [threading.Thread(target=worker, args=(i,), daemon=True) for i in range(max(args.jobs, 1))]
+    for t in threads:
+        t.start()
+    try:
+        for t in threads:
+            t.join()
+    except KeyboardInterrupt:
+        print('\nInterrupted; completed runs are kept and will be skipped on the next invocation')
+
+    results = write_results(jobs, args.output_dir)
+    print(f"Results for completed runs written to {results}")
+    for name, code in failures:
+        print(f"  {name} exited with {code}", file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
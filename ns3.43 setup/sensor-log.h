@@ -0,0 +1,395 @@
+#ifndef SENSOR_LOG_H
+#define SENSOR_LOG_H
+
+// Sensor log writers/readers shared by the WSN scenario and the SUMO bridge.
+//
+// Binary columnar layout ("TSLG", version 1, host byte order):
+//
+//   file header   16 B   magic "TSLG", u16 version, u16 reserved, u32 chunk capacity, u32 reserved
+//   chunk * N            magic "TSCK", u32 rows, f64 first time, f64 last time,
+//                        then the columns f64 time[rows], u32 nodeId[rows],
+//                        u16 vehicleCount[rows], u8 emergency[rows], padded to 8 bytes
+//   index                magic "TSIX", u32 chunk count, then {u64 offset, f64 first time} per chunk
+//   footer        16 B   u64 index offset, u32 chunk count, magic "TSFT"
+//
+// Chunks are only ever appended whole, so a reader can follow a file that is
+// still being written by walking chunk headers; the index and footer are
+// written on Close() for random access into finished logs.
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct SensorReading {
+    double time;
+    uint32_t nodeId;
+    uint32_t vehicleCount;
+    bool emergency;
+};
+
+namespace sensorlog {
+
+constexpr uint32_t kFileMagic = 0x474c5354;   // "TSLG"
+constexpr uint32_t kChunkMagic = 0x4b435354;  // "TSCK"
+constexpr uint32_t kIndexMagic = 0x58495354;  // "TSIX"
+constexpr uint32_t kFooterMagic = 0x54465354; // "TSFT"
+constexpr uint16_t kVersion = 1;
+constexpr uint32_t kFileHeaderSize = 16;
+constexpr uint32_t kChunkHeaderSize = 24;
+constexpr uint32_t kDefaultChunkRows = 4096;
+
+inline uint64_t ChunkBytes(uint32_t rows) {
+    uint64_t raw = kChunkHeaderSize + static_cast<uint64_t>(rows) * (8 + 4 + 2 + 1);
+    return (raw + 7) & ~static_cast<uint64_t>(7);
+}
+
+} // namespace sensorlog
+
+// Sink for per-sample sensor readings. Implementations buffer internally;
+// nothing is guaranteed on disk before Flush() or Close().
+class SensorLogWriter {
+public:
+    virtual ~SensorLogWriter() = default;
+    virtual bool IsOpen() const = 0;
+    virtual void Append(const SensorReading &reading) = 0;
+    virtual void Flush() = 0;
+    virtual void Close() = 0;
+};
+
+// Legacy "Time,NodeID,VehicleCount,Emergency" text log, kept for tools that
+// still expect CSV. Rows are newline-terminated without flushing.
+class CsvSensorLogWriter : public SensorLogWriter {
+public:
+    explicit CsvSensorLogWriter(const std::string &path) : m_buffer(1 << 16) {
+        m_file.rdbuf()->pubsetbuf(m_buffer.data(), m_buffer.size());
+        m_file.open(path.c_str());
+        m_file << "Time,NodeID,VehicleCount,Emergency\n";
+    }
+    ~CsvSensorLogWriter() override { Close(); }
+
+    bool IsOpen() const override { return m_file.is_open(); }
+    void Append(const SensorReading &r) override {
+        m_file << r.time << "," << r.nodeId << "," << r.vehicleCount << ","
+               << (r.emergency ? 1 : 0) << '\n';
+    }
+    void Flush() override { m_file.flush(); }
+    void Close() override {
+        if (m_file.is_open())
+            m_file.close();
+    }
+
+private:
+    std::vector<char> m_buffer;
+    std::ofstream m_file;
+};
+
+// Parses one "Time,NodeID,VehicleCount[,Emergency]" row in [first, last)
+// without allocating; the time is skipped. Returns false for malformed rows.
+inline bool ParseSensorCsvRow(const char *first, const char *last, uint32_t &nodeId, uint32_t &vehicleCount,
+                              bool &emergency) {
+    const char *p = static_cast<const char *>(std::memchr(first, ',', last - first));
+    if (p == nullptr)
+        return false;
+
+    auto res = std::from_chars(p + 1, last, nodeId);
+    if (res.ec != std::errc() || res.ptr == last || *res.ptr != ',')
+        return false;
+
+    res = std::from_chars(res.ptr + 1, last, vehicleCount);
+    if (res.ec != std::errc())
+        return false;
+
+    int emergencyFlag = 0;
+    if (res.ptr != last && *res.ptr == ',')
+        std::from_chars(res.ptr + 1, last, emergencyFlag);
+    emergency = emergencyFlag != 0;
+    return true;
+}
+
+// Binary columnar writer; see the layout at the top of this file.
+class BinarySensorLogWriter : public SensorLogWriter {
+public:
+    explicit BinarySensorLogWriter(const std::string &path,
+                                   uint32_t chunkRows = sensorlog::kDefaultChunkRows)
+        : m_chunkRows(chunkRows), m_offset(0) {
+        m_file.open(path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!m_file.is_open())
+            return;
+
+        uint8_t header[sensorlog::kFileHeaderSize] = {};
+        std::memcpy(header, &sensorlog::kFileMagic, 4);
+        std::memcpy(header + 4, &sensorlog::kVersion, 2);
+        std::memcpy(header + 8, &m_chunkRows, 4);
+        Write(header, sizeof(header));
+        m_file.flush();
+
+        m_time.reserve(m_chunkRows);
+        m_nodeId.reserve(m_chunkRows);
+        m_vehicleCount.reserve(m_chunkRows);
+        m_emergency.reserve(m_chunkRows);
+    }
+    ~BinarySensorLogWriter() override { Close(); }
+
+    bool IsOpen() const override { return m_file.is_open(); }
+
+    void Append(const SensorReading &r) override {
+        m_time.push_back(r.time);
+        m_nodeId.push_back(r.nodeId);
+        m_vehicleCount.push_back(static_cast<uint16_t>(r.vehicleCount > 0xffff ? 0xffff : r.vehicleCount));
+        m_emergency.push_back(r.emergency ? 1 : 0);
+        if (m_time.size() >= m_chunkRows)
+            WriteChunk();
+    }
+
+    // Writes the pending rows as a (possibly short) chunk so readers see them.
+    void Flush() override {
+        WriteChunk();
+        m_file.flush();
+    }
+
+    void Close() override {
+        if (!m_file.is_open())
+            return;
+        WriteChunk();
+
+        uint64_t indexOffset = m_offset;
+        uint32_t chunkCount = static_cast<uint32_t>(m_chunkOffsets.size());
+        Write(&sensorlog::kIndexMagic, 4);
+        Write(&chunkCount, 4);
+        for (uint32_t i = 0; i < chunkCount; i++) {
+            Write(&m_chunkOffsets[i], 8);
+            Write(&m_chunkFirstTimes[i], 8);
+        }
+        Write(&indexOffset, 8);
+        Write(&chunkCount, 4);
+        Write(&sensorlog::kFooterMagic, 4);
+        m_file.close();
+    }
+
+private:
+    void Write(const void *data, size_t size) {
+        m_file.write(static_cast<const char *>(data), size);
+        m_offset += size;
+    }
+
+    void WriteChunk() {
+        uint32_t rows = static_cast<uint32_t>(m_time.size());
+        if (rows == 0 || !m_file.is_open())
+            return;
+
+        // Assemble the whole chunk first so it reaches the file in one write.
+        m_chunk.assign(sensorlog::ChunkBytes(rows), 0);
+        uint8_t *p = m_chunk.data();
+        std::memcpy(p, &sensorlog::kChunkMagic, 4);
+        std::memcpy(p + 4, &rows, 4);
+        std::memcpy(p + 8, &m_time.front(), 8);
+        std::memcpy(p + 16, &m_time.back(), 8);
+        p += sensorlog::kChunkHeaderSize;
+        std::memcpy(p, m_time.data(), rows * 8);
+        p += rows * 8;
+        std::memcpy(p, m_nodeId.data(), rows * 4);
+        p += rows * 4;
+        std::memcpy(p, m_vehicleCount.data(), rows * 2);
+        p += rows * 2;
+        std::memcpy(p, m_emergency.data(), rows);
+
+        m_chunkOffsets.push_back(m_offset);
+        m_chunkFirstTimes.push_back(m_time.front());
+        Write(m_chunk.data(), m_chunk.size());
+        m_file.flush();
+
+        m_time.clear();
+        m_nodeId.clear();
+        m_vehicleCount.clear();
+        m_emergency.clear();
+    }
+
+    std::ofstream m_file;
+    uint32_t m_chunkRows;
+    uint64_t m_offset;
+    std::vector<double> m_time;
+    std::vector<uint32_t> m_nodeId;
+    std::vector<uint16_t> m_vehicleCount;
+    std::vector<uint8_t> m_emergency;
+    std::vector<uint8_t> m_chunk;
+    std::vector<uint64_t> m_chunkOffsets;
+    std::vector<double> m_chunkFirstTimes;
+};
+
+// Fans readings out to several writers (e.g. binary plus CSV export).
+class TeeSensorLogWriter : public SensorLogWriter {
+public:
+    void Add(std::unique_ptr<SensorLogWriter> writer) { m_writers.push_back(std::move(writer)); }
+
+    bool IsOpen() const override {
+        for (const auto &w : m_writers) {
+            if (!w->IsOpen())
+                return false;
+        }
+        return !m_writers.empty();
+    }
+    void Append(const SensorReading &r) override {
+        for (auto &w : m_writers)
+            w->Append(r);
+    }
+    void Flush() override {
+        for (auto &w : m_writers)
+            w->Flush();
+    }
+    void Close() override {
+        for (auto &w : m_writers)
+            w->Close();
+    }
+
+private:
+    std::vector<std::unique_ptr<SensorLogWriter>> m_writers;
+};
+
+// Creates the writer for format "csv", "binary" or "both". basePath has no
+// extension; ".csv" / ".tslog" are appended. Returns nullptr for unknown formats.
+inline std::unique_ptr<SensorLogWriter> CreateSensorLogWriter(const std::string &format,
+                                                              const std::string &basePath) {
+    if (format == "csv")
+        return std::make_unique<CsvSensorLogWriter>(basePath + ".csv");
+    if (format == "binary")
+        return std::make_unique<BinarySensorLogWriter>(basePath + ".tslog");
+    if (format == "both") {
+        auto tee = std::make_unique<TeeSensorLogWriter>();
+        tee->Add(std::make_unique<BinarySensorLogWriter>(basePath + ".tslog"));
+        tee->Add(std::make_unique<CsvSensorLogWriter>(basePath + ".csv"));
+        return tee;
+    }
+    return nullptr;
+}
+
+// Column pointers into one mapped chunk. Valid until the next reader call.
+struct SensorLogChunkView {
+    uint32_t rows;
+    const double *time;
+    const uint32_t *nodeId;
+    const uint16_t *vehicleCount;
+    const uint8_t *emergency;
+};
+
+// Zero-copy reader for binary sensor logs. The file is mmap'd and chunks are
+// handed out as views into the mapping; ReadNewChunks() can be called
+// repeatedly on a file that is still growing and only visits chunks that
+// were completed since the previous call.
+class BinarySensorLogReader {
+public:
+    BinarySensorLogReader() : m_fd(-1), m_map(nullptr), m_mapSize(0), m_next(sensorlog::kFileHeaderSize) {}
+    ~BinarySensorLogReader() { Close(); }
+
+    BinarySensorLogReader(const BinarySensorLogReader &) = delete;
+    BinarySensorLogReader &operator=(const BinarySensorLogReader &) = delete;
+
+    static bool IsBinaryLog(const std::string &path) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        uint32_t magic = 0;
+        in.read(reinterpret_cast<char *>(&magic), 4);
+        return in.gcount() == 4 && magic == sensorlog::kFileMagic;
+    }
+
+    bool Open(const std::string &path) {
+        Close();
+        m_fd = ::open(path.c_str(), O_RDONLY);
+        m_next = sensorlog::kFileHeaderSize;
+        return m_fd >= 0 && Remap();
+    }
+
+    void Close() {
+        Unmap();
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    // Calls onChunk(const SensorLogChunkView &) for every complete chunk not
+    // yet visited. Returns the number of rows visited.
+    template <typename F>
+    uint64_t ReadNewChunks(F &&onChunk) {
+        if (m_fd < 0 || !Remap())
+            return 0;
+
+        uint64_t rowsRead = 0;
+        while (m_next + sensorlog::kChunkHeaderSize <= m_mapSize) {
+            const uint8_t *p = m_map + m_next;
+            uint32_t magic, rows;
+            std::memcpy(&magic, p, 4);
+            std::memcpy(&rows, p + 4, 4);
+            if (magic != sensorlog::kChunkMagic)
+                break; // Index/footer, or a chunk header that is not written yet
+            uint64_t bytes = sensorlog::ChunkBytes(rows);
+            if (m_next + bytes > m_mapSize)
+                break; // Chunk still being written
+
+            const uint8_t *cols = p + sensorlog::kChunkHeaderSize;
+            SensorLogChunkView view;
+            view.rows = rows;
+            view.time = reinterpret_cast<const double *>(cols);
+            view.nodeId = reinterpret_cast<const uint32_t *>(cols + rows * 8);
+            view.vehicleCount = reinterpret_cast<const uint16_t *>(cols + rows * 12);
+            view.emergency = cols + rows * 14;
+            onChunk(view);
+
+            m_next += bytes;
+            rowsRead += rows;
+        }
+        return rowsRead;
+    }
+
+private:
+    // Maps the file at its current size; a no-op when it has not grown.
+    bool Remap() {
+        struct stat st;
+        if (::fstat(m_fd, &st) != 0)
+            return false;
+        size_t size = static_cast<size_t>(st.st_size);
+        if (size < m_next) {
+            m_next = sensorlog::kFileHeaderSize; // Rewritten by a new run
+        }
+        if (size == m_mapSize && m_map != nullptr)
+            return true;
+
+        Unmap();
+        if (size < sensorlog::kFileHeaderSize)
+            return false;
+        void *map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (map == MAP_FAILED)
+            return false;
+        uint32_t magic;
+        std::memcpy(&magic, map, 4);
+        if (magic != sensorlog::kFileMagic) {
+            ::munmap(map, size);
+            return false;
+        }
+        m_map = static_cast<const uint8_t *>(map);
+        m_mapSize = size;
+        return true;
+    }
+
+    void Unmap() {
+        if (m_map != nullptr) {
+            ::munmap(const_cast<uint8_t *>(m_map), m_mapSize);
+            m_map = nullptr;
+            m_mapSize = 0;
+        }
+    }
+
+    int m_fd;
+    const uint8_t *m_map;
+    size_t m_mapSize;
+    uint64_t m_next;
+};
+
+#endif // SENSOR_LOG_H
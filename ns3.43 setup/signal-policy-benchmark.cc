@@ -0,0 +1,326 @@
+// Signal control benchmark: runs the SUMO scenario headless once per
+// policy and compares them on the same demand. Each policy is fed ideal lane
+// sensors (SUMO's own vehicle count on every lane a light controls) once per
+// decision interval, and its decisions go back to SUMO through pipelined
+// TraCI commands. "static" keeps every light on the network's fixed-time
+// program (programID "0", switched to at start-up, as the SUMO config may
+// load other programs after it) as a baseline.
+//
+// Reported per policy: mean stopped delay per completed trip (vehicle-seconds
+// halted on the lights' approach lanes divided by arrivals), mean and max
+// queue (halted vehicles per approach lane) and throughput (arrivals/hour).
+//
+// With --warmup, the first warmup seconds are simulated once under program
+// "0" and saved as a SUMO state; every policy then starts from
+// that state and only the rest of the run is simulated and measured.
+//
+//   ./ns3 run "scratch/signal-policy-benchmark --sumoConfig=example.sumocfg --netFile=example.net.xml"
+
+#include "ns3/core-module.h"
+#include "signal-policy.h"
+#include "traci-batch.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("SignalPolicyBenchmark");
+
+struct PolicyStats {
+    std::string policy;
+    double haltedSeconds = 0.0;  // Vehicle-seconds halted on approach lanes
+    double queueSum = 0.0;       // Halted vehicles summed over approach lanes and steps
+    uint64_t steps = 0;
+    size_t approachLanes = 0;
+    uint32_t maxQueue = 0;       // Most halted vehicles seen on one approach lane
+    uint64_t arrived = 0;
+    uint64_t commands = 0;       // TraCI set commands issued by the policy
+    double simSeconds = 0.0;
+    double wallSeconds = 0.0;
+};
+
+// Starts SUMO listening for one TraCI client on port.
+static pid_t StartSumo(const std::string &binary, const std::string &config, uint16_t port, double endTime) {
+    std::string portArg = std::to_string(port);
+    std::string endArg = std::to_string(endTime);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execlp(binary.c_str(), binary.c_str(), "-c", config.c_str(), "--remote-port", portArg.c_str(), "--end",
+               endArg.c_str(), "--no-step-log", "true", "--verbose", "false", "--no-warnings", "true",
+               static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    return pid;
+}
+
+static bool ConnectWithRetry(TcpTraciTransport &transport, uint16_t port) {
+    for (int attempt = 0; attempt < 100; attempt++) {
+        if (transport.Connect("127.0.0.1", port))
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+
+// Queues switching every light to the network's own program.
+static void UseDefaultPrograms(TraciCommandBatch &batch, const std::map<std::string, SumoTrafficLight> &plans) {
+    for (const auto &entry : plans)
+        batch.SetTrafficLightProgram(entry.first, kSumoDefaultProgram);
+}
+
+// Runs SUMO to warmup seconds on program "0" and saves the state.
+static bool WarmUp(const std::map<std::string, SumoTrafficLight> &plans, const std::string &sumoBinary,
+                   const std::string &sumoConfig, uint16_t port, double simTime, double warmup,
+                   const std::string &stateFile) {
+    pid_t sumo = StartSumo(sumoBinary, sumoConfig, port, simTime);
+    TcpTraciTransport transport;
+    if (sumo < 0 || !ConnectWithRetry(transport, port)) {
+        std::cerr << "Could not start " << sumoBinary << " on port " << port << std::endl;
+        if (sumo > 0) {
+            kill(sumo, SIGTERM);
+            waitpid(sumo, nullptr, 0);
+        }
+        return false;
+    }
+    TraciCommandBatch batch;
+    bool saved = false;
+    UseDefaultPrograms(batch, plans);
+    batch.SimulationStep(warmup);
+    batch.SaveState(stateFile, [&saved](const TraciResult &r) { saved = r.ok; });
+    batch.Close();
+    bool ok = batch.Flush(transport) && saved;
+    transport.Close();
+    waitpid(sumo, nullptr, 0);
+    return ok;
+}
+
+static bool RunPolicy(const std::string &name, const std::map<std::string, SumoTrafficLight> &plans,
+                      const std::string &sumoBinary, const std::string &sumoConfig, uint16_t port, double simTime,
+                      double decisionInterval, const std::string &stateFile, PolicyStats &stats) {
+    std::unique_ptr<SignalControlPolicy> policy;
+    if (name != "static") {
+        policy = CreateSignalPolicy(name, decisionInterval);
+        if (!policy) {
+            std::cerr << "Unknown signal policy: " << name << std::endl;
+            return false;
+        }
+    }
+    stats.policy = name;
+
+    // Approach lanes are measured for delay and queues; the policies also
+    // see the lanes those approaches feed.
+    std::set<std::string> approachSet, laneSet;
+    for (const auto &entry : plans) {
+        for (size_t link = 0; link < entry.second.linkFrom.size(); link++) {
+            if (entry.second.linkFrom[link].empty())
+                continue;
+            approachSet.insert(entry.second.linkFrom[link]);
+            laneSet.insert(entry.second.linkFrom[link]);
+            laneSet.insert(entry.second.linkTo[link]);
+        }
+    }
+    std::vector<std::string> approaches(approachSet.begin(), approachSet.end());
+    std::vector<std::string> lanes(laneSet.begin(), laneSet.end());
+    stats.approachLanes = approaches.size();
+
+    pid_t sumo = StartSumo(sumoBinary, sumoConfig, port, simTime);
+    TcpTraciTransport transport;
+    if (sumo < 0 || !ConnectWithRetry(transport, port)) {
+        std::cerr << "Could not start " << sumoBinary << " on port " << port << std::endl;
+        if (sumo > 0) {
+            kill(sumo, SIGTERM);
+            waitpid(sumo, nullptr, 0);
+        }
+        return false;
+    }
+
+    TraciCommandBatch batch;
+    std::vector<int32_t> halted(approaches.size(), 0);
+    LaneReadings readings;
+    std::map<std::string, int32_t> phases;
+    std::map<std::string, PhaseClock> clocks;
+    std::map<std::string, std::string> programs;
+    double now = 0.0;
+    bool ok = true;
+    if (!stateFile.empty()) {
+        // The saved state already runs program "0"
+        batch.LoadState(stateFile, [&ok](const TraciResult &r) { ok = r.ok; });
+        batch.Get(traci::CMD_GET_SIM_VARIABLE, traci::VAR_TIME, "",
+                  [&now](const TraciResult &r) { now = r.value.doubleValue; });
+        ok = batch.Flush(transport) && ok;
+    } else {
+        UseDefaultPrograms(batch, plans);
+        ok = batch.Flush(transport);
+    }
+    for (const auto &entry : plans)
+        programs[entry.first] = kSumoDefaultProgram;
+    const double start = now;
+    double nextDecision = now + decisionInterval;
+
+    auto wallStart = std::chrono::steady_clock::now();
+    while (ok && now < simTime) {
+        // Advance one step and sample halted vehicles and arrivals
+        double previous = now;
+        batch.SimulationStep(0.0);
+        batch.Get(traci::CMD_GET_SIM_VARIABLE, traci::VAR_TIME, "",
+                  [&now](const TraciResult &r) { now = r.value.doubleValue; });
+        batch.Get(traci::CMD_GET_SIM_VARIABLE, traci::VAR_ARRIVED_VEHICLES_NUMBER, "",
+                  [&stats](const TraciResult &r) { stats.arrived += r.value.intValue; });
+        for (size_t i = 0; i < approaches.size(); i++) {
+            batch.Get(traci::CMD_GET_LANE_VARIABLE, traci::LAST_STEP_VEHICLE_HALTING_NUMBER, approaches[i],
+                      [&halted, i](const TraciResult &r) { halted[i] = r.value.intValue; });
+        }
+        ok = batch.Flush(transport) && now > previous;
+        for (int32_t h : halted) {
+            stats.haltedSeconds += h * (now - previous);
+            stats.queueSum += h;
+            stats.maxQueue = std::max<uint32_t>(stats.maxQueue, h);
+        }
+        stats.steps++;
+
+        if (!policy || now < nextDecision)
+            continue;
+        nextDecision += decisionInterval;
+
+        // Sensor snapshot: vehicles on every lane and each light's phase
+        for (const std::string &lane : lanes) {
+            batch.Get(traci::CMD_GET_LANE_VARIABLE, traci::LAST_STEP_VEHICLE_NUMBER, lane,
+                      [&readings, &lane](const TraciResult &r) { readings[lane].vehicles = r.value.intValue; });
+        }
+        if (policy->UsesPhases()) {
+            for (const auto &entry : plans) {
+                const std::string &id = entry.first;
+                batch.Get(traci::CMD_GET_TL_VARIABLE, traci::TL_CURRENT_PHASE, id,
+                          [&phases, &id](const TraciResult &r) { phases[id] = r.ok ? r.value.intValue : -1; });
+            }
+        }
+        ok = batch.Flush(transport);
+
+        // Decisions are queued and go out with the next step
+        for (const auto &entry : plans) {
+            const SumoTrafficLight &plan = entry.second;
+            SignalObservation obs;
+            obs.plan = &plan;
+            obs.lanes = &readings;
+            std::set<std::string> served(plan.linkFrom.begin(), plan.linkFrom.end());
+            for (const std::string &lane : served) {
+                if (!lane.empty())
+                    obs.totalVehicles += readings[lane].vehicles;
+            }
+            if (policy->UsesPhases()) {
+                obs.phase = phases[plan.id];
+                obs.timeInPhase = clocks[plan.id].Observe(obs.phase, now);
+            }
+            SignalDecision decision = policy->Decide(plan.id, obs);
+            if (!decision.program.empty() && decision.program != programs[plan.id]) {
+                batch.SetTrafficLightProgram(plan.id, decision.program);
+                programs[plan.id] = decision.program;
+                stats.commands++;
+            }
+            if (decision.phase >= 0) {
+                batch.SetTrafficLightPhase(plan.id, decision.phase);
+                clocks[plan.id].Observe(decision.phase, now);
+                stats.commands++;
+            }
+            if (decision.duration >= 0) {
+                batch.SetTrafficLightPhaseDuration(plan.id, decision.duration);
+                stats.commands++;
+            }
+        }
+    }
+    stats.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    stats.simSeconds = now - start;
+
+    batch.Close();
+    batch.Flush(transport);
+    transport.Close();
+    waitpid(sumo, nullptr, 0);
+    return stats.steps > 0;
+}
+
+int main(int argc, char *argv[]) {
+    std::string sumoConfig = "example.sumocfg";
+    std::string netFile = "example.net.xml";
+    std::string sumoBinary = "sumo";
+    std::string policies = "static,fixed-threshold,max-pressure,actuated";
+    double simTime = 3600.0;
+    double decisionInterval = 5.0;
+    double warmup = 0.0;
+    uint32_t port = 8873;
+    std::string outputDir = ".";
+
+    CommandLine cmd;
+    cmd.AddValue("sumoConfig", "SUMO configuration file", sumoConfig);
+    cmd.AddValue("netFile", "SUMO network with the lights' phase plans", netFile);
+    cmd.AddValue("sumoBinary", "SUMO executable (headless sumo recommended)", sumoBinary);
+    cmd.AddValue("policies", "Comma-separated policies to compare (static = the network's program \"0\")",
+                 policies);
+    cmd.AddValue("simTime", "Simulated seconds per policy", simTime);
+    cmd.AddValue("decisionInterval", "Seconds between policy decisions", decisionInterval);
+    cmd.AddValue("warmup", "Seconds simulated once under program \"0\" and shared by all policies", warmup);
+    cmd.AddValue("port", "First TraCI port; each policy run uses the next one", port);
+    cmd.AddValue("outputDir", "Directory for signal-policy-benchmark.json", outputDir);
+    cmd.Parse(argc, argv);
+
+    SumoNet net;
+    if (!net.Load(netFile) || net.TrafficLights().empty()) {
+        std::cerr << "No traffic lights in " << netFile << std::endl;
+        return 1;
+    }
+
+    std::string stateFile;
+    if (warmup > 0) {
+        stateFile = outputDir + "/warmup-state.xml";
+        if (!WarmUp(net.TrafficLights(), sumoBinary, sumoConfig, port++, simTime, warmup, stateFile)) {
+            std::cerr << "Warm-up to " << warmup << " s failed" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<PolicyStats> results;
+    std::istringstream names(policies);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        PolicyStats stats;
+        if (!RunPolicy(name, net.TrafficLights(), sumoBinary, sumoConfig, port + results.size(), simTime,
+                       decisionInterval, stateFile, stats))
+            return 1;
+        results.push_back(stats);
+    }
+
+    std::cout << "Signal policy benchmark: " << net.TrafficLights().size() << " lights, " << simTime - warmup
+              << " s" << (warmup > 0 ? " after a shared warm-up" : "") << ", decisions every "
+              << decisionInterval << " s" << std::endl;
+    std::ofstream json((outputDir + "/signal-policy-benchmark.json").c_str());
+    json << "[";
+    for (size_t i = 0; i < results.size(); i++) {
+        const PolicyStats &r = results[i];
+        double meanDelay = r.arrived ? r.haltedSeconds / r.arrived : 0.0;
+        double meanQueue = r.steps ? r.queueSum / (r.steps * std::max<size_t>(r.approachLanes, 1)) : 0.0;
+        double throughput = r.simSeconds > 0 ? 3600.0 * r.arrived / r.simSeconds : 0.0;
+        std::cout << "  " << r.policy << ": delay " << meanDelay << " s/veh, queue mean " << meanQueue
+                  << " max " << r.maxQueue << " veh/lane, throughput " << throughput << " veh/h, "
+                  << r.commands << " commands, " << r.simSeconds / std::max(r.wallSeconds, 1e-9)
+                  << " sim-s/wall-s" << std::endl;
+        json << (i ? ", " : "") << "{\"policy\": \"" << r.policy << "\""
+             << ", \"meanStoppedDelaySeconds\": " << meanDelay
+             << ", \"meanLaneQueue\": " << meanQueue
+             << ", \"maxLaneQueue\": " << r.maxQueue
+             << ", \"arrived\": " << r.arrived
+             << ", \"throughputVehPerHour\": " << throughput
+             << ", \"commands\": " << r.commands
+             << ", \"simSeconds\": " << r.simSeconds
+             << ", \"wallSeconds\": " << r.wallSeconds << "}";
+    }
+    json << "]" << std::endl;
+    return 0;
+}
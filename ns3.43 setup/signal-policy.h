@@ -0,0 +1,291 @@
+#ifndef SIGNAL_POLICY_H
+#define SIGNAL_POLICY_H
+
+// Traffic signal control policies. A policy decides for one light at a time
+// from what the sensors report: the vehicle count and emergency flag summed
+// over the light's junctions, and, for the adaptive policies, the latest
+// count on every lane the light controls together with its phase plan from
+// the SUMO network and the phase it is currently in.
+//
+// Policies never talk to SUMO themselves. The ns-3 controllers
+// (traffic-control.h) and the standalone benchmark
+// (signal-policy-benchmark.cc) turn decisions into TraCI commands, so both
+// run the same policy code.
+
+#include "sumo-net.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct LaneReading {
+    uint32_t vehicles = 0;
+    bool emergency = false;
+};
+
+using LaneReadings = std::map<std::string, LaneReading>;
+
+// What a policy sees of one light at a control tick.
+struct SignalObservation {
+    const SumoTrafficLight *plan = nullptr;  // Null when no network was loaded
+    int32_t phase = -1;                      // Current phase index, -1 if unknown
+    double timeInPhase = 0.0;                // Seconds since the phase began, to within a control tick
+    uint32_t totalVehicles = 0;              // Summed over the light's junctions
+    bool emergency = false;                  // Reported on any of the light's junctions
+    const LaneReadings *lanes = nullptr;     // Null when sensors are not mapped to lanes
+};
+
+struct SignalDecision {
+    std::string program;    // Program to run; empty keeps the current one
+    int32_t phase = -1;     // Phase to jump to; -1 stays in the current one
+    double duration = -1;   // Remaining seconds of the current phase; negative leaves it alone
+    bool emergency = false; // The light is being driven for an emergency vehicle
+};
+
+// Time since each light's current phase began, from phase indices sampled
+// once per control tick. A change seen at a tick is taken to have happened
+// at that tick.
+struct PhaseClock {
+    int32_t phase = -1;
+    double start = 0.0;
+
+    double Observe(int32_t current, double now) {
+        if (current != phase) {
+            phase = current;
+            start = now;
+        }
+        return now - start;
+    }
+};
+
+class SignalControlPolicy {
+public:
+    virtual ~SignalControlPolicy() {}
+    virtual const char *Name() const = 0;
+    // True if Decide() needs the phase plan, current phase and lane counts.
+    virtual bool UsesPhases() const = 0;
+    virtual SignalDecision Decide(const std::string &tlsId, const SignalObservation &obs) = 0;
+};
+
+// The original controller: one of four named programs (see tll.xml) picked
+// from the light's total vehicle count.
+class FixedThresholdPolicy : public SignalControlPolicy {
+public:
+    FixedThresholdPolicy(uint32_t heavyAbove = 8, uint32_t lightBelow = 3)
+        : m_heavyAbove(heavyAbove), m_lightBelow(lightBelow) {}
+
+    const char *Name() const override { return "fixed-threshold"; }
+    bool UsesPhases() const override { return false; }
+
+    SignalDecision Decide(const std::string &, const SignalObservation &obs) override {
+        SignalDecision decision;
+        decision.emergency = obs.emergency;
+        if (obs.emergency) {
+            decision.program = "emergency";
+        } else if (obs.totalVehicles > m_heavyAbove) {
+            decision.program = "heavy_traffic";
+        } else if (obs.totalVehicles < m_lightBelow) {
+            decision.program = "light_traffic";
+        } else {
+            decision.program = "normal";
+        }
+        return decision;
+    }
+
+private:
+    uint32_t m_heavyAbove;
+    uint32_t m_lightBelow;
+};
+
+// Common ground for the policies that set phase durations on the light's
+// own program. They only ever shorten or extend green phases, so the phase
+// order and every yellow/all-red transition of the program are kept.
+class PhaseTimingPolicy : public SignalControlPolicy {
+public:
+    PhaseTimingPolicy(double minGreen, double maxGreen) : m_minGreen(minGreen), m_maxGreen(maxGreen) {}
+
+    bool UsesPhases() const override { return true; }
+
+protected:
+    static uint32_t Vehicles(const LaneReadings &lanes, const std::string &lane) {
+        auto it = lanes.find(lane);
+        return it == lanes.end() ? 0 : it->second.vehicles;
+    }
+
+    // Incoming lanes given green in a phase, each with its outgoing lanes.
+    static std::vector<std::pair<std::string, std::vector<std::string>>> Movements(const SumoTrafficLight &plan,
+                                                                                  int32_t phase) {
+        std::vector<std::pair<std::string, std::vector<std::string>>> movements;
+        const std::string &state = plan.phases[phase].state;
+        for (size_t link = 0; link < state.size() && link < plan.linkFrom.size(); link++) {
+            if ((state[link] != 'G' && state[link] != 'g') || plan.linkFrom[link].empty())
+                continue;
+            auto it = std::find_if(movements.begin(), movements.end(),
+                                   [&](const std::pair<std::string, std::vector<std::string>> &m) {
+                                       return m.first == plan.linkFrom[link];
+                                   });
+            if (it == movements.end()) {
+                movements.emplace_back(plan.linkFrom[link], std::vector<std::string>());
+                it = movements.end() - 1;
+            }
+            it->second.push_back(plan.linkTo[link]);
+        }
+        return movements;
+    }
+
+    // Vehicles waiting on the lanes a phase serves.
+    static double Queue(const SumoTrafficLight &plan, int32_t phase, const LaneReadings &lanes) {
+        double queue = 0.0;
+        for (const auto &movement : Movements(plan, phase))
+            queue += Vehicles(lanes, movement.first);
+        return queue;
+    }
+
+    // Ends green phases that do not serve a lane reporting an emergency and
+    // holds the one that does. Returns false when there is no emergency.
+    bool Preempt(const SignalObservation &obs, SignalDecision &decision) const {
+        const SumoTrafficLight &plan = *obs.plan;
+        bool any = false;
+        bool served = false;
+        for (size_t link = 0; link < plan.linkFrom.size(); link++) {
+            auto it = obs.lanes->find(plan.linkFrom[link]);
+            if (it == obs.lanes->end() || !it->second.emergency)
+                continue;
+            any = true;
+            const std::string &state = plan.phases[obs.phase].state;
+            served = served || (link < state.size() && (state[link] == 'G' || state[link] == 'g'));
+        }
+        if (!any)
+            return false;
+        decision.emergency = true;
+        if (plan.phases[obs.phase].IsGreen())
+            decision.duration = served ? m_maxGreen : 0.0;
+        return true;
+    }
+
+    // True if the observation carries everything the policy needs and the
+    // light is in a green phase.
+    static bool InGreen(const SignalObservation &obs) {
+        return obs.plan != nullptr && obs.lanes != nullptr && obs.phase >= 0 &&
+               obs.phase < static_cast<int32_t>(obs.plan->phases.size()) && obs.plan->phases[obs.phase].IsGreen();
+    }
+
+    double m_minGreen;
+    double m_maxGreen;
+};
+
+// Max-pressure: keeps the current green while its pressure (vehicles on the
+// lanes it serves minus those on the lanes they feed) is the highest of all
+// green phases, and ends it as soon as another phase's is higher. Since the
+// phase order is kept, this is the cyclic variant: a phase with no demand
+// still gets its minimum green when its turn comes.
+class MaxPressurePolicy : public PhaseTimingPolicy {
+public:
+    MaxPressurePolicy(double decisionInterval, double minGreen = 5.0, double maxGreen = 60.0)
+        : PhaseTimingPolicy(minGreen, maxGreen), m_extension(decisionInterval) {}
+
+    const char *Name() const override { return "max-pressure"; }
+
+    SignalDecision Decide(const std::string &, const SignalObservation &obs) override {
+        SignalDecision decision;
+        if (!InGreen(obs) || Preempt(obs, decision) || obs.timeInPhase < m_minGreen)
+            return decision;
+        const SumoTrafficLight &plan = *obs.plan;
+        double current = Pressure(plan, obs.phase, *obs.lanes);
+        double best = current;
+        for (size_t p = 0; p < plan.phases.size(); p++) {
+            if (static_cast<int32_t>(p) != obs.phase && plan.phases[p].IsGreen())
+                best = std::max(best, Pressure(plan, p, *obs.lanes));
+        }
+        if (current < best || obs.timeInPhase >= m_maxGreen) {
+            decision.duration = 0.0;
+        } else if (current > 0) {
+            // Hold until the next decision, never past the maximum green
+            decision.duration = std::min(m_extension, m_maxGreen - obs.timeInPhase);
+        }
+        return decision;
+    }
+
+private:
+    static double Pressure(const SumoTrafficLight &plan, int32_t phase, const LaneReadings &lanes) {
+        double pressure = 0.0;
+        for (const auto &movement : Movements(plan, phase)) {
+            double downstream = 0.0;
+            for (const std::string &out : movement.second)
+                downstream += Vehicles(lanes, out);
+            pressure += Vehicles(lanes, movement.first) - downstream / movement.second.size();
+        }
+        return pressure;
+    }
+
+    double m_extension;
+};
+
+// Actuated, queue-proportional green split: when a green phase begins, its
+// length is set to the minimum green plus its share of the program's spare
+// green time in proportion to the vehicles queued on the lanes it serves;
+// it gaps out early once those lanes are empty while others are waiting.
+class ActuatedPolicy : public PhaseTimingPolicy {
+public:
+    ActuatedPolicy(double minGreen = 5.0, double maxGreen = 60.0) : PhaseTimingPolicy(minGreen, maxGreen) {}
+
+    const char *Name() const override { return "actuated"; }
+
+    SignalDecision Decide(const std::string &tlsId, const SignalObservation &obs) override {
+        SignalDecision decision;
+        if (!InGreen(obs)) {
+            m_split.erase(tlsId);
+            return decision;
+        }
+        if (Preempt(obs, decision)) {
+            m_split.erase(tlsId);
+            return decision;
+        }
+        const SumoTrafficLight &plan = *obs.plan;
+        double cycleGreen = 0.0;
+        double totalQueue = 0.0;
+        uint32_t greens = 0;
+        for (size_t p = 0; p < plan.phases.size(); p++) {
+            if (!plan.phases[p].IsGreen())
+                continue;
+            cycleGreen += plan.phases[p].duration;
+            totalQueue += Queue(plan, p, *obs.lanes);
+            greens++;
+        }
+        double queue = Queue(plan, obs.phase, *obs.lanes);
+
+        auto split = m_split.find(tlsId);
+        bool started = split == m_split.end() || split->second.first != obs.phase ||
+                       obs.timeInPhase < split->second.second;
+        m_split[tlsId] = std::make_pair(obs.phase, obs.timeInPhase);
+        if (started) {
+            if (totalQueue > 0) {
+                double spare = std::max(0.0, cycleGreen - greens * m_minGreen);
+                double green = std::min(m_maxGreen, m_minGreen + spare * queue / totalQueue);
+                decision.duration = std::max(0.0, green - obs.timeInPhase);
+            }
+        } else if (queue == 0 && totalQueue > 0 && obs.timeInPhase >= m_minGreen) {
+            decision.duration = 0.0;  // Gap out
+        }
+        return decision;
+    }
+
+private:
+    std::map<std::string, std::pair<int32_t, double>> m_split;  // Phase and time in it at the last decision
+};
+
+// Builds a policy by name; returns null for unknown names.
+inline std::unique_ptr<SignalControlPolicy> CreateSignalPolicy(const std::string &name, double decisionInterval) {
+    if (name == "fixed-threshold")
+        return std::unique_ptr<SignalControlPolicy>(new FixedThresholdPolicy());
+    if (name == "max-pressure")
+        return std::unique_ptr<SignalControlPolicy>(new MaxPressurePolicy(decisionInterval));
+    if (name == "actuated")
+        return std::unique_ptr<SignalControlPolicy>(new ActuatedPolicy());
+    return nullptr;
+}
+
+#endif // SIGNAL_POLICY_H
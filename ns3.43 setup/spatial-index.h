@@ -0,0 +1,213 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+// Uniform-grid nearest-neighbour index over 2-D points (all WSN nodes sit at
+// z = 0). Points are cached once in structure-of-arrays form, bucketed by
+// cell in a compressed (CSR) layout so every cell is a contiguous run, and
+// queried by expanding square rings of cells around the query point.
+//
+// Ties are broken towards the lower point index, so Nearest() returns the
+// same answer as a linear scan that keeps the first strictly smaller distance.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+class GridSpatialIndex {
+public:
+    GridSpatialIndex() : m_minX(0), m_minY(0), m_cellSize(1), m_cols(0), m_rows(0) {}
+
+    // Indexes points (xs[i], ys[i]); i is the ID returned by queries. A
+    // cellSize <= 0 picks one that averages about one point per cell.
+    void Build(const std::vector<double> &xs, const std::vector<double> &ys, double cellSize = 0.0) {
+        uint32_t n = static_cast<uint32_t>(std::min(xs.size(), ys.size()));
+        m_x.assign(n, 0.0);
+        m_y.assign(n, 0.0);
+        m_ids.assign(n, 0);
+        m_cellStart.clear();
+        m_cols = m_rows = 0;
+        if (n == 0)
+            return;
+
+        double maxX = xs[0], maxY = ys[0];
+        m_minX = xs[0];
+        m_minY = ys[0];
+        for (uint32_t i = 1; i < n; i++) {
+            m_minX = std::min(m_minX, xs[i]);
+            m_minY = std::min(m_minY, ys[i]);
+            maxX = std::max(maxX, xs[i]);
+            maxY = std::max(maxY, ys[i]);
+        }
+        double width = std::max(maxX - m_minX, 1e-9);
+        double height = std::max(maxY - m_minY, 1e-9);
+        if (cellSize <= 0.0)
+            cellSize = std::sqrt(width * height / n);
+        // Keep the grid at most ~4 cells per point, whatever the caller asked for.
+        cellSize = std::max(cellSize, std::sqrt(width * height / (4.0 * n)));
+        m_cellSize = std::max(cellSize, 1e-9);
+        m_cols = static_cast<uint32_t>(width / m_cellSize) + 1;
+        m_rows = static_cast<uint32_t>(height / m_cellSize) + 1;
+
+        // Counting sort of points into cells.
+        std::vector<uint32_t> cellOf(n);
+        m_cellStart.assign(static_cast<size_t>(m_cols) * m_rows + 1, 0);
+        for (uint32_t i = 0; i < n; i++) {
+            cellOf[i] = CellIndex(ColOf(xs[i]), RowOf(ys[i]));
+            m_cellStart[cellOf[i] + 1]++;
+        }
+        for (size_t c = 1; c < m_cellStart.size(); c++)
+            m_cellStart[c] += m_cellStart[c - 1];
+        std::vector<uint32_t> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t slot = fill[cellOf[i]]++;
+            m_x[slot] = xs[i];
+            m_y[slot] = ys[i];
+            m_ids[slot] = i;
+        }
+    }
+
+    uint32_t Size() const { return static_cast<uint32_t>(m_ids.size()); }
+
+    // Returns the ID of the closest point, or -1 if the index is empty.
+    int64_t Nearest(double x, double y) const {
+        if (m_ids.empty())
+            return -1;
+
+        double bestD2 = std::numeric_limits<double>::max();
+        uint32_t bestId = std::numeric_limits<uint32_t>::max();
+        int64_t cx = ClampedCol(x), cy = ClampedRow(y);
+        for (int64_t r = 0;; r++) {
+            VisitRing(cx, cy, r, [&](uint32_t slot) {
+                double d2 = Dist2(slot, x, y);
+                if (d2 < bestD2 || (d2 == bestD2 && m_ids[slot] < bestId)) {
+                    bestD2 = d2;
+                    bestId = m_ids[slot];
+                }
+            });
+            if (RingCoversGrid(cx, cy, r))
+                break;
+            double bound = UnsearchedDistance(x, y, cx, cy, r);
+            if (bound * bound > bestD2)
+                break;
+        }
+        return bestId;
+    }
+
+    // Fills out with the IDs of the k closest points, nearest first.
+    void KNearest(double x, double y, uint32_t k, std::vector<uint32_t> &out) const {
+        out.clear();
+        if (m_ids.empty() || k == 0)
+            return;
+
+        // Max-heap on (distance, id) holding the best k seen so far.
+        std::priority_queue<std::pair<double, uint32_t>> best;
+        int64_t cx = ClampedCol(x), cy = ClampedRow(y);
+        for (int64_t r = 0;; r++) {
+            VisitRing(cx, cy, r, [&](uint32_t slot) {
+                std::pair<double, uint32_t> cand(Dist2(slot, x, y), m_ids[slot]);
+                if (best.size() < k) {
+                    best.push(cand);
+                } else if (cand < best.top()) {
+                    best.pop();
+                    best.push(cand);
+                }
+            });
+            if (RingCoversGrid(cx, cy, r))
+                break;
+            double bound = UnsearchedDistance(x, y, cx, cy, r);
+            if (best.size() == k && bound * bound > best.top().first)
+                break;
+        }
+        out.resize(best.size());
+        for (size_t i = out.size(); i-- > 0;) {
+            out[i] = best.top().second;
+            best.pop();
+        }
+    }
+
+    // Fills out with the IDs of all points within radius of (x, y), unordered.
+    void WithinRadius(double x, double y, double radius, std::vector<uint32_t> &out) const {
+        out.clear();
+        if (m_ids.empty() || radius < 0)
+            return;
+
+        double r2 = radius * radius;
+        int64_t c0 = ClampedCol(x - radius), c1 = ClampedCol(x + radius);
+        int64_t r0 = ClampedRow(y - radius), r1 = ClampedRow(y + radius);
+        for (int64_t row = r0; row <= r1; row++) {
+            for (int64_t col = c0; col <= c1; col++) {
+                uint32_t cell = CellIndex(col, row);
+                for (uint32_t s = m_cellStart[cell]; s < m_cellStart[cell + 1]; s++) {
+                    if (Dist2(s, x, y) <= r2)
+                        out.push_back(m_ids[s]);
+                }
+            }
+        }
+    }
+
+private:
+    int64_t ColOf(double x) const { return static_cast<int64_t>((x - m_minX) / m_cellSize); }
+    int64_t RowOf(double y) const { return static_cast<int64_t>((y - m_minY) / m_cellSize); }
+    int64_t ClampedCol(double x) const {
+        return std::min<int64_t>(std::max<int64_t>(x < m_minX ? 0 : ColOf(x), 0), m_cols - 1);
+    }
+    int64_t ClampedRow(double y) const {
+        return std::min<int64_t>(std::max<int64_t>(y < m_minY ? 0 : RowOf(y), 0), m_rows - 1);
+    }
+    uint32_t CellIndex(int64_t col, int64_t row) const { return static_cast<uint32_t>(row * m_cols + col); }
+
+    double Dist2(uint32_t slot, double x, double y) const {
+        double dx = m_x[slot] - x;
+        double dy = m_y[slot] - y;
+        return dx * dx + dy * dy;
+    }
+
+    // Calls visit(slot) for every point in the cells at Chebyshev distance r
+    // from cell (cx, cy).
+    template <typename F>
+    void VisitRing(int64_t cx, int64_t cy, int64_t r, F &&visit) const {
+        int64_t row0 = std::max<int64_t>(cy - r, 0), row1 = std::min<int64_t>(cy + r, m_rows - 1);
+        for (int64_t row = row0; row <= row1; row++) {
+            bool edgeRow = (row == cy - r || row == cy + r);
+            int64_t step = edgeRow ? 1 : 2 * r;
+            for (int64_t col = cx - r; col <= cx + r; col += (step > 0 ? step : 1)) {
+                if (col < 0 || col >= m_cols)
+                    continue;
+                uint32_t cell = CellIndex(col, row);
+                for (uint32_t s = m_cellStart[cell]; s < m_cellStart[cell + 1]; s++)
+                    visit(s);
+            }
+        }
+    }
+
+    bool RingCoversGrid(int64_t cx, int64_t cy, int64_t r) const {
+        return cx - r <= 0 && cy - r <= 0 && cx + r >= m_cols - 1 && cy + r >= m_rows - 1;
+    }
+
+    // Lower bound on the distance from (x, y) to any cell outside rings 0..r.
+    double UnsearchedDistance(double x, double y, int64_t cx, int64_t cy, int64_t r) const {
+        double left = m_minX + (cx - r) * m_cellSize;
+        double right = m_minX + (cx + r + 1) * m_cellSize;
+        double bottom = m_minY + (cy - r) * m_cellSize;
+        double top = m_minY + (cy + r + 1) * m_cellSize;
+        if (x < left || x > right || y < bottom || y > top)
+            return 0.0;
+        return std::min(std::min(x - left, right - x), std::min(y - bottom, top - y));
+    }
+
+    std::vector<double> m_x;            // Point coordinates, ordered by cell
+    std::vector<double> m_y;
+    std::vector<uint32_t> m_ids;        // Caller's point index for each slot
+    std::vector<uint32_t> m_cellStart;  // Slots of cell c are [m_cellStart[c], m_cellStart[c + 1])
+    double m_minX;
+    double m_minY;
+    double m_cellSize;
+    int64_t m_cols;
+    int64_t m_rows;
+};
+
+#endif // SPATIAL_INDEX_H
@@ -0,0 +1,78 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+// Bounded lock-free single-producer/single-consumer ring. One thread may
+// call Push() and one (possibly the same) thread may call Pop(); neither
+// blocks. Head and tail sit on separate cache lines, and each side keeps a
+// cached copy of the other's index so the shared atomics are only re-read
+// when the ring looks full (producer) or empty (consumer).
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+template <typename T>
+class SpscRing {
+public:
+    // Capacity is rounded up to a power of two.
+    explicit SpscRing(size_t capacity = 1024)
+        : m_head(0), m_cachedTail(0), m_tail(0), m_cachedHead(0), m_dropped(0) {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    size_t Capacity() const { return m_slots.size(); }
+
+    // Producer side. Returns false (and counts a drop) when the ring is full.
+    bool Push(const T &value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == m_slots.size()) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == m_slots.size()) {
+                m_dropped++;
+                return false;
+            }
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when the ring is empty.
+    bool Pop(T &value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail)
+                return false;
+        }
+        value = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with Push/Pop.
+    size_t Size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    // Pushes rejected because the ring was full (producer side only).
+    uint64_t Dropped() const { return m_dropped; }
+
+private:
+    std::vector<T> m_slots;
+    size_t m_mask;
+
+    alignas(64) std::atomic<size_t> m_head;  // Next slot to pop; written by the consumer
+    size_t m_cachedTail;                     // Consumer's copy of m_tail
+
+    alignas(64) std::atomic<size_t> m_tail;  // Next slot to fill; written by the producer
+    size_t m_cachedHead;                     // Producer's copy of m_head
+    uint64_t m_dropped;
+};
+
+#endif // SPSC_RING_H
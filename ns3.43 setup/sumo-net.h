@@ -0,0 +1,223 @@
+#ifndef SUMO_NET_H
+#define SUMO_NET_H
+
+// Minimal reader for the parts of a SUMO network the WSN needs to place
+// sensors: junctions (position, type, incoming lanes), non-internal lane
+// shapes, and E1 induction loops (<inductionLoop id lane pos/>) from an
+// additional file. Also reads each traffic light's default program and the
+// lanes behind its link indices, for the signal control policies. Expects
+// netconvert's one-element-per-line layout.
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SumoJunction {
+    std::string id;
+    std::string type;
+    double x;
+    double y;
+    std::vector<std::string> incLanes;
+};
+
+struct SumoLane {
+    std::string id;
+    std::vector<std::pair<double, double>> shape;
+    double length;
+};
+
+// Program ID netconvert gives each light's own plan, the one read here. Extra
+// programs loaded from additional files replace it as the running program
+// (SUMO runs the last one loaded), so controllers switch to it explicitly.
+const std::string kSumoDefaultProgram = "0";
+
+struct SumoPhase {
+    double duration;
+    std::string state;  // One signal character per link index
+
+    bool IsGreen() const { return state.find_first_of("Gg") != std::string::npos; }
+};
+
+// A traffic light's default (programID "0") phases and, per link index, the
+// incoming and outgoing lane of the connection it controls.
+struct SumoTrafficLight {
+    std::string id;
+    std::vector<SumoPhase> phases;
+    std::vector<std::string> linkFrom;
+    std::vector<std::string> linkTo;
+};
+
+struct SumoDetector {
+    std::string id;
+    std::string lane;
+    double pos;  // Metres from the lane start; negative counts from the end
+};
+
+class SumoNet {
+public:
+    bool Load(const std::string &netFile) {
+        std::ifstream in(netFile.c_str());
+        if (!in.is_open())
+            return false;
+        std::string line, value;
+        SumoTrafficLight *program = nullptr;  // Light whose <phase> lines are being read
+        while (std::getline(in, line)) {
+            if (line.find("<tlLogic ") != std::string::npos) {
+                std::string id;
+                program = nullptr;
+                if (ReadAttribute(line, "id", id) && ReadAttribute(line, "programID", value) &&
+                    value == kSumoDefaultProgram)
+                    program = &TrafficLight(id);
+            } else if (line.find("</tlLogic>") != std::string::npos) {
+                program = nullptr;
+            } else if (line.find("<phase ") != std::string::npos) {
+                SumoPhase phase;
+                if (program != nullptr && ReadAttribute(line, "state", phase.state)) {
+                    phase.duration = ReadAttribute(line, "duration", value) ? std::stod(value) : 0.0;
+                    program->phases.push_back(phase);
+                }
+            } else if (line.find("<connection ") != std::string::npos) {
+                std::string tl, from, to, fromLane, toLane;
+                if (!ReadAttribute(line, "tl", tl) || !ReadAttribute(line, "linkIndex", value) ||
+                    !ReadAttribute(line, "from", from) || !ReadAttribute(line, "to", to) ||
+                    !ReadAttribute(line, "fromLane", fromLane) || !ReadAttribute(line, "toLane", toLane))
+                    continue;
+                SumoTrafficLight &light = TrafficLight(tl);
+                size_t index = std::stoul(value);
+                if (index >= light.linkFrom.size()) {
+                    light.linkFrom.resize(index + 1);
+                    light.linkTo.resize(index + 1);
+                }
+                light.linkFrom[index] = from + "_" + fromLane;
+                light.linkTo[index] = to + "_" + toLane;
+            } else if (line.find("<junction ") != std::string::npos) {
+                SumoJunction junction;
+                if (!ReadAttribute(line, "id", junction.id) || !ReadAttribute(line, "type", junction.type) ||
+                    junction.type == "internal")
+                    continue;
+                junction.x = ReadAttribute(line, "x", value) ? std::stod(value) : 0.0;
+                junction.y = ReadAttribute(line, "y", value) ? std::stod(value) : 0.0;
+                if (ReadAttribute(line, "incLanes", value)) {
+                    std::istringstream lanes(value);
+                    std::string lane;
+                    while (lanes >> lane) {
+                        junction.incLanes.push_back(lane);
+                    }
+                }
+                m_junctions.push_back(junction);
+            } else if (line.find("<lane ") != std::string::npos) {
+                SumoLane lane;
+                if (!ReadAttribute(line, "id", lane.id) || lane.id.empty() || lane.id[0] == ':')
+                    continue;
+                lane.length = ReadAttribute(line, "length", value) ? std::stod(value) : 0.0;
+                if (ReadAttribute(line, "shape", value)) {
+                    std::istringstream points(value);
+                    std::string point;
+                    while (points >> point) {
+                        size_t comma = point.find(',');
+                        if (comma != std::string::npos) {
+                            lane.shape.emplace_back(std::stod(point.substr(0, comma)),
+                                                    std::stod(point.substr(comma + 1)));
+                        }
+                    }
+                }
+                m_laneIndex[lane.id] = m_lanes.size();
+                m_lanes.push_back(lane);
+            }
+        }
+        return true;
+    }
+
+    bool LoadDetectors(const std::string &additionalFile) {
+        std::ifstream in(additionalFile.c_str());
+        if (!in.is_open())
+            return false;
+        std::string line, value;
+        while (std::getline(in, line)) {
+            if (line.find("<inductionLoop ") == std::string::npos && line.find("<e1Detector ") == std::string::npos)
+                continue;
+            SumoDetector detector;
+            if (ReadAttribute(line, "id", detector.id) && ReadAttribute(line, "lane", detector.lane) &&
+                ReadAttribute(line, "pos", value)) {
+                detector.pos = std::stod(value);
+                m_detectors.push_back(detector);
+            }
+        }
+        return true;
+    }
+
+    const std::vector<SumoJunction> &Junctions() const { return m_junctions; }
+    const std::vector<SumoDetector> &Detectors() const { return m_detectors; }
+    const std::map<std::string, SumoTrafficLight> &TrafficLights() const { return m_trafficLights; }
+
+    const SumoLane *FindLane(const std::string &id) const {
+        auto it = m_laneIndex.find(id);
+        return it == m_laneIndex.end() ? nullptr : &m_lanes[it->second];
+    }
+
+    // Point pos metres along the lane (negative: from its end), clamped to
+    // the lane. Returns false for unknown or shapeless lanes.
+    bool PointOnLane(const std::string &laneId, double pos, double &x, double &y) const {
+        const SumoLane *lane = FindLane(laneId);
+        if (lane == nullptr || lane->shape.empty())
+            return false;
+        double total = 0.0;
+        for (size_t i = 1; i < lane->shape.size(); i++)
+            total += Distance(lane->shape[i - 1], lane->shape[i]);
+        double target = pos < 0 ? total + pos : pos;
+        target = std::max(0.0, std::min(target, total));
+
+        x = lane->shape[0].first;
+        y = lane->shape[0].second;
+        for (size_t i = 1; i < lane->shape.size(); i++) {
+            double segment = Distance(lane->shape[i - 1], lane->shape[i]);
+            if (target <= segment && segment > 0) {
+                double f = target / segment;
+                x = lane->shape[i - 1].first + f * (lane->shape[i].first - lane->shape[i - 1].first);
+                y = lane->shape[i - 1].second + f * (lane->shape[i].second - lane->shape[i - 1].second);
+                return true;
+            }
+            target -= segment;
+            x = lane->shape[i].first;
+            y = lane->shape[i].second;
+        }
+        return true;
+    }
+
+private:
+    SumoTrafficLight &TrafficLight(const std::string &id) {
+        SumoTrafficLight &light = m_trafficLights[id];
+        light.id = id;
+        return light;
+    }
+
+    static double Distance(const std::pair<double, double> &a, const std::pair<double, double> &b) {
+        return std::hypot(b.first - a.first, b.second - a.second);
+    }
+
+    static bool ReadAttribute(const std::string &line, const char *name, std::string &value) {
+        std::string key = std::string(" ") + name + "=\"";
+        size_t start = line.find(key);
+        if (start == std::string::npos)
+            return false;
+        start += key.size();
+        size_t end = line.find('"', start);
+        if (end == std::string::npos)
+            return false;
+        value = line.substr(start, end - start);
+        return true;
+    }
+
+    std::vector<SumoJunction> m_junctions;
+    std::vector<SumoLane> m_lanes;
+    std::map<std::string, size_t> m_laneIndex;
+    std::vector<SumoDetector> m_detectors;
+    std::map<std::string, SumoTrafficLight> m_trafficLights;
+};
+
+#endif // SUMO_NET_H
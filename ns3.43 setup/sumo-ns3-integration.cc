@@ -4,10 +4,16 @@
 #include "ns3/applications-module.h"
 #include "ns3/mobility-module.h"
 #include "ns3/traci-module.h"  // Use actual TraCI module
+#include "sensor-log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <map>
+#include <memory>
+#include <utility>
 #include <sstream>
 #include <vector>
 
@@ -15,112 +21,239 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("SUMONs3Integration");
 
-// Data structure including an emergency flag.
-struct TrafficData {
-  uint32_t vehicleCount;
-  bool emergency;
-};
+#include "sumo-net.h"
+#include "traffic-control.h"
 
-std::map<std::string, TrafficData> junctionTrafficData;
+JunctionStateStore junctionState;  // Recent readings per junction, read by the controller
 std::ifstream trafficSensorFile;
+BinarySensorLogReader binarySensorLog;
+bool binarySensorInput = false;  // Set when the sensor file is a binary sensor log
 std::string sumoConfig;
 bool usingGui = true;
 double stepLength = 0.1;  // SUMO step length in seconds
+uint64_t sumoSteps = 0;   // SUMO steps seen by the callback, for throughput stats
+
+// Incremental reader state for the sensor log. The WSN side only ever appends
+// rows, so each tick resumes from the last consumed byte (CSV) or chunk
+// (binary log) and parses just the new tail instead of re-reading the whole file.
+struct SensorFileTail {
+  std::streamoff offset = 0;           // First byte not yet read from the file
+  bool headerSkipped = false;
+  std::vector<char> buffer;            // Reused read buffer; carries a partial trailing line between ticks
+  std::vector<TrafficData> latest;     // Latest sample per node, indexed by node ID
+  std::vector<uint32_t> touched;       // Nodes updated during the current tick
+  uint32_t nodeLimit = 1 << 20;        // Rows with node IDs from here on are skipped (sensor map size, if given)
+  uint64_t rejected = 0;               // Rows skipped for their node ID during the current tick
+};
 
-void ReadTrafficSensorData()
+SensorFileTail sensorFileTail;
+
+// Junction <-> sensor mapping from generate_grid.py's sensor_map.csv. When
+// no map was given, junctionSensors stays empty and node N reports for
+// junction "JN", interned the first time the node is read.
+std::vector<int32_t> sensorJunction;                          // Junction ID of each RFD (-1: none), by node ID
+std::vector<std::vector<uint32_t>> junctionSensors;           // RFDs on each junction's approach lanes, by ID
+std::vector<std::string> sensorLane;                          // Lane of each RFD, indexed by node ID
+std::map<std::string, std::vector<uint32_t>> laneSensors;      // RFDs on each lane
+LaneReadings laneReadings;                                     // Latest readings summed per lane
+
+bool LoadSensorMap(const std::string &path)
 {
+  std::ifstream in(path.c_str());
+  if (!in.is_open()) {
+    return false;
+  }
   std::string line;
-  std::map<uint32_t, TrafficData> latestTrafficData;
+  std::getline(in, line);  // Header: NodeID,Role,X,Y,Parent,Junction,Lane
+  while (std::getline(in, line)) {
+    std::vector<std::string> fields;
+    std::istringstream row(line);
+    std::string field;
+    while (std::getline(row, field, ',')) {
+      fields.push_back(field);
+    }
+    if (fields.size() < 6 || fields[1] != "RFD" || fields[5].empty()) {
+      continue;
+    }
+    uint32_t nodeId = std::stoul(fields[0]);
+    if (nodeId >= sensorJunction.size()) {
+      sensorJunction.resize(nodeId + 1, -1);
+      sensorLane.resize(nodeId + 1);
+    }
+    uint32_t junction = junctionState.Intern(fields[5]);
+    if (junction >= junctionSensors.size()) {
+      junctionSensors.resize(junction + 1);
+    }
+    sensorJunction[nodeId] = junction;
+    junctionSensors[junction].push_back(nodeId);
+    if (fields.size() >= 7 && !fields[6].empty()) {
+      sensorLane[nodeId] = fields[6];
+      laneSensors[fields[6]].push_back(nodeId);
+    }
+  }
+  return true;
+}
 
-  // Skip header
-  std::getline(trafficSensorFile, line);
+void RecordSensorSample(uint32_t nodeId, const TrafficData &data)
+{
+  SensorFileTail &tail = sensorFileTail;
+  // A corrupt or half-written row must not size the tables
+  if (nodeId >= tail.nodeLimit) {
+    tail.rejected++;
+    return;
+  }
+  if (nodeId >= tail.latest.size()) {
+    tail.latest.resize(nodeId + 1);
+  }
+  tail.latest[nodeId] = data;
+  tail.touched.push_back(nodeId);
+}
 
-  while (std::getline(trafficSensorFile, line)) {
-    // Parse CSV data: Time,NodeID,VehicleCount,EmergencyFlag
-    uint32_t nodeId;
-    uint32_t vehicleCount;
-    int emergencyFlag = 0;
+void ReadCsvSensorTail()
+{
+  SensorFileTail &tail = sensorFileTail;
 
-    std::stringstream ss(line);
-    std::string token;
+  trafficSensorFile.clear();
+  trafficSensorFile.seekg(0, std::ios::end);
+  std::streamoff fileSize = trafficSensorFile.tellg();
 
-    std::getline(ss, token, ','); // Time field (ignored)
+  // A shorter file means it was rewritten (e.g. a new WSN run); start over.
+  if (fileSize < tail.offset) {
+    tail.offset = 0;
+    tail.headerSkipped = false;
+    tail.buffer.clear();
+  }
+  if (fileSize <= tail.offset) {
+    return;
+  }
 
-    std::getline(ss, token, ',');
-    nodeId = std::stoi(token);
+  size_t carried = tail.buffer.size();
+  tail.buffer.resize(carried + static_cast<size_t>(fileSize - tail.offset));
+  trafficSensorFile.seekg(tail.offset);
+  trafficSensorFile.read(tail.buffer.data() + carried, fileSize - tail.offset);
+  std::streamsize got = trafficSensorFile.gcount();
+  tail.offset += got;
+  tail.buffer.resize(carried + static_cast<size_t>(got));
 
-    std::getline(ss, token, ',');
-    vehicleCount = std::stoi(token);
+  const char *cursor = tail.buffer.data();
+  const char *end = cursor + tail.buffer.size();
 
-    if (std::getline(ss, token, ',')) {
-      emergencyFlag = std::stoi(token);
+  while (const char *eol = static_cast<const char *>(std::memchr(cursor, '\n', end - cursor))) {
+    if (!tail.headerSkipped) {
+      tail.headerSkipped = true;
+    } else {
+      uint32_t nodeId;
+      uint32_t vehicleCount;
+      bool emergency;
+      if (ParseSensorCsvRow(cursor, eol, nodeId, vehicleCount, emergency)) {
+        RecordSensorSample(nodeId, {vehicleCount, emergency});
+      }
     }
-
-    latestTrafficData[nodeId] = {vehicleCount, (emergencyFlag != 0)};
+    cursor = eol + 1;
   }
 
-  // Map node IDs to junction IDs (assuming 1:1 mapping)
-  for (const auto &pair : latestTrafficData) {
-    std::string junctionId = "J" + std::to_string(pair.first);
-    junctionTrafficData[junctionId] = pair.second;
-  }
+  // Keep the partial trailing line (if any) for the next tick.
+  tail.buffer.erase(tail.buffer.begin(), tail.buffer.begin() + (cursor - tail.buffer.data()));
 }
 
-void AdjustTrafficLights(Ptr<TraciClient> client)
+void ReadBinarySensorChunks()
 {
-  NS_LOG_INFO("Adjusting traffic light timings based on sensor data at time " 
-              << Simulator::Now().GetSeconds());
-
-  std::vector<std::string> tlsIds = client->TrafficLightGetIDList();
-
-  for (const std::string &tlsId : tlsIds) {
-    std::vector<std::string> controlledJunctions = client->TrafficLightGetControlledJunctions(tlsId);
-
-    int totalVehicles = 0;
-    bool emergencyDetected = false;
-    for (const std::string &junction : controlledJunctions) {
-      if (junctionTrafficData.find(junction) != junctionTrafficData.end()) {
-        totalVehicles += junctionTrafficData[junction].vehicleCount;
-        if (junctionTrafficData[junction].emergency) {
-          emergencyDetected = true;
-        }
+  binarySensorLog.ReadNewChunks([](const SensorLogChunkView &chunk) {
+    for (uint32_t i = 0; i < chunk.rows; i++) {
+      RecordSensorSample(chunk.nodeId[i], {chunk.vehicleCount[i], chunk.emergency[i] != 0});
+    }
+  });
+}
+
+void ReadTrafficSensorData()
+{
+  sensorFileTail.touched.clear();
+  sensorFileTail.rejected = 0;
+
+  if (binarySensorInput) {
+    ReadBinarySensorChunks();
+  } else {
+    ReadCsvSensorTail();
+  }
+  if (sensorFileTail.rejected > 0) {
+    NS_LOG_WARN("Skipped " << sensorFileTail.rejected << " sensor rows with node IDs of "
+                           << sensorFileTail.nodeLimit << " or more");
+  }
+
+  // One sample per junction and tick, however many rows a node wrote
+  std::vector<uint32_t> &touched = sensorFileTail.touched;
+  std::sort(touched.begin(), touched.end());
+  touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+  double now = Simulator::Now().GetSeconds();
+
+  if (junctionSensors.empty()) {
+    // No sensor map: one sensor per junction, named after the node
+    for (uint32_t nodeId : touched) {
+      if (nodeId >= sensorJunction.size()) {
+        sensorJunction.resize(nodeId + 1, -1);
+      }
+      if (sensorJunction[nodeId] < 0) {
+        sensorJunction[nodeId] = junctionState.Intern("J" + std::to_string(nodeId));
       }
+      const TrafficData &data = sensorFileTail.latest[nodeId];
+      junctionState.Push(sensorJunction[nodeId], data.vehicleCount, data.emergency, now);
     }
+    return;
+  }
 
-    // Apply traffic light program based on traffic conditions
-    if (emergencyDetected) {
-      NS_LOG_INFO("Emergency detected at " << tlsId << ", setting emergency mode");
-      client->TrafficLightSetProgram(tlsId, "emergency");
-    } else if (totalVehicles > 8) {
-      NS_LOG_INFO("Heavy traffic at " << tlsId << ", total vehicles: " << totalVehicles);
-      client->TrafficLightSetProgram(tlsId, "heavy_traffic");
-    } else if (totalVehicles < 3) {
-      NS_LOG_INFO("Light traffic at " << tlsId << ", total vehicles: " << totalVehicles);
-      client->TrafficLightSetProgram(tlsId, "light_traffic");
-    } else {
-      NS_LOG_INFO("Normal traffic at " << tlsId << ", total vehicles: " << totalVehicles);
-      client->TrafficLightSetProgram(tlsId, "normal");
+  // Re-derive each junction that got a new reading from the latest readings
+  // of all its approach lanes: total vehicles, emergency on any lane.
+  std::vector<uint32_t> dirtyJunctions;
+  for (uint32_t nodeId : touched) {
+    if (nodeId < sensorJunction.size() && sensorJunction[nodeId] >= 0) {
+      dirtyJunctions.push_back(sensorJunction[nodeId]);
     }
   }
+  std::sort(dirtyJunctions.begin(), dirtyJunctions.end());
+  dirtyJunctions.erase(std::unique(dirtyJunctions.begin(), dirtyJunctions.end()), dirtyJunctions.end());
+  for (uint32_t junction : dirtyJunctions) {
+    TrafficData data = {0, false};
+    for (uint32_t nodeId : junctionSensors[junction]) {
+      if (nodeId < sensorFileTail.latest.size()) {
+        data.vehicleCount += sensorFileTail.latest[nodeId].vehicleCount;
+        data.emergency = data.emergency || sensorFileTail.latest[nodeId].emergency;
+      }
+    }
+    junctionState.Push(junction, data.vehicleCount, data.emergency, now);
+  }
 
-  // Collect vehicle data from SUMO
-  std::map<std::string, Ptr<ConstantPositionMobilityModel>> mobilityModels;
-  std::vector<std::string> vehicles = client->VehicleGetIDList();
-  
-  NS_LOG_INFO("Number of vehicles in simulation: " << vehicles.size());
+  // Same for the lanes, for the phase-timing signal policies
+  std::vector<const std::string *> dirty;
+  for (uint32_t nodeId : touched) {
+    if (nodeId < sensorLane.size() && !sensorLane[nodeId].empty()) {
+      dirty.push_back(&sensorLane[nodeId]);
+    }
+  }
+  std::sort(dirty.begin(), dirty.end());
+  dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+  for (const std::string *laneId : dirty) {
+    LaneReading reading;
+    for (uint32_t nodeId : laneSensors[*laneId]) {
+      if (nodeId < sensorFileTail.latest.size()) {
+        reading.vehicles += sensorFileTail.latest[nodeId].vehicleCount;
+        reading.emergency = reading.emergency || sensorFileTail.latest[nodeId].emergency;
+      }
+    }
+    laneReadings[*laneId] = reading;
+  }
 }
 
+std::unique_ptr<TrafficLightCommandSink> trafficLightCommands;
+TrafficLightController trafficLightController;
+
 // TraCI client callback - executed for each SUMO time step
 void TraCIClientCallback(Ptr<TraciClient> client)
 {
-  static uint32_t count = 0;
-  
   // Only process sensor data every 50 steps (5 seconds with 0.1s steps)
-  if (count++ % 50 == 0) {
-    trafficSensorFile.clear();
-    trafficSensorFile.seekg(0);
+  if (sumoSteps++ % 50 == 0) {
     ReadTrafficSensorData();
-    AdjustTrafficLights(client);
+    trafficLightController.Adjust(client, junctionState, *trafficLightCommands,
+                                  laneSensors.empty() ? nullptr : &laneReadings);
   }
 }
 
@@ -128,26 +261,83 @@ int main(int argc, char *argv[])
 {
   // Default values
   sumoConfig = "sumo-config.xml";
-  std::string trafficDataFile = "traffic_sensor_data.csv";
+  std::string trafficDataFile = "traffic_sensor_data.tslog";
   double simTime = 100.0;
   std::string outputDir = ".";  // Default to current directory
+  std::string sensorMap;
+  std::string netFile;
+  std::string signalPolicy = "fixed-threshold";
+  uint32_t junctionWindow = 4;
+  std::string junctionStatistic = "mean";
+  double emergencyHold = 5.0;
+  uint32_t maxSensorNodes = sensorFileTail.nodeLimit;
 
   CommandLine cmd;
   cmd.AddValue("sumoConfig", "SUMO configuration file", sumoConfig);
   cmd.AddValue("trafficData", "Traffic sensor data file", trafficDataFile);
   cmd.AddValue("simTime", "Simulation time in seconds", simTime);
-  cmd.AddValue("gui", "Use SUMO GUI", usingGui);
+  cmd.AddValue("gui", "Use SUMO GUI (false runs plain sumo as a headless batch job)", usingGui);
   cmd.AddValue("stepLength", "SUMO simulation step length", stepLength);
   cmd.AddValue("outputDir", "Directory for output files", outputDir);
+  cmd.AddValue("sensorMap", "sensor_map.csv from generate_grid.py mapping sensor nodes to junctions", sensorMap);
+  cmd.AddValue("netFile", "SUMO network with the lights' phase plans (needed by max-pressure and actuated)", netFile);
+  cmd.AddValue("signalPolicy", "Traffic light policy: fixed-threshold, max-pressure or actuated", signalPolicy);
+  cmd.AddValue("junctionWindow", "Readings per junction the controller smooths over", junctionWindow);
+  cmd.AddValue("junctionStatistic", "Vehicle count the controller uses: latest, mean, max or ewma of the window",
+               junctionStatistic);
+  cmd.AddValue("emergencyHold", "Seconds an emergency reading keeps its junction in emergency mode", emergencyHold);
+  cmd.AddValue("maxSensorNodes", "Rows with node IDs from this value on are skipped when there is no --sensorMap",
+               maxSensorNodes);
   cmd.Parse(argc, argv);
 
   // Enable logging
   LogComponentEnable("SUMONs3Integration", LOG_LEVEL_INFO);
   LogComponentEnable("TraciClient", LOG_LEVEL_WARN);
 
-  // Open traffic sensor data file
-  trafficSensorFile.open(trafficDataFile);
-  if (!trafficSensorFile.is_open()) {
+  JunctionStateStore::Statistic statistic;
+  if (!JunctionStateStore::ParseStatistic(junctionStatistic, statistic)) {
+    NS_LOG_ERROR("Unknown junction statistic: " << junctionStatistic);
+    return 1;
+  }
+  junctionState = JunctionStateStore(junctionWindow, statistic, 0.5, emergencyHold);
+  sensorFileTail.nodeLimit = maxSensorNodes;
+
+  if (!sensorMap.empty()) {
+    if (!LoadSensorMap(sensorMap)) {
+      NS_LOG_ERROR("Failed to open sensor map: " << sensorMap);
+      return 1;
+    }
+    NS_LOG_INFO("Loaded " << junctionSensors.size() << " junctions from sensor map " << sensorMap);
+    // Readings from nodes the map does not know have nowhere to go
+    sensorFileTail.nodeLimit = sensorJunction.size();
+  }
+
+  // Sensor data is read every 50 SUMO steps, so that is the decision interval
+  std::unique_ptr<SignalControlPolicy> policy = CreateSignalPolicy(signalPolicy, 50 * stepLength);
+  if (!policy) {
+    NS_LOG_ERROR("Unknown signal policy: " << signalPolicy);
+    return 1;
+  }
+  if (policy->UsesPhases()) {
+    SumoNet net;
+    if (netFile.empty() || laneSensors.empty() || !net.Load(netFile)) {
+      NS_LOG_ERROR("Signal policy " << signalPolicy << " needs --netFile and a --sensorMap with lanes");
+      return 1;
+    }
+    trafficLightController.SetPlans(net.TrafficLights());
+  }
+  trafficLightController.SetPolicy(std::move(policy));
+
+  // Open traffic sensor data file (binary sensor log or legacy CSV)
+  binarySensorInput = BinarySensorLogReader::IsBinaryLog(trafficDataFile);
+  bool opened = false;
+  if (binarySensorInput) {
+    opened = binarySensorLog.Open(trafficDataFile);
+  } else {
+    trafficSensorFile.open(trafficDataFile);
+    opened = trafficSensorFile.is_open();
+  }
+  if (!opened) {
     NS_LOG_ERROR("Failed to open traffic data file: " << trafficDataFile);
     return 1;
   }
@@ -161,8 +351,8 @@ int main(int argc, char *argv[])
              << "# This script runs SUMO with the traffic light control based on sensor data\n\n"
              << "# Path to SUMO configuration\n"
              << "SUMO_CONFIG=\"" << sumoConfig << "\"\n\n"
-             << "# Start SUMO with GUI\n"
-             << "sumo-gui -c \"$SUMO_CONFIG\" --remote-port 8813 --start &\n\n"
+             << (usingGui ? "# Start SUMO with GUI\n" : "# Start SUMO headless\n")
+             << (usingGui ? "sumo-gui" : "sumo") << " -c \"$SUMO_CONFIG\" --remote-port 8813 --start &\n\n"
              << "# Wait for SUMO to initialize\n"
              << "sleep 2\n\n"
              << "# Read traffic sensor data and apply traffic light control\n"
@@ -185,6 +375,8 @@ int main(int argc, char *argv[])
   client->SetAttribute("StartTime", TimeValue(Seconds(0.0)));
   client->SetAttribute("SumoGUI", BooleanValue(usingGui));
   
+  trafficLightCommands.reset(new TraciClientCommandSink(client));
+
   // Register the client callback to be executed at each time step
   client->TraceConnectWithoutContext("SumoSimulationStep", MakeCallback(&TraCIClientCallback));
 
@@ -194,12 +386,24 @@ int main(int argc, char *argv[])
   // Run the simulation
   NS_LOG_INFO("Starting simulation for " << simTime << " seconds");
   Simulator::Stop(Seconds(simTime));
+  auto wallStart = std::chrono::steady_clock::now();
   Simulator::Run();
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
   Simulator::Destroy();
+  trafficLightCommands.reset();
 
   // Clean up
   trafficSensorFile.close();
-
+  binarySensorLog.Close();
+
+  NS_LOG_INFO("Traffic light control (" << trafficLightController.Policy().Name() << "): "
+              << trafficLightController.ProgramChanges() << " program changes and "
+              << trafficLightController.PhaseCommands() << " phase timing commands over "
+              << trafficLightController.ControlTicks() << " control ticks for "
+              << trafficLightController.NumLights() << " lights");
+  NS_LOG_INFO("Simulated " << simTime << " s (" << sumoSteps << " SUMO steps) in " << wallSeconds
+              << " s wall-clock: " << simTime / std::max(wallSeconds, 1e-9) << " sim-s/wall-s"
+              << (usingGui ? "" : " (headless)"));
   NS_LOG_INFO("Simulation completed successfully.");
   return 0;
 }
\ No newline at end of file
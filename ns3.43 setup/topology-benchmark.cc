@@ -0,0 +1,155 @@
+// Topology-build benchmark for the WSN scenario: times the RFD -> FFD
+// cluster-head assignment done by wsn-implementation, comparing the original
+// nested scan (MobilityModel lookups on every iteration) with cached
+// positions plus GridSpatialIndex, and checks that both pick the same FFDs.
+//
+//   ./ns3 run "scratch/topology-benchmark --numRFD=50000 --numFFD=2000"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "spatial-index.h"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("TopologyBenchmark");
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t numRFD = 50000;
+    uint32_t numFFD = 2000;
+    uint32_t backupParents = 2;
+    bool legacy = true;
+
+    CommandLine cmd;
+    cmd.AddValue("numRFD", "Number of RFD nodes", numRFD);
+    cmd.AddValue("numFFD", "Number of FFD nodes", numFFD);
+    cmd.AddValue("backupParents", "Backup parents per RFD for the k-nearest query", backupParents);
+    cmd.AddValue("legacy", "Also time the original O(numRFD x numFFD) scan", legacy);
+    cmd.Parse(argc, argv);
+
+    // Keep the scenario's density (10 RFDs per 100 m x 100 m) and spread the
+    // FFDs on a square grid over the same field.
+    double fieldSize = 100.0 * std::sqrt(numRFD / 10.0);
+    uint32_t gridWidth = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(numFFD))));
+    double ffdSpacing = fieldSize / std::max<uint32_t>(gridWidth, 1);
+
+    auto start = std::chrono::steady_clock::now();
+    NodeContainer ffdNodes, rfdNodes;
+    ffdNodes.Create(numFFD);
+    rfdNodes.Create(numRFD);
+
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.SetPositionAllocator("ns3::GridPositionAllocator",
+                                  "MinX", DoubleValue(ffdSpacing / 2),
+                                  "MinY", DoubleValue(ffdSpacing / 2),
+                                  "DeltaX", DoubleValue(ffdSpacing),
+                                  "DeltaY", DoubleValue(ffdSpacing),
+                                  "GridWidth", UintegerValue(gridWidth),
+                                  "LayoutType", StringValue("RowFirst"));
+    mobility.Install(ffdNodes);
+    std::ostringstream range;
+    range << "ns3::UniformRandomVariable[Min=0.0|Max=" << fieldSize << "]";
+    mobility.SetPositionAllocator("ns3::RandomRectanglePositionAllocator",
+                                  "X", StringValue(range.str()),
+                                  "Y", StringValue(range.str()));
+    mobility.Install(rfdNodes);
+    double nodesMs = ElapsedMs(start);
+
+    std::vector<uint32_t> legacyChoice;
+    double legacyMs = 0;
+    if (legacy) {
+        start = std::chrono::steady_clock::now();
+        legacyChoice.resize(numRFD);
+        for (uint32_t i = 0; i < numRFD; i++) {
+            uint32_t closestFFD = 0;
+            double minDistance = std::numeric_limits<double>::max();
+            for (uint32_t j = 0; j < numFFD; j++) {
+                Vector ffdPos = ffdNodes.Get(j)->GetObject<MobilityModel>()->GetPosition();
+                Vector rfdPos = rfdNodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
+                double distance = CalculateDistance(ffdPos, rfdPos);
+                if (distance < minDistance) {
+                    minDistance = distance;
+                    closestFFD = j;
+                }
+            }
+            legacyChoice[i] = closestFFD;
+        }
+        legacyMs = ElapsedMs(start);
+    }
+
+    start = std::chrono::steady_clock::now();
+    std::vector<double> ffdX(numFFD), ffdY(numFFD);
+    for (uint32_t j = 0; j < numFFD; j++) {
+        Vector pos = ffdNodes.Get(j)->GetObject<MobilityModel>()->GetPosition();
+        ffdX[j] = pos.x;
+        ffdY[j] = pos.y;
+    }
+    std::vector<double> rfdX(numRFD), rfdY(numRFD);
+    for (uint32_t i = 0; i < numRFD; i++) {
+        Vector pos = rfdNodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
+        rfdX[i] = pos.x;
+        rfdY[i] = pos.y;
+    }
+    double cacheMs = ElapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    GridSpatialIndex ffdIndex;
+    ffdIndex.Build(ffdX, ffdY);
+    double buildMs = ElapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> gridChoice(numRFD);
+    for (uint32_t i = 0; i < numRFD; i++) {
+        int64_t nearest = ffdIndex.Nearest(rfdX[i], rfdY[i]);
+        gridChoice[i] = nearest < 0 ? 0 : static_cast<uint32_t>(nearest);
+    }
+    double nearestMs = ElapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> parents;
+    uint64_t parentCount = 0;
+    for (uint32_t i = 0; i < numRFD; i++) {
+        ffdIndex.KNearest(rfdX[i], rfdY[i], 1 + backupParents, parents);
+        parentCount += parents.size();
+    }
+    double knnMs = ElapsedMs(start);
+
+    uint32_t mismatches = 0;
+    if (legacy) {
+        for (uint32_t i = 0; i < numRFD; i++) {
+            if (legacyChoice[i] != gridChoice[i])
+                mismatches++;
+        }
+    }
+
+    std::cout << "Topology build benchmark: " << numRFD << " RFD, " << numFFD << " FFD, field "
+              << fieldSize << " m" << std::endl;
+    std::cout << "  node + mobility setup     " << nodesMs << " ms" << std::endl;
+    if (legacy) {
+        std::cout << "  legacy nested scan        " << legacyMs << " ms" << std::endl;
+    }
+    std::cout << "  position cache (SoA)      " << cacheMs << " ms" << std::endl;
+    std::cout << "  grid index build          " << buildMs << " ms" << std::endl;
+    std::cout << "  nearest assignment        " << nearestMs << " ms" << std::endl;
+    std::cout << "  " << (1 + backupParents) << "-nearest (with backups)  " << knnMs << " ms ("
+              << parentCount << " parents)" << std::endl;
+    if (legacy) {
+        std::cout << "  speedup (scan vs cache+build+nearest) "
+                  << legacyMs / std::max(cacheMs + buildMs + nearestMs, 1e-9) << "x, "
+                  << mismatches << " mismatched assignments" << std::endl;
+    }
+
+    Simulator::Destroy();
+    return mismatches == 0 ? 0 : 1;
+}
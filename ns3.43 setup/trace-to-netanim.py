@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+
+# Converts a sampled WSN packet trace (wsn-implementation --trace, see the
+# layout in wsn-trace.h) into a NetAnim XML animation.
+#
+# The trace is read in blocks and written out as it goes, so memory stays flat
+# however long the run was. Nodes keep the descriptions and colours the
+# in-process AnimationInterface gives them (FPC red, FFD green, RFD blue);
+# each sampled transmission becomes a wireless packet reference (<pr>) and
+# each reception a <wpr> keyed by the same uId, as NetAnim expects. Time,
+# node and packet-size filters can narrow an existing trace further.
+#
+#   ./trace-to-netanim.py output/traffic-wsn-trace.wstr
+#   ./trace-to-netanim.py output/traffic-wsn-trace.wstr -o fpc.xml --nodes 0-3 --start 10 --stop 20
+
+import argparse
+import os
+import struct
+import sys
+
+FILE_HEADER = struct.Struct('=IHHIIdd')
+NODE = struct.Struct('=IB3xffQ')
+EVENT = struct.Struct('=dQIHBx')
+FILE_MAGIC = 0x52545357  # "WSTR"
+VERSION = 1
+TRANSMIT = 0
+ROLES = [('FPC', (255, 0, 0)), ('FFD', (0, 255, 0)), ('RFD', (0, 0, 255))]
+BLOCK_EVENTS = 4096
+
+
+def airtime(psdu_bytes):
+    """2.4 GHz O-QPSK airtime of a PSDU, synchronisation header and PHR included."""
+    return (psdu_bytes + 6) * 32e-6
+
+
+def parse_nodes(text):
+    nodes = set()
+    for item in filter(None, text.split(',')):
+        first, _, last = item.partition('-')
+        nodes.update(range(int(first), int(last or first) + 1))
+    return nodes
+
+
+def read_header(f):
+    data = f.read(FILE_HEADER.size)
+    if len(data) < FILE_HEADER.size:
+        raise ValueError('truncated file header')
+    magic, version, _, node_count, every, start, stop = FILE_HEADER.unpack(data)
+    if magic != FILE_MAGIC:
+        raise ValueError('not a WSN packet trace')
+    if version != VERSION:
+        raise ValueError(f'unsupported trace version {version}')
+    nodes = []
+    for _ in range(node_count):
+        data = f.read(NODE.size)
+        if len(data) < NODE.size:
+            raise ValueError('truncated node table')
+        node_id, role, x, y, _ = NODE.unpack(data)
+        nodes.append((node_id, role, x, y))
+    return nodes, every, start, stop
+
+
+def read_events(f):
+    """Yields (time, id, node, bytes, kind) up to the last whole record."""
+    while True:
+        data = f.read(EVENT.size * BLOCK_EVENTS)
+        whole = len(data) - len(data) % EVENT.size
+        yield from EVENT.iter_unpack(data[:whole])
+        if len(data) < EVENT.size * BLOCK_EVENTS:
+            return
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a sampled WSN packet trace to NetAnim XML')
+    parser.add_argument('trace', help='Binary trace written by wsn-implementation --trace')
+    parser.add_argument('-o', '--output', help='NetAnim XML file (default: the trace name with .xml)')
+    parser.add_argument('--start', type=float, default=0.0, help='Skip transmissions before this time (s)')
+    parser.add_argument('--stop', type=float, default=0.0, help='Skip transmissions from this time on (0: no limit)')
+    parser.add_argument('--nodes', help='Keep transmissions sent or received by these node IDs, e.g. 0-3,17')
+    parser.add_argument('--min-bytes', type=int, default=0,
+                        help='Skip frames shorter than this, e.g. 6 to leave out MAC acknowledgements')
+    args = parser.parse_args()
+
+    output = args.output or os.path.splitext(args.trace)[0] + '.xml'
+    keep_nodes = parse_nodes(args.nodes) if args.nodes else None
+
+    with open(args.trace, 'rb') as f, open(output, 'w') as out:
+        try:
+            nodes, every, start, stop = read_header(f)
+        except ValueError as e:
+            print(f'{args.trace}: {e}', file=sys.stderr)
+            return 1
+
+        out.write('<anim ver="netanim-3.108" filetype="animation" >\n')
+        for node_id, _, x, y in nodes:
+            out.write(f'<node id="{node_id}" sysId="0" locX="{x:g}" locY="{y:g}" />\n')
+        for node_id, role, _, _ in nodes:
+            name, (r, g, b) = ROLES[role] if role < len(ROLES) else ('', (128, 128, 128))
+            out.write(f'<nu p="c" t="0" id="{node_id}" r="{r}" g="{g}" b="{b}" />\n')
+            out.write(f'<nu p="d" t="0" id="{node_id}" descr="{name}" />\n')
+
+        # With a node filter a transmission is only known to be wanted once
+        # one of its events involves a listed node, so its <pr> is held back
+        # until then. Events are not strictly time-ordered (a deferred
+        # transmit event keeps its start time), so only the transmit-before-
+        # receive order within one transmission ID is relied on.
+        pending = {}
+        written = set()
+        transmissions = receptions = 0
+        for time, tx_id, node, size, kind in read_events(f):
+            # Transmission IDs rise with send time, so anything far older
+            # than the current one is no longer on air.
+            if len(written) + len(pending) > 65536:
+                horizon = tx_id - 32768
+                written = {i for i in written if i > horizon}
+                pending = {i: pr for i, pr in pending.items() if i > horizon}
+
+            if kind == TRANSMIT:
+                if size < args.min_bytes or time < args.start or (args.stop > 0 and time >= args.stop):
+                    continue
+                pr = f'<pr uId="{tx_id}" fId="{node}" fbTx="{time:.9f}" />\n'
+                if keep_nodes is None or node in keep_nodes:
+                    out.write(pr)
+                    written.add(tx_id)
+                    transmissions += 1
+                else:
+                    pending[tx_id] = pr
+                continue
+
+            if tx_id not in written:
+                if keep_nodes is None or node not in keep_nodes or tx_id not in pending:
+                    continue
+                out.write(pending.pop(tx_id))
+                written.add(tx_id)
+                transmissions += 1
+            out.write(f'<wpr uId="{tx_id}" tId="{node}" fbRx="{time - airtime(size):.9f}" lbRx="{time:.9f}" />\n')
+            receptions += 1
+        out.write('</anim>\n')
+
+    window = f'{start:g} s to {stop:g} s' if stop > 0 else f'from {start:g} s'
+    print(f'{len(nodes)} nodes, {transmissions} transmissions, {receptions} receptions '
+          f'(1 in {every} frames traced {window}) written to {output}')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
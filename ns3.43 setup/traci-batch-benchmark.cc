@@ -0,0 +1,191 @@
+// TraCI batching microbenchmark: runs a controller-like tick (read each
+// light's current program, then set a new one) against a local stand-in
+// TraCI server, once with one blocking round trip per command and once with
+// every command of the tick pipelined into a single message, and reports
+// round trips and time per tick for both.
+//
+//   ./ns3 run "scratch/traci-batch-benchmark --numLights=500 --ticks=200 --serverDelayUs=50"
+
+#include "ns3/core-module.h"
+#include "traci-batch.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("TraciBatchBenchmark");
+
+// Minimal TraCI server: acknowledges every command, answers gets with a
+// string and simulation steps with no subscription results. serverDelayUs
+// stands in for SUMO's per-message processing and network latency.
+class StandInTraciServer {
+public:
+    StandInTraciServer() : m_listenFd(-1), m_port(0), m_delayUs(0), m_messages(0) {}
+    ~StandInTraciServer() { Stop(); }
+
+    bool Start(uint32_t delayUs) {
+        m_delayUs = delayUs;
+        m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            listen(m_listenFd, 1) != 0 || getsockname(m_listenFd, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+            return false;
+        m_port = ntohs(addr.sin_port);
+        m_thread = std::thread(&StandInTraciServer::Serve, this);
+        return true;
+    }
+
+    void Stop() {
+        if (m_listenFd >= 0) {
+            shutdown(m_listenFd, SHUT_RDWR);
+            close(m_listenFd);
+            m_listenFd = -1;
+        }
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    uint16_t Port() const { return m_port; }
+    uint64_t Messages() const { return m_messages; }
+
+private:
+    void Serve() {
+        int fd = accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0)
+            return;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        TraciBuffer request;
+        TraciBuffer reply;
+        while (TcpTraciTransport::ReceiveMessage(fd, request.data)) {
+            m_messages++;
+            request.pos = 0;
+            request.error = false;
+            reply.data.clear();
+            while (request.Remaining() > 0) {
+                size_t start = request.pos;
+                size_t length = ReadTraciCommandLength(request);
+                if (length == 0)
+                    break;
+                uint8_t id = request.ReadU8();
+                uint8_t variable = request.ReadU8();
+                std::string objectId = request.ReadString();
+                request.pos = start + length;
+
+                TraciBuffer status;
+                status.WriteU8(traci::RTYPE_OK);
+                status.WriteString("");
+                AppendTraciCommand(reply, id, status.data);
+                if (id == traci::CMD_GET_TL_VARIABLE || id == traci::CMD_GET_SIM_VARIABLE) {
+                    TraciBuffer result;
+                    result.WriteU8(variable);
+                    result.WriteString(objectId);
+                    TraciValue::String("normal").Write(result);
+                    AppendTraciCommand(reply, id + traci::RESPONSE_OFFSET, result.data);
+                } else if (id == traci::CMD_SIMSTEP) {
+                    reply.WriteI32(0);
+                }
+            }
+            if (m_delayUs > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(m_delayUs));
+            if (!TcpTraciTransport::SendMessage(fd, reply.data))
+                break;
+        }
+        close(fd);
+    }
+
+    int m_listenFd;
+    uint16_t m_port;
+    uint32_t m_delayUs;
+    std::atomic<uint64_t> m_messages;
+    std::thread m_thread;
+};
+
+struct TickStats {
+    uint64_t roundTrips = 0;
+    uint64_t answered = 0;
+    double totalMs = 0;
+};
+
+// Runs ticks control ticks; with batched = false every command is flushed
+// on its own, as a blocking client would send it.
+static TickStats RunTicks(TcpTraciTransport &transport, const std::vector<std::string> &lights, uint32_t ticks,
+                          bool batched) {
+    static const char *programs[] = {"normal", "heavy_traffic", "light_traffic"};
+    TraciCommandBatch batch;
+    TickStats stats;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < ticks; t++) {
+        std::vector<std::future<TraciResult>> current;
+        current.reserve(lights.size());
+        for (size_t i = 0; i < lights.size(); i++) {
+            current.push_back(batch.GetAsync(traci::CMD_GET_TL_VARIABLE, traci::TL_CURRENT_PROGRAM, lights[i]));
+            if (!batched)
+                batch.Flush(transport);
+            batch.SetTrafficLightProgram(lights[i], programs[(t + i) % 3],
+                                         [&stats](const TraciResult &r) { stats.answered += r.ok; });
+            if (!batched)
+                batch.Flush(transport);
+        }
+        batch.Flush(transport);
+        for (std::future<TraciResult> &f : current)
+            stats.answered += f.get().ok;
+    }
+    stats.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats.roundTrips = batch.MessagesSent();
+    return stats;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t numLights = 500;
+    uint32_t ticks = 200;
+    uint32_t serverDelayUs = 0;
+
+    CommandLine cmd;
+    cmd.AddValue("numLights", "Traffic lights touched per tick", numLights);
+    cmd.AddValue("ticks", "Control ticks to run in each mode", ticks);
+    cmd.AddValue("serverDelayUs", "Extra server-side delay per message in microseconds", serverDelayUs);
+    cmd.Parse(argc, argv);
+
+    std::vector<std::string> lights;
+    for (uint32_t i = 0; i < numLights; i++)
+        lights.push_back("J" + std::to_string(i));
+
+    StandInTraciServer server;
+    TcpTraciTransport transport;
+    if (!server.Start(serverDelayUs) || !transport.Connect("127.0.0.1", server.Port())) {
+        std::cerr << "Could not start the stand-in TraCI server" << std::endl;
+        return 1;
+    }
+
+    TickStats blocking = RunTicks(transport, lights, ticks, false);
+    TickStats batched = RunTicks(transport, lights, ticks, true);
+    transport.Close();
+    server.Stop();
+
+    uint64_t expected = 2ull * numLights * ticks;
+    std::cout << "TraCI batching benchmark: " << numLights << " lights, " << ticks << " ticks, "
+              << serverDelayUs << " us server delay" << std::endl;
+    std::cout << "  blocking   " << blocking.roundTrips / ticks << " round trips/tick, "
+              << blocking.totalMs / ticks << " ms/tick" << std::endl;
+    std::cout << "  batched    " << batched.roundTrips / ticks << " round trips/tick, "
+              << batched.totalMs / ticks << " ms/tick" << std::endl;
+    std::cout << "  speedup    " << blocking.totalMs / std::max(batched.totalMs, 1e-9) << "x, "
+              << server.Messages() << " messages served" << std::endl;
+
+    bool complete = blocking.answered == expected && batched.answered == expected;
+    if (!complete) {
+        std::cout << "  missing replies: blocking " << expected - blocking.answered << ", batched "
+                  << expected - batched.answered << std::endl;
+    }
+    return complete ? 0 : 1;
+}
@@ -0,0 +1,534 @@
+#ifndef TRACI_BATCH_H
+#define TRACI_BATCH_H
+
+// Batched TraCI command pipelining.
+//
+// A TraCI message is a 4-byte big-endian total length followed by any
+// number of commands; SUMO executes them in order and answers with one
+// message holding a status for every command, each followed by its result
+// for get commands. TraciCommandBatch queues set/get commands during a
+// control tick, sends them as a single message on Flush() and hands every
+// result to the callback or future registered with its command, so a tick
+// costs one round trip however many lights and queries it touches.
+//
+// Command framing: u8 length (including itself), or u8 0 followed by an i32
+// length when the command exceeds 255 bytes; then u8 command ID and payload.
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace traci {
+
+// Command IDs
+constexpr uint8_t CMD_SIMSTEP = 0x02;
+constexpr uint8_t CMD_SETORDER = 0x03;
+constexpr uint8_t CMD_CLOSE = 0x7F;
+constexpr uint8_t CMD_GET_TL_VARIABLE = 0xa2;
+constexpr uint8_t CMD_GET_LANE_VARIABLE = 0xa3;
+constexpr uint8_t CMD_SET_TL_VARIABLE = 0xc2;
+constexpr uint8_t CMD_GET_SIM_VARIABLE = 0xab;
+constexpr uint8_t CMD_SET_SIM_VARIABLE = 0xcb;
+constexpr uint8_t RESPONSE_OFFSET = 0x10;  // Get response ID = get command ID + 0x10
+
+// Variable IDs
+constexpr uint8_t ID_LIST = 0x00;
+constexpr uint8_t LAST_STEP_VEHICLE_NUMBER = 0x10;
+constexpr uint8_t LAST_STEP_VEHICLE_HALTING_NUMBER = 0x14;
+constexpr uint8_t TL_RED_YELLOW_GREEN_STATE = 0x20;
+constexpr uint8_t TL_PHASE_INDEX = 0x22;
+constexpr uint8_t TL_PROGRAM = 0x23;
+constexpr uint8_t TL_PHASE_DURATION = 0x24;
+constexpr uint8_t TL_CONTROLLED_LANES = 0x26;
+constexpr uint8_t TL_CURRENT_PHASE = 0x28;
+constexpr uint8_t TL_CURRENT_PROGRAM = 0x29;
+constexpr uint8_t CMD_SAVE_SIMSTATE = 0x95;
+constexpr uint8_t CMD_LOAD_SIMSTATE = 0x96;
+constexpr uint8_t VAR_TIME = 0x66;
+constexpr uint8_t VAR_ARRIVED_VEHICLES_NUMBER = 0x79;
+constexpr uint8_t VAR_MIN_EXPECTED_VEHICLES = 0x7d;
+
+// Value types
+constexpr uint8_t TYPE_UBYTE = 0x07;
+constexpr uint8_t TYPE_INTEGER = 0x09;
+constexpr uint8_t TYPE_DOUBLE = 0x0B;
+constexpr uint8_t TYPE_STRING = 0x0C;
+constexpr uint8_t TYPE_STRINGLIST = 0x0E;
+constexpr uint8_t TYPE_COMPOUND = 0x0F;
+
+// Status results
+constexpr uint8_t RTYPE_OK = 0x00;
+constexpr uint8_t RTYPE_NOTIMPLEMENTED = 0x01;
+constexpr uint8_t RTYPE_ERR = 0xFF;
+
+} // namespace traci
+
+// Big-endian read/write buffer for TraCI payloads. Reads past the end set
+// an error flag and return zero values instead of throwing.
+class TraciBuffer {
+public:
+    std::vector<uint8_t> data;
+    size_t pos = 0;
+    bool error = false;
+
+    void WriteU8(uint8_t v) { data.push_back(v); }
+    void WriteI32(int32_t v) {
+        uint32_t u = static_cast<uint32_t>(v);
+        uint8_t b[4] = {static_cast<uint8_t>(u >> 24), static_cast<uint8_t>(u >> 16),
+                        static_cast<uint8_t>(u >> 8), static_cast<uint8_t>(u)};
+        data.insert(data.end(), b, b + 4);
+    }
+    void WriteDouble(double v) {
+        uint64_t u;
+        std::memcpy(&u, &v, sizeof(u));
+        for (int shift = 56; shift >= 0; shift -= 8)
+            data.push_back(static_cast<uint8_t>(u >> shift));
+    }
+    void WriteString(const std::string &s) {
+        WriteI32(static_cast<int32_t>(s.size()));
+        data.insert(data.end(), s.begin(), s.end());
+    }
+    void WriteStringList(const std::vector<std::string> &list) {
+        WriteI32(static_cast<int32_t>(list.size()));
+        for (const std::string &s : list)
+            WriteString(s);
+    }
+
+    size_t Remaining() const { return pos <= data.size() ? data.size() - pos : 0; }
+
+    uint8_t ReadU8() {
+        if (!Need(1))
+            return 0;
+        return data[pos++];
+    }
+    int32_t ReadI32() {
+        if (!Need(4))
+            return 0;
+        uint32_t u = (static_cast<uint32_t>(data[pos]) << 24) | (static_cast<uint32_t>(data[pos + 1]) << 16) |
+                     (static_cast<uint32_t>(data[pos + 2]) << 8) | data[pos + 3];
+        pos += 4;
+        return static_cast<int32_t>(u);
+    }
+    double ReadDouble() {
+        if (!Need(8))
+            return 0.0;
+        uint64_t u = 0;
+        for (int i = 0; i < 8; i++)
+            u = (u << 8) | data[pos++];
+        double v;
+        std::memcpy(&v, &u, sizeof(v));
+        return v;
+    }
+    std::string ReadString() {
+        int32_t n = ReadI32();
+        if (n < 0 || !Need(static_cast<size_t>(n)))
+            return std::string();
+        std::string s(reinterpret_cast<const char *>(data.data() + pos), n);
+        pos += n;
+        return s;
+    }
+    std::vector<std::string> ReadStringList() {
+        int32_t n = ReadI32();
+        std::vector<std::string> list;
+        for (int32_t i = 0; i < n && !error; i++)
+            list.push_back(ReadString());
+        return list;
+    }
+
+private:
+    bool Need(size_t n) {
+        if (Remaining() < n)
+            error = true;
+        return !error;
+    }
+};
+
+// Decoded value of a get command (or of a stand-in server's reply).
+struct TraciValue {
+    uint8_t type = 0;
+    int32_t intValue = 0;
+    double doubleValue = 0.0;
+    std::string stringValue;
+    std::vector<std::string> stringList;
+
+    // Writes the value with its type byte. Compound values are not supported.
+    void Write(TraciBuffer &out) const {
+        out.WriteU8(type);
+        switch (type) {
+        case traci::TYPE_UBYTE:
+            out.WriteU8(static_cast<uint8_t>(intValue));
+            break;
+        case traci::TYPE_INTEGER:
+            out.WriteI32(intValue);
+            break;
+        case traci::TYPE_DOUBLE:
+            out.WriteDouble(doubleValue);
+            break;
+        case traci::TYPE_STRING:
+            out.WriteString(stringValue);
+            break;
+        case traci::TYPE_STRINGLIST:
+            out.WriteStringList(stringList);
+            break;
+        }
+    }
+
+    // Reads a typed value; returns false for unsupported types.
+    bool Read(TraciBuffer &in) {
+        type = in.ReadU8();
+        switch (type) {
+        case traci::TYPE_UBYTE:
+            intValue = in.ReadU8();
+            break;
+        case traci::TYPE_INTEGER:
+            intValue = in.ReadI32();
+            break;
+        case traci::TYPE_DOUBLE:
+            doubleValue = in.ReadDouble();
+            break;
+        case traci::TYPE_STRING:
+            stringValue = in.ReadString();
+            break;
+        case traci::TYPE_STRINGLIST:
+            stringList = in.ReadStringList();
+            break;
+        default:
+            return false;
+        }
+        return !in.error;
+    }
+
+    static TraciValue String(const std::string &s) {
+        TraciValue v;
+        v.type = traci::TYPE_STRING;
+        v.stringValue = s;
+        return v;
+    }
+    static TraciValue Integer(int32_t i) {
+        TraciValue v;
+        v.type = traci::TYPE_INTEGER;
+        v.intValue = i;
+        return v;
+    }
+    static TraciValue Double(double d) {
+        TraciValue v;
+        v.type = traci::TYPE_DOUBLE;
+        v.doubleValue = d;
+        return v;
+    }
+};
+
+// Outcome of one command in a batch.
+struct TraciResult {
+    bool ok = false;
+    std::string error;  // Status description when !ok
+    TraciValue value;   // Only set for get commands
+};
+
+// Appends one framed command to a message buffer.
+inline void AppendTraciCommand(TraciBuffer &message, uint8_t commandId, const std::vector<uint8_t> &payload) {
+    size_t shortLength = 2 + payload.size();
+    if (shortLength <= 255) {
+        message.WriteU8(static_cast<uint8_t>(shortLength));
+    } else {
+        message.WriteU8(0);
+        message.WriteI32(static_cast<int32_t>(shortLength + 4));
+    }
+    message.WriteU8(commandId);
+    message.data.insert(message.data.end(), payload.begin(), payload.end());
+}
+
+// Reads one command header at in.pos; returns its total length (0 on error)
+// and leaves in.pos at the command ID.
+inline size_t ReadTraciCommandLength(TraciBuffer &in) {
+    size_t length = in.ReadU8();
+    size_t header = 1;
+    if (length == 0) {
+        length = static_cast<uint32_t>(in.ReadI32());
+        header = 5;
+    }
+    if (in.error || length < header + 1 || length > in.Remaining() + header) {
+        in.error = true;
+        return 0;
+    }
+    return length;
+}
+
+// Carries whole TraCI messages (without the outer length prefix) to a
+// server and back.
+class TraciTransport {
+public:
+    virtual ~TraciTransport() = default;
+    virtual bool Exchange(const std::vector<uint8_t> &request, std::vector<uint8_t> &response) = 0;
+};
+
+// Blocking TCP transport to a SUMO TraCI port.
+class TcpTraciTransport : public TraciTransport {
+public:
+    TcpTraciTransport() : m_fd(-1) {}
+    ~TcpTraciTransport() override { Close(); }
+
+    bool Connect(const std::string &host, uint16_t port) {
+        Close();
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *addrs = nullptr;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addrs) != 0)
+            return false;
+        for (addrinfo *a = addrs; a != nullptr && m_fd < 0; a = a->ai_next) {
+            m_fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (m_fd >= 0 && connect(m_fd, a->ai_addr, a->ai_addrlen) != 0) {
+                close(m_fd);
+                m_fd = -1;
+            }
+        }
+        freeaddrinfo(addrs);
+        if (m_fd < 0)
+            return false;
+        int one = 1;
+        setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return true;
+    }
+
+    bool IsConnected() const { return m_fd >= 0; }
+
+    void Close() {
+        if (m_fd >= 0)
+            close(m_fd);
+        m_fd = -1;
+    }
+
+    bool Exchange(const std::vector<uint8_t> &request, std::vector<uint8_t> &response) override {
+        return SendMessage(m_fd, request) && ReceiveMessage(m_fd, response);
+    }
+
+    // Message framing, shared with the stand-in server in the benchmark.
+    static bool SendMessage(int fd, const std::vector<uint8_t> &body) {
+        TraciBuffer header;
+        header.WriteI32(static_cast<int32_t>(body.size() + 4));
+        return SendAll(fd, header.data.data(), header.data.size()) && SendAll(fd, body.data(), body.size());
+    }
+
+    static bool ReceiveMessage(int fd, std::vector<uint8_t> &body) {
+        TraciBuffer header;
+        header.data.resize(4);
+        if (!ReceiveAll(fd, header.data.data(), 4))
+            return false;
+        int32_t length = header.ReadI32();
+        if (length < 4)
+            return false;
+        body.resize(length - 4);
+        return ReceiveAll(fd, body.data(), body.size());
+    }
+
+private:
+    static bool SendAll(int fd, const uint8_t *p, size_t n) {
+        while (n > 0) {
+            ssize_t sent = send(fd, p, n, MSG_NOSIGNAL);
+            if (sent <= 0)
+                return false;
+            p += sent;
+            n -= sent;
+        }
+        return true;
+    }
+
+    static bool ReceiveAll(int fd, uint8_t *p, size_t n) {
+        while (n > 0) {
+            ssize_t got = recv(fd, p, n, 0);
+            if (got <= 0)
+                return false;
+            p += got;
+            n -= got;
+        }
+        return true;
+    }
+
+    int m_fd;
+};
+
+// Queues TraCI commands and sends them as one message per Flush().
+class TraciCommandBatch {
+public:
+    using Callback = std::function<void(const TraciResult &)>;
+
+    // Queues a set command: u8 variable, string object ID, typed value.
+    void Set(uint8_t commandId, uint8_t variable, const std::string &objectId, const TraciValue &value,
+             Callback done = nullptr) {
+        TraciBuffer payload;
+        payload.WriteU8(variable);
+        payload.WriteString(objectId);
+        value.Write(payload);
+        Queue(commandId, payload, false, std::move(done));
+    }
+
+    // Queues a get command; done receives the decoded value.
+    void Get(uint8_t commandId, uint8_t variable, const std::string &objectId, Callback done) {
+        TraciBuffer payload;
+        payload.WriteU8(variable);
+        payload.WriteString(objectId);
+        Queue(commandId, payload, true, std::move(done));
+    }
+
+    // Queues a get command whose result is delivered through a future,
+    // ready once the batch has been flushed.
+    std::future<TraciResult> GetAsync(uint8_t commandId, uint8_t variable, const std::string &objectId) {
+        auto promise = std::make_shared<std::promise<TraciResult>>();
+        std::future<TraciResult> future = promise->get_future();
+        Get(commandId, variable, objectId, [promise](const TraciResult &r) { promise->set_value(r); });
+        return future;
+    }
+
+    void SetTrafficLightProgram(const std::string &tlsId, const std::string &program, Callback done = nullptr) {
+        Set(traci::CMD_SET_TL_VARIABLE, traci::TL_PROGRAM, tlsId, TraciValue::String(program), std::move(done));
+    }
+
+    void SetTrafficLightPhase(const std::string &tlsId, int32_t phase, Callback done = nullptr) {
+        Set(traci::CMD_SET_TL_VARIABLE, traci::TL_PHASE_INDEX, tlsId, TraciValue::Integer(phase), std::move(done));
+    }
+
+    // Sets the remaining duration of the light's current phase.
+    void SetTrafficLightPhaseDuration(const std::string &tlsId, double seconds, Callback done = nullptr) {
+        Set(traci::CMD_SET_TL_VARIABLE, traci::TL_PHASE_DURATION, tlsId, TraciValue::Double(seconds),
+            std::move(done));
+    }
+
+    // Has SUMO write its simulation state (vehicles, lights, time) to a file,
+    // and replace the running simulation with one saved earlier.
+    void SaveState(const std::string &file, Callback done = nullptr) {
+        Set(traci::CMD_SET_SIM_VARIABLE, traci::CMD_SAVE_SIMSTATE, "", TraciValue::String(file), std::move(done));
+    }
+
+    void LoadState(const std::string &file, Callback done = nullptr) {
+        Set(traci::CMD_SET_SIM_VARIABLE, traci::CMD_LOAD_SIMSTATE, "", TraciValue::String(file), std::move(done));
+    }
+
+    // Advances SUMO to targetTime seconds (0 = one step). Subscription
+    // results in the reply are skipped.
+    void SimulationStep(double targetTime, Callback done = nullptr) {
+        TraciBuffer payload;
+        payload.WriteDouble(targetTime);
+        Queue(traci::CMD_SIMSTEP, payload, false, std::move(done));
+    }
+
+    // Sets this client's execution order when several clients share SUMO.
+    void SetOrder(int32_t order, Callback done = nullptr) {
+        TraciBuffer payload;
+        payload.WriteI32(order);
+        Queue(traci::CMD_SETORDER, payload, false, std::move(done));
+    }
+
+    // Asks SUMO to end the simulation and close the connection.
+    void Close(Callback done = nullptr) { Queue(traci::CMD_CLOSE, TraciBuffer(), false, std::move(done)); }
+
+    size_t Pending() const { return m_pending.size(); }
+    uint64_t MessagesSent() const { return m_messages; }
+    uint64_t CommandsSent() const { return m_commands; }
+
+    // Sends every queued command in one message and dispatches the results.
+    // Returns false if the exchange or the reply framing failed, in which
+    // case every unanswered command is completed with ok = false.
+    bool Flush(TraciTransport &transport) {
+        if (m_pending.empty())
+            return true;
+        std::vector<QueuedCommand> pending;
+        pending.swap(m_pending);
+        std::vector<uint8_t> request;
+        request.swap(m_message.data);
+        m_message.pos = 0;
+
+        m_messages++;
+        m_commands += pending.size();
+        TraciBuffer reply;
+        bool ok = transport.Exchange(request, reply.data);
+        // A command counts as answered only once ReadResult() has completed
+        // it; the one whose result fails to parse is completed below.
+        size_t answered = 0;
+        while (ok && answered < pending.size()) {
+            ok = ReadResult(reply, pending[answered]);
+            if (ok)
+                answered++;
+        }
+        for (size_t i = answered; i < pending.size(); i++) {
+            TraciResult failed;
+            failed.error = "no reply from TraCI server";
+            if (pending[i].done)
+                pending[i].done(failed);
+        }
+        request.clear();
+        m_message.data.swap(request);  // Keep the capacity for the next tick
+        return ok;
+    }
+
+private:
+    struct QueuedCommand {
+        uint8_t commandId;
+        bool expectsValue;
+        Callback done;
+    };
+
+    void Queue(uint8_t commandId, const TraciBuffer &payload, bool expectsValue, Callback done) {
+        AppendTraciCommand(m_message, commandId, payload.data);
+        m_pending.push_back(QueuedCommand{commandId, expectsValue, std::move(done)});
+    }
+
+    // Consumes the status (and result, for gets) of one command.
+    bool ReadResult(TraciBuffer &reply, const QueuedCommand &command) {
+        TraciResult result;
+        size_t start = reply.pos;
+        size_t length = ReadTraciCommandLength(reply);
+        if (length == 0)
+            return false;
+        uint8_t id = reply.ReadU8();
+        uint8_t status = reply.ReadU8();
+        result.error = reply.ReadString();
+        reply.pos = start + length;
+        if (reply.error || id != command.commandId)
+            return false;
+        result.ok = status == traci::RTYPE_OK;
+
+        if (result.ok && command.expectsValue) {
+            start = reply.pos;
+            length = ReadTraciCommandLength(reply);
+            if (length == 0)
+                return false;
+            reply.ReadU8();      // Response ID
+            reply.ReadU8();      // Variable
+            reply.ReadString();  // Object ID
+            result.ok = result.value.Read(reply);
+            reply.pos = start + length;
+        } else if (result.ok && command.commandId == traci::CMD_SIMSTEP) {
+            int32_t subscriptions = reply.ReadI32();
+            for (int32_t i = 0; i < subscriptions && !reply.error; i++) {
+                start = reply.pos;
+                length = ReadTraciCommandLength(reply);
+                reply.pos = start + length;
+            }
+        }
+        if (reply.error)
+            return false;
+        if (command.done)
+            command.done(result);
+        return true;
+    }
+
+    TraciBuffer m_message;
+    std::vector<QueuedCommand> m_pending;
+    uint64_t m_messages = 0;
+    uint64_t m_commands = 0;
+};
+
+#endif // TRACI_BATCH_H
@@ -0,0 +1,254 @@
+#ifndef TRAFFIC_CONTROL_H
+#define TRAFFIC_CONTROL_H
+
+// Sensor-driven traffic light control, shared by the file-fed SUMO bridge
+// (sumo-ns3-integration) and the in-process co-simulation (wsn-sumo-cosim).
+//
+// Header-only for the scratch build; include it after NS_LOG_COMPONENT_DEFINE,
+// it logs under the including program's component.
+
+#include "ns3/core-module.h"
+#include "ns3/traci-module.h"
+#include "junction-state.h"
+#include "signal-policy.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace ns3;
+
+// Data structure including an emergency flag.
+struct TrafficData {
+  uint32_t vehicleCount;
+  bool emergency;
+};
+
+// Destination for the controller's traffic light commands. Commands are
+// queued during a control tick and sent together by Flush(), so a sink that
+// can pipeline them (see TraciCommandBatch in traci-batch.h) pays one round
+// trip per tick.
+class TrafficLightCommandSink
+{
+public:
+  virtual ~TrafficLightCommandSink() {}
+  virtual void SetProgram(const std::string &tlsId, const std::string &program) = 0;
+  virtual void SetPhase(const std::string &tlsId, int32_t phase) = 0;
+  virtual void SetPhaseDuration(const std::string &tlsId, double seconds) = 0;
+  virtual void Flush() = 0;
+};
+
+// Sends the queued commands through the ns-3 TraciClient. The client owns
+// its socket and only exposes blocking calls, so each command is still its
+// own round trip.
+class TraciClientCommandSink : public TrafficLightCommandSink
+{
+public:
+  explicit TraciClientCommandSink(Ptr<TraciClient> client) : m_client(client) {}
+
+  void SetProgram(const std::string &tlsId, const std::string &program) override
+  {
+    m_pending.push_back({tlsId, Command::kProgram, program, 0.0});
+  }
+
+  void SetPhase(const std::string &tlsId, int32_t phase) override
+  {
+    m_pending.push_back({tlsId, Command::kPhase, std::string(), static_cast<double>(phase)});
+  }
+
+  void SetPhaseDuration(const std::string &tlsId, double seconds) override
+  {
+    m_pending.push_back({tlsId, Command::kPhaseDuration, std::string(), seconds});
+  }
+
+  void Flush() override
+  {
+    for (const Command &command : m_pending) {
+      switch (command.kind) {
+      case Command::kProgram:
+        m_client->TrafficLightSetProgram(command.tlsId, command.program);
+        break;
+      case Command::kPhase:
+        m_client->TrafficLightSetPhase(command.tlsId, static_cast<int32_t>(command.value));
+        break;
+      case Command::kPhaseDuration:
+        m_client->TrafficLightSetPhaseDuration(command.tlsId, command.value);
+        break;
+      }
+    }
+    m_pending.clear();
+  }
+
+private:
+  struct Command {
+    enum Kind { kProgram, kPhase, kPhaseDuration };
+    std::string tlsId;
+    Kind kind;
+    std::string program;
+    double value;
+  };
+
+  Ptr<TraciClient> m_client;
+  std::vector<Command> m_pending;
+};
+
+// Static traffic-light topology, fetched from SUMO once on the first control
+// tick, plus the program last sent to each light so SetProgram is only
+// issued when the computed program actually changes.
+struct TrafficLightControl {
+  std::string id;
+  std::vector<std::string> junctions;
+  std::vector<uint32_t> junctionIds;       // The junctions' IDs in the JunctionStateStore
+  std::string program;                     // Empty until the controller first sets one
+  const SumoTrafficLight *plan = nullptr;  // Phase plan, for the phase-timing policies
+  PhaseClock clock;
+  bool emergency = false;                  // The policy is serving an emergency at this light
+};
+
+// Runs a SignalControlPolicy (fixed thresholds unless SetPolicy() is called)
+// over every traffic light once per control tick.
+class TrafficLightController
+{
+public:
+  TrafficLightController() : m_policy(new FixedThresholdPolicy()) {}
+
+  // The phase-timing policies also need the lights' phase plans from the
+  // network file (SetPlans) and per-lane counts passed to Adjust().
+  void SetPolicy(std::unique_ptr<SignalControlPolicy> policy) { m_policy = std::move(policy); }
+  const SignalControlPolicy &Policy() const { return *m_policy; }
+
+  void SetPlans(const std::map<std::string, SumoTrafficLight> &plans) { m_plans = plans; }
+
+  void CacheTopology(Ptr<TraciClient> client, JunctionStateStore &junctionState)
+  {
+    std::vector<std::pair<std::string, std::vector<std::string>>> lights;
+    for (const std::string &tlsId : client->TrafficLightGetIDList()) {
+      lights.emplace_back(tlsId, client->TrafficLightGetControlledJunctions(tlsId));
+    }
+    SetTopology(lights, junctionState);
+    NS_LOG_INFO("Cached topology of " << m_lights.size() << " traffic lights");
+  }
+
+  // Light IDs with the junctions each controls, as CacheTopology() reads
+  // them from SUMO. Also interns the junctions, so ticks look them up by ID.
+  void SetTopology(const std::vector<std::pair<std::string, std::vector<std::string>>> &lights,
+                   JunctionStateStore &junctionState)
+  {
+    m_lights.clear();
+    for (const auto &light : lights) {
+      TrafficLightControl tls;
+      tls.id = light.first;
+      tls.junctions = light.second;
+      for (const std::string &junction : tls.junctions) {
+        tls.junctionIds.push_back(junctionState.Intern(junction));
+      }
+      auto plan = m_plans.find(tls.id);
+      if (plan != m_plans.end()) {
+        tls.plan = &plan->second;
+      }
+      m_lights.push_back(tls);
+    }
+    m_cached = true;
+  }
+
+  // Asks the policy about every light, given the windowed per-junction
+  // sensor state and, when sensors are mapped to lanes, the latest count per
+  // lane, and sends what changed. Returns the number of lights given a
+  // command.
+  uint32_t Adjust(Ptr<TraciClient> client, JunctionStateStore &junctionState,
+                  TrafficLightCommandSink &commands, const LaneReadings *lanes = nullptr)
+  {
+    NS_LOG_INFO("Adjusting traffic light timings based on sensor data at time " 
+                << Simulator::Now().GetSeconds());
+
+    if (!m_cached) {
+      CacheTopology(client, junctionState);
+    }
+    return Decide(junctionState, commands, lanes, Simulator::Now().GetSeconds(),
+                  [&client](const std::string &tlsId) { return client->TrafficLightGetPhase(tlsId); });
+  }
+
+  // One control tick without SUMO: the topology comes from SetTopology() and
+  // currentPhase(tlsId) stands in for TraCI's phase query, which only the
+  // phase-timing policies make.
+  template <typename PhaseReader>
+  uint32_t Decide(JunctionStateStore &junctionState, TrafficLightCommandSink &commands, const LaneReadings *lanes,
+                  double now, PhaseReader &&currentPhase)
+  {
+    m_ticks++;
+    uint32_t changes = 0;
+    for (TrafficLightControl &tls : m_lights) {
+      int totalVehicles = 0;
+      bool emergencyDetected = false;
+      for (uint32_t junction : tls.junctionIds) {
+        totalVehicles += junctionState.Vehicles(junction);
+        if (junctionState.Emergency(junction, now)) {
+          emergencyDetected = true;
+        }
+      }
+
+      SignalObservation obs;
+      obs.plan = tls.plan;
+      obs.totalVehicles = totalVehicles;
+      obs.emergency = emergencyDetected;
+      obs.lanes = lanes;
+      if (m_policy->UsesPhases() && tls.plan != nullptr) {
+        obs.phase = currentPhase(tls.id);
+        obs.timeInPhase = tls.clock.Observe(obs.phase, now);
+      }
+      SignalDecision decision = m_policy->Decide(tls.id, obs);
+      tls.emergency = decision.emergency;
+
+      // SUMO starts a light on the last program it loaded, which need not
+      // be the one the phase plans describe; unless the policy picks a
+      // program itself, put the light on its default program first.
+      if (tls.program.empty() && decision.program.empty()) {
+        commands.SetProgram(tls.id, kSumoDefaultProgram);
+        tls.program = kSumoDefaultProgram;
+      }
+
+      bool changed = false;
+      if (!decision.program.empty() && decision.program != tls.program) {
+        NS_LOG_INFO("Switching " << tls.id << " from " << (tls.program.empty() ? "default" : tls.program)
+                    << " to " << decision.program << ", total vehicles: " << totalVehicles);
+        commands.SetProgram(tls.id, decision.program);
+        tls.program = decision.program;
+        m_programChanges++;
+        changed = true;
+      }
+      if (decision.phase >= 0) {
+        commands.SetPhase(tls.id, decision.phase);
+        tls.clock.Observe(decision.phase, now);
+        changed = true;
+      }
+      if (decision.duration >= 0) {
+        NS_LOG_INFO("Setting " << tls.id << " phase " << obs.phase << " to end in " << decision.duration
+                    << " s (" << m_policy->Name() << ")");
+        commands.SetPhaseDuration(tls.id, decision.duration);
+        m_phaseCommands++;
+        changed = true;
+      }
+      changes += changed;
+    }
+    commands.Flush();
+    return changes;
+  }
+
+  size_t NumLights() const { return m_lights.size(); }
+  uint64_t ControlTicks() const { return m_ticks; }
+  uint64_t ProgramChanges() const { return m_programChanges; }
+  uint64_t PhaseCommands() const { return m_phaseCommands; }
+  const std::vector<TrafficLightControl> &Lights() const { return m_lights; }
+
+private:
+  std::unique_ptr<SignalControlPolicy> m_policy;
+  std::map<std::string, SumoTrafficLight> m_plans;
+  std::vector<TrafficLightControl> m_lights;
+  bool m_cached = false;
+  uint64_t m_ticks = 0;
+  uint64_t m_programChanges = 0;
+  uint64_t m_phaseCommands = 0;
+};
+
+#endif // TRAFFIC_CONTROL_H
@@ -0,0 +1,446 @@
+// Benchmark suite for the project's hot paths, each timed in isolation and
+// runnable offline (no SUMO binary):
+//
+//   ingest      sensor log parsing as the SUMO bridge does it each tick: CSV
+//               rows, binary chunks, and the junction state store updates
+//   assignment  RFD -> FFD cluster-head assignment (grid index nearest and
+//               k-nearest with backups), checked against a brute-force scan
+//   control     one TrafficLightController tick per policy against a mocked
+//               TraCI: synthetic four-arm lights, phases and lane counts
+//   wsn         the WSN scenario end to end at each of --wsnNodes total
+//               nodes: topology build time and simulator events per second
+//
+// Results are printed and written to <outputDir>/wsn-benchmark.json so runs
+// can be compared between releases.
+//
+//   ./ns3 run "scratch/wsn-benchmark --suites=ingest,control --outputDir=bench"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/lr-wpan-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/energy-module.h"
+#include "ns3/traci-module.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("WsnBenchmark");
+
+#include "wsn-scenario.h"
+#include "spatial-index.h"
+#include "traffic-control.h"
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double PerSecond(double count, double ms) {
+    return ms > 0 ? 1000.0 * count / ms : 0.0;
+}
+
+// One timed measurement; extra holds any suite-specific JSON fields.
+struct BenchResult {
+    std::string suite;
+    std::string name;
+    uint64_t items;
+    double ms;
+    std::string extra;
+};
+
+// Stands in for SUMO's side of TraCI: runs each light through its phase
+// plan, applies the controller's phase commands to it and answers phase
+// queries.
+class MockTraci : public TrafficLightCommandSink {
+public:
+    explicit MockTraci(const std::map<std::string, SumoTrafficLight> &plans) {
+        for (const auto &plan : plans)
+            m_lights[plan.first] = {&plan.second, 0, plan.second.phases[0].duration};
+    }
+
+    void SetProgram(const std::string &, const std::string &) override { m_commands++; }
+    void SetPhase(const std::string &tlsId, int32_t phase) override {
+        Light &light = m_lights[tlsId];
+        light.phase = phase;
+        light.endsAt = m_now + light.plan->phases[phase].duration;
+        m_commands++;
+    }
+    void SetPhaseDuration(const std::string &tlsId, double seconds) override {
+        m_lights[tlsId].endsAt = m_now + seconds;
+        m_commands++;
+    }
+    void Flush() override {}
+
+    // Moves the clock to `now`, stepping every light past the phases that
+    // ended by then.
+    void Advance(double now) {
+        m_now = now;
+        for (auto &entry : m_lights) {
+            Light &light = entry.second;
+            while (light.endsAt <= now) {
+                light.phase = (light.phase + 1) % light.plan->phases.size();
+                light.endsAt += light.plan->phases[light.phase].duration;
+            }
+        }
+    }
+
+    int32_t Phase(const std::string &tlsId) { return m_lights[tlsId].phase; }
+    uint64_t Commands() const { return m_commands; }
+
+private:
+    struct Light {
+        const SumoTrafficLight *plan;
+        int32_t phase;
+        double endsAt;
+    };
+
+    std::map<std::string, Light> m_lights;
+    double m_now = 0.0;
+    uint64_t m_commands = 0;
+};
+
+// Times parsing `rows` readings from `nodes` sensors written as CSV and as a
+// binary sensor log, and pushing each junction's sum into a
+// JunctionStateStore as ReadTrafficSensorData() does.
+void BenchIngest(uint64_t rows, uint32_t nodes, const std::string &dir, std::vector<BenchResult> &results) {
+    std::string csvPath = dir + "/bench-sensor.csv";
+    std::string binPath = dir + "/bench-sensor.tslog";
+    {
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<uint32_t> count(0, 30);
+        CsvSensorLogWriter csv(csvPath);
+        BinarySensorLogWriter bin(binPath);
+        for (uint64_t i = 0; i < rows; i++) {
+            SensorReading reading = {0.01 * i, uint32_t(i % nodes), count(rng), (rng() % 1000) == 0};
+            csv.Append(reading);
+            bin.Append(reading);
+        }
+    }
+
+    std::vector<TrafficData> latest(nodes, {0, false});
+    uint64_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::ifstream in(csvPath.c_str(), std::ios::binary);
+    std::vector<char> buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const char *cursor = buffer.data();
+    const char *end = cursor + buffer.size();
+    const char *eol = static_cast<const char *>(std::memchr(cursor, '\n', end - cursor));  // Header
+    uint64_t parsed = 0;
+    for (cursor = eol + 1; (eol = static_cast<const char *>(std::memchr(cursor, '\n', end - cursor)));
+         cursor = eol + 1) {
+        uint32_t nodeId, vehicleCount;
+        bool emergency;
+        if (ParseSensorCsvRow(cursor, eol, nodeId, vehicleCount, emergency) && nodeId < nodes) {
+            latest[nodeId] = {vehicleCount, emergency};
+            parsed++;
+        }
+    }
+    double csvMs = ElapsedMs(start);
+    for (const TrafficData &data : latest)
+        checksum += data.vehicleCount;
+    std::ostringstream csvExtra;
+    csvExtra << ", \"bytes\": " << buffer.size() << ", \"checksum\": " << checksum;
+    results.push_back({"ingest", "csv-parse", parsed, csvMs, csvExtra.str()});
+
+    start = std::chrono::steady_clock::now();
+    BinarySensorLogReader reader;
+    uint64_t read = 0;
+    if (reader.Open(binPath)) {
+        read = reader.ReadNewChunks([&latest, nodes](const SensorLogChunkView &chunk) {
+            for (uint32_t i = 0; i < chunk.rows; i++) {
+                if (chunk.nodeId[i] < nodes)
+                    latest[chunk.nodeId[i]] = {chunk.vehicleCount[i], chunk.emergency[i] != 0};
+            }
+        });
+    }
+    double binMs = ElapsedMs(start);
+    results.push_back({"ingest", "binary-read", read, binMs, ""});
+
+    // Four sensors per junction, one sample per junction per tick of `nodes`
+    // readings.
+    uint32_t junctions = std::max<uint32_t>(nodes / 4, 1);
+    JunctionStateStore store;
+    for (uint32_t j = 0; j < junctions; j++)
+        store.Intern("J" + std::to_string(j));
+    std::vector<TrafficData> sums(junctions);
+    uint64_t ticks = std::max<uint64_t>(rows / nodes, 1);
+    start = std::chrono::steady_clock::now();
+    for (uint64_t t = 0; t < ticks; t++) {
+        sums.assign(junctions, {0, false});
+        for (uint32_t n = 0; n < nodes; n++) {
+            TrafficData &sum = sums[(n / 4) % junctions];
+            sum.vehicleCount += (latest[n].vehicleCount + t) % 31;
+            sum.emergency = sum.emergency || latest[n].emergency;
+        }
+        for (uint32_t j = 0; j < junctions; j++)
+            store.Push(j, sums[j].vehicleCount, sums[j].emergency, double(t));
+    }
+    double storeMs = ElapsedMs(start);
+    std::ostringstream storeExtra;
+    storeExtra << ", \"junctions\": " << junctions << ", \"window\": " << store.Window();
+    results.push_back({"ingest", "junction-store", ticks * junctions, storeMs, storeExtra.str()});
+
+    std::remove(csvPath.c_str());
+    std::remove(binPath.c_str());
+}
+
+// Times the grid-index cluster-head assignment wsn-scenario.h does for
+// every RFD, at the density of the default scenario.
+void BenchAssignment(uint32_t numRFD, uint32_t numFFD, uint32_t backupParents, std::vector<BenchResult> &results) {
+    double fieldSize = 100.0 * std::sqrt(numRFD / 10.0);
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<double> coord(0.0, fieldSize);
+    std::vector<double> ffdX(numFFD), ffdY(numFFD), rfdX(numRFD), rfdY(numRFD);
+    for (uint32_t j = 0; j < numFFD; j++) {
+        ffdX[j] = coord(rng);
+        ffdY[j] = coord(rng);
+    }
+    for (uint32_t i = 0; i < numRFD; i++) {
+        rfdX[i] = coord(rng);
+        rfdY[i] = coord(rng);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    GridSpatialIndex index;
+    index.Build(ffdX, ffdY);
+    double buildMs = ElapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<int64_t> choice(numRFD);
+    for (uint32_t i = 0; i < numRFD; i++)
+        choice[i] = index.Nearest(rfdX[i], rfdY[i]);
+    double nearestMs = ElapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> parents;
+    uint64_t parentCount = 0;
+    for (uint32_t i = 0; i < numRFD; i++) {
+        index.KNearest(rfdX[i], rfdY[i], 1 + backupParents, parents);
+        parentCount += parents.size();
+    }
+    double knnMs = ElapsedMs(start);
+
+    // Brute-force check on a sample of RFDs
+    uint32_t checked = std::min<uint32_t>(numRFD, 1000);
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < checked; i++) {
+        int64_t best = -1;
+        double bestD2 = std::numeric_limits<double>::max();
+        for (uint32_t j = 0; j < numFFD; j++) {
+            double dx = ffdX[j] - rfdX[i], dy = ffdY[j] - rfdY[i];
+            if (dx * dx + dy * dy < bestD2) {
+                bestD2 = dx * dx + dy * dy;
+                best = j;
+            }
+        }
+        mismatches += best != choice[i];
+    }
+
+    std::ostringstream extra;
+    extra << ", \"numRFD\": " << numRFD << ", \"numFFD\": " << numFFD;
+    results.push_back({"assignment", "grid-build", numFFD, buildMs, extra.str()});
+    std::ostringstream nearestExtra;
+    nearestExtra << extra.str() << ", \"mismatches\": " << mismatches << ", \"checked\": " << checked;
+    results.push_back({"assignment", "nearest", numRFD, nearestMs, nearestExtra.str()});
+    std::ostringstream knnExtra;
+    knnExtra << extra.str() << ", \"k\": " << 1 + backupParents << ", \"parents\": " << parentCount;
+    results.push_back({"assignment", "k-nearest", numRFD, knnMs, knnExtra.str()});
+}
+
+// Times `ticks` one-second control ticks of each policy over `numLights`
+// synthetic four-arm lights. Every light has one junction and four incoming
+// lanes, two green phases (N-S, E-W) with yellows and fresh junction and
+// lane counts each tick. Only the controller's Decide() is timed; the mock
+// TraCI's bookkeeping is not.
+void BenchControl(uint32_t numLights, uint32_t ticks, const std::vector<std::string> &policies,
+                  std::vector<BenchResult> &results) {
+    std::map<std::string, SumoTrafficLight> plans;
+    std::vector<std::pair<std::string, std::vector<std::string>>> topology;
+    std::vector<std::string> lanes;
+    for (uint32_t l = 0; l < numLights; l++) {
+        std::string id = "TL" + std::to_string(l);
+        SumoTrafficLight plan;
+        plan.id = id;
+        plan.phases = {{30.0, "GrGr"}, {3.0, "yryr"}, {30.0, "rGrG"}, {3.0, "ryry"}};
+        for (uint32_t arm = 0; arm < 4; arm++) {
+            plan.linkFrom.push_back(id + "_in" + std::to_string(arm));
+            plan.linkTo.push_back(id + "_out" + std::to_string((arm + 2) % 4));
+            lanes.push_back(plan.linkFrom.back());
+        }
+        plans[id] = plan;
+        topology.emplace_back(id, std::vector<std::string>{"J" + std::to_string(l)});
+    }
+
+    for (const std::string &name : policies) {
+        std::unique_ptr<SignalControlPolicy> policy = CreateSignalPolicy(name, 1.0);
+        if (!policy) {
+            std::cerr << "Unknown signal policy " << name << std::endl;
+            continue;
+        }
+        TrafficLightController controller;
+        controller.SetPlans(plans);
+        controller.SetPolicy(std::move(policy));
+        JunctionStateStore store;
+        controller.SetTopology(topology, store);
+        MockTraci traci(plans);
+        LaneReadings laneReadings;
+        for (const std::string &lane : lanes)
+            laneReadings[lane] = LaneReading();
+
+        auto currentPhase = [&traci](const std::string &tlsId) { return traci.Phase(tlsId); };
+
+        std::mt19937 rng(3);
+        std::uniform_int_distribution<uint32_t> count(0, 20);
+        double decideMs = 0.0;
+        uint64_t changes = 0;
+        for (uint32_t tick = 0; tick < ticks; tick++) {
+            traci.Advance(double(tick));
+            for (uint32_t l = 0; l < numLights; l++)
+                store.Push(l, count(rng), rng() % 500 == 0, double(tick));
+            for (auto &lane : laneReadings)
+                lane.second.vehicles = count(rng) / 4;
+
+            auto start = std::chrono::steady_clock::now();
+            changes += controller.Decide(store, traci, &laneReadings, double(tick), currentPhase);
+            decideMs += ElapsedMs(start);
+        }
+
+        std::ostringstream extra;
+        extra << ", \"lights\": " << numLights << ", \"ticks\": " << ticks << ", \"usPerTick\": "
+              << 1000.0 * decideMs / std::max<uint32_t>(ticks, 1) << ", \"lightsChanged\": " << changes
+              << ", \"commands\": " << traci.Commands();
+        results.push_back({"control", name, uint64_t(numLights) * ticks, decideMs, extra.str()});
+    }
+}
+
+// Builds and runs the WSN scenario with about `nodes` nodes in total (one
+// FPC, one FFD per ten RFDs) at the default scenario's density.
+bool BenchWsn(uint32_t nodes, double simTime, const std::string &dir, std::vector<BenchResult> &results) {
+    ScenarioConfig config;
+    config.numFPC = 1;
+    config.numFFD = std::max<uint32_t>(nodes / 11, 1);
+    config.numRFD = nodes > config.numFFD + 1 ? nodes - config.numFFD - 1 : 1;
+    config.fieldSize = 100.0 * std::sqrt(std::max(config.numRFD / 10.0, 1.0));
+    config.simTime = simTime;
+    config.outputDir = dir + "/wsn-" + std::to_string(nodes);
+    config.animation = false;
+    SystemPath::MakeDirectories(config.outputDir);
+
+    ScenarioContext context;
+    context.demand = CreateDemandModel(config.demandModel);
+    auto start = std::chrono::steady_clock::now();
+    WsnNetwork net;
+    if (!BuildWsnNetwork(config, WsnLayout(), context, net)) {
+        Simulator::Destroy();
+        return false;
+    }
+    double buildMs = ElapsedMs(start);
+
+    Simulator::Stop(Seconds(simTime));
+    start = std::chrono::steady_clock::now();
+    Simulator::Run();
+    double runMs = ElapsedMs(start);
+    uint64_t events = Simulator::GetEventCount();
+    Simulator::Destroy();
+
+    std::ostringstream extra;
+    extra << ", \"nodes\": " << config.numFPC + config.numFFD + config.numRFD << ", \"simTime\": " << simTime
+          << ", \"buildMs\": " << buildMs << ", \"packetsSent\": " << context.packetsSent
+          << ", \"packetsReceived\": " << context.packetsReceived
+          << ", \"simSecondsPerWallSecond\": " << (runMs > 0 ? 1000.0 * simTime / runMs : 0.0);
+    results.push_back({"wsn", "nodes-" + std::to_string(nodes), events, runMs, extra.str()});
+    return true;
+}
+
+static std::vector<std::string> SplitList(const std::string &list) {
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+int main(int argc, char *argv[]) {
+    std::string suites = "ingest,assignment,control,wsn";
+    std::string outputDir = ".";
+    uint64_t ingestRows = 1000000;
+    uint32_t ingestNodes = 1000;
+    uint32_t assignRFD = 100000;
+    uint32_t assignFFD = 4000;
+    uint32_t backupParents = 2;
+    uint32_t lights = 1000;
+    uint32_t controlTicks = 200;
+    std::string policies = "fixed-threshold,max-pressure,actuated";
+    std::string wsnNodes = "10,1000,10000";
+    double wsnSimTime = 10.0;
+
+    CommandLine cmd;
+    cmd.AddValue("suites", "Comma-separated suites: ingest, assignment, control, wsn", suites);
+    cmd.AddValue("outputDir", "Directory for wsn-benchmark.json and scratch files", outputDir);
+    cmd.AddValue("ingestRows", "Sensor readings per log for the ingest suite", ingestRows);
+    cmd.AddValue("ingestNodes", "Sensors writing the ingest logs", ingestNodes);
+    cmd.AddValue("assignRFD", "RFDs to assign in the assignment suite", assignRFD);
+    cmd.AddValue("assignFFD", "FFDs to assign them to", assignFFD);
+    cmd.AddValue("backupParents", "Backup parents per RFD for the k-nearest query", backupParents);
+    cmd.AddValue("lights", "Traffic lights in the control suite", lights);
+    cmd.AddValue("controlTicks", "Control ticks per policy", controlTicks);
+    cmd.AddValue("policies", "Comma-separated signal policies for the control suite", policies);
+    cmd.AddValue("wsnNodes", "Comma-separated total node counts for the wsn suite", wsnNodes);
+    cmd.AddValue("wsnSimTime", "Simulated seconds per wsn suite run", wsnSimTime);
+    cmd.Parse(argc, argv);
+
+    SystemPath::MakeDirectories(outputDir);
+    std::vector<BenchResult> results;
+    for (const std::string &suite : SplitList(suites)) {
+        if (suite == "ingest") {
+            BenchIngest(ingestRows, std::max<uint32_t>(ingestNodes, 1), outputDir, results);
+        } else if (suite == "assignment") {
+            BenchAssignment(assignRFD, std::max<uint32_t>(assignFFD, 1), backupParents, results);
+        } else if (suite == "control") {
+            BenchControl(lights, controlTicks, SplitList(policies), results);
+        } else if (suite == "wsn") {
+            for (const std::string &nodes : SplitList(wsnNodes)) {
+                if (!BenchWsn(std::stoul(nodes), wsnSimTime, outputDir, results)) {
+                    std::cerr << "WSN scenario with " << nodes << " nodes failed" << std::endl;
+                    return 1;
+                }
+            }
+        } else {
+            std::cerr << "Unknown suite " << suite << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream json((outputDir + "/wsn-benchmark.json").c_str());
+    json << "[";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        std::cout << "  " << r.suite << "/" << r.name << ": " << r.items << " in " << r.ms << " ms ("
+                  << PerSecond(r.items, r.ms) << "/s)" << std::endl;
+        json << (i ? ", " : "") << "{\"suite\": \"" << r.suite << "\", \"name\": \"" << r.name << "\""
+             << ", \"items\": " << r.items << ", \"ms\": " << r.ms << ", \"perSecond\": " << PerSecond(r.items, r.ms)
+             << r.extra << "}";
+    }
+    json << "]" << std::endl;
+    std::cout << "Results written to " << outputDir << "/wsn-benchmark.json" << std::endl;
+    return 0;
+}
@@ -0,0 +1,327 @@
+#ifndef WSN_CHECKPOINT_H
+#define WSN_CHECKPOINT_H
+
+// Checkpoint/restore for long WSN runs. CaptureWsnCheckpoint() records a
+// running scenario: the counters and pending timers of every sensor and
+// cluster-head application, the position of every random stream, the
+// scenario-wide and per-node statistics and each node's remaining battery.
+// RestoreWsnCheckpoint() sets up a freshly built network of the same shape to
+// carry on from there, so parameter sweeps that share a warm-up can fork from
+// one checkpoint instead of replaying it, and a long run can be resumed.
+//
+// ns-3 cannot serialise its event queue, so a restore is a warm start: the
+// restored applications start at the checkpoint time with their timers
+// re-armed at the saved offsets, and as nothing is scheduled before that the
+// simulator jumps straight there. Frames on air or queued in the MAC at the
+// checkpoint are not captured and radios restart idle; delay histograms and
+// per-node energy consumption count from the checkpoint on.
+//
+// The file is plain text, one record per line:
+//   wsn-checkpoint 2
+//   time <seconds>
+//   scenario <FPCs> <FFDs> <RFDs>
+//   sumo-state <path>            (co-simulation only; the rest of the line)
+//   counters <packetsSent> <packetsReceived> <totalDelay> <emergencyEvents> <relayReadings>
+//            <relayFrames> <relayBytes> <unbatchedFrames> <unbatchedBytes> <perHopDelay> <sinkBytes>
+//   hops <sent|delivered> <count per route length...>
+//   node <index> <dataCount> <remainingJ> <demandDraws> <sent> <delivered> <highestSeq> <lastSeq>
+//   sensor <rfd> <started> <packetsSent> <seq> <lastCount> <nextSendNs> <nextEmergencyNs> <emergencyDraws>
+//   head <ffd> <started> <nextFlushNs> <records> then, per record,
+//        <nodeId> <samples> <count> <maxCount> <emergency> <seq> <sampledUs> <lanes> <count per lane...>
+//
+// Header-only for the scratch build; include it after wsn-scenario.h.
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct WsnCheckpoint {
+    double time = 0.0;
+    uint32_t numFPC = 0;
+    uint32_t numFFD = 0;
+    uint32_t numRFD = 0;
+    std::string sumoState;  // SUMO state saved at the same time, if any
+
+    uint64_t packetsSent = 0;
+    uint64_t packetsReceived = 0;
+    double totalDelaySeconds = 0.0;
+    uint64_t emergencyEvents = 0;
+    uint64_t relayReadings = 0;
+    uint64_t relayFrames = 0;
+    uint64_t relayBytes = 0;
+    uint64_t unbatchedFrames = 0;
+    uint64_t unbatchedBytes = 0;
+    double perHopDelaySeconds = 0.0;
+    uint64_t sinkBytes = 0;
+    std::vector<uint64_t> readingsSentByHops;
+    std::vector<uint64_t> readingsDeliveredByHops;
+
+    // Per node, by scenario index
+    std::vector<uint32_t> nodeDataCount;
+    std::vector<double> remainingJ;
+    std::vector<uint64_t> demandDraws;
+    std::vector<NodeDelivery> delivery;
+
+    std::vector<SensorAppState> sensors;  // Per RFD
+    std::vector<ClusterHeadState> heads;  // Per FFD
+
+    bool Write(const std::string &path) const {
+        std::ofstream out(path.c_str());
+        if (!out)
+            return false;
+        out << std::setprecision(17);
+        out << "wsn-checkpoint 2\n";
+        out << "time " << time << "\n";
+        out << "scenario " << numFPC << " " << numFFD << " " << numRFD << "\n";
+        if (!sumoState.empty())
+            out << "sumo-state " << sumoState << "\n";
+        out << "counters " << packetsSent << " " << packetsReceived << " " << totalDelaySeconds << " "
+            << emergencyEvents << " " << relayReadings << " " << relayFrames << " " << relayBytes << " "
+            << unbatchedFrames << " " << unbatchedBytes << " " << perHopDelaySeconds << " " << sinkBytes << "\n";
+        WriteHops(out, "sent", readingsSentByHops);
+        WriteHops(out, "delivered", readingsDeliveredByHops);
+        for (size_t i = 0; i < nodeDataCount.size(); i++) {
+            const NodeDelivery &d = delivery[i];
+            out << "node " << i << " " << nodeDataCount[i] << " " << remainingJ[i] << " "
+                << (i < demandDraws.size() ? demandDraws[i] : 0) << " " << d.sent << " " << d.delivered << " "
+                << d.highestSeq << " " << d.lastSeq << "\n";
+        }
+        for (size_t i = 0; i < sensors.size(); i++) {
+            const SensorAppState &s = sensors[i];
+            out << "sensor " << i << " " << s.started << " " << s.packetsSent << " " << s.seq << " "
+                << unsigned(s.lastCount) << " " << s.nextSendNs << " " << s.nextEmergencyNs << " "
+                << s.emergencyDraws << "\n";
+        }
+        for (size_t i = 0; i < heads.size(); i++) {
+            const ClusterHeadState &h = heads[i];
+            out << "head " << i << " " << h.started << " " << h.nextFlushNs << " " << h.pending.size();
+            for (const SensorRecord &r : h.pending) {
+                out << " " << r.nodeId << " " << unsigned(r.samples) << " " << unsigned(r.count) << " "
+                    << unsigned(r.maxCount) << " " << r.emergency << " " << r.seq << " " << r.sampledUs << " "
+                    << unsigned(r.lanes);
+                for (uint8_t lane = 0; lane < r.lanes; lane++)
+                    out << " " << unsigned(r.laneCounts[lane]);
+            }
+            out << "\n";
+        }
+        return bool(out);
+    }
+
+    bool Read(const std::string &path) {
+        std::ifstream in(path.c_str());
+        std::string line;
+        if (!std::getline(in, line) || line != "wsn-checkpoint 2")
+            return false;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string kind;
+            fields >> kind;
+            if (kind == "time") {
+                fields >> time;
+            } else if (kind == "scenario") {
+                fields >> numFPC >> numFFD >> numRFD;
+                uint32_t nodes = numFPC + numFFD + numRFD;
+                nodeDataCount.assign(nodes, 0);
+                remainingJ.assign(nodes, 0.0);
+                demandDraws.assign(nodes, 0);
+                delivery.assign(nodes, NodeDelivery());
+                sensors.assign(numRFD, SensorAppState());
+                heads.assign(numFFD, ClusterHeadState());
+            } else if (kind == "sumo-state") {
+                std::getline(fields >> std::ws, sumoState);
+            } else if (kind == "counters") {
+                fields >> packetsSent >> packetsReceived >> totalDelaySeconds >> emergencyEvents >> relayReadings >>
+                    relayFrames >> relayBytes >> unbatchedFrames >> unbatchedBytes >> perHopDelaySeconds >> sinkBytes;
+            } else if (kind == "hops") {
+                std::string which;
+                fields >> which;
+                std::vector<uint64_t> &byHops = which == "sent" ? readingsSentByHops : readingsDeliveredByHops;
+                uint64_t n;
+                while (fields >> n)
+                    byHops.push_back(n);
+                continue;
+            } else if (kind == "node") {
+                uint32_t i;
+                if (!(fields >> i) || i >= nodeDataCount.size())
+                    return false;
+                NodeDelivery &d = delivery[i];
+                fields >> nodeDataCount[i] >> remainingJ[i] >> demandDraws[i] >> d.sent >> d.delivered >>
+                    d.highestSeq >> d.lastSeq;
+            } else if (kind == "sensor") {
+                uint32_t i;
+                unsigned lastCount = 0;
+                if (!(fields >> i) || i >= sensors.size())
+                    return false;
+                SensorAppState &s = sensors[i];
+                fields >> s.started >> s.packetsSent >> s.seq >> lastCount >> s.nextSendNs >> s.nextEmergencyNs >>
+                    s.emergencyDraws;
+                s.lastCount = static_cast<uint8_t>(lastCount);
+            } else if (kind == "head") {
+                uint32_t i;
+                size_t records = 0;
+                if (!(fields >> i) || i >= heads.size())
+                    return false;
+                ClusterHeadState &h = heads[i];
+                fields >> h.started >> h.nextFlushNs >> records;
+                for (size_t k = 0; k < records && fields; k++) {
+                    unsigned samples, count, maxCount, lanes = 0;
+                    SensorRecord r;
+                    fields >> r.nodeId >> samples >> count >> maxCount >> r.emergency >> r.seq >> r.sampledUs >> lanes;
+                    r.samples = static_cast<uint8_t>(samples);
+                    r.count = static_cast<uint8_t>(count);
+                    r.maxCount = static_cast<uint8_t>(maxCount);
+                    r.lanes = static_cast<uint8_t>(std::min(lanes, kMaxSensorLanes));
+                    for (uint8_t lane = 0; lane < r.lanes; lane++) {
+                        unsigned laneCount = 0;
+                        fields >> laneCount;
+                        r.laneCounts[lane] = static_cast<uint8_t>(laneCount);
+                    }
+                    h.pending.push_back(r);
+                }
+            } else {
+                continue;  // Unknown records are skipped
+            }
+            if (fields.fail())
+                return false;
+        }
+        return numFPC + numFFD + numRFD > 0;
+    }
+
+private:
+    static void WriteHops(std::ostream &out, const char *which, const std::vector<uint64_t> &byHops) {
+        out << "hops " << which;
+        for (uint64_t n : byHops)
+            out << " " << n;
+        out << "\n";
+    }
+};
+
+// Records the scenario as it is now. Call it from an event scheduled at the
+// checkpoint time.
+WsnCheckpoint CaptureWsnCheckpoint(const ScenarioContext &context, const WsnNetwork &net) {
+    WsnCheckpoint checkpoint;
+    checkpoint.time = Simulator::Now().GetSeconds();
+    checkpoint.numFPC = net.fpcNodes.GetN();
+    checkpoint.numFFD = net.ffdNodes.GetN();
+    checkpoint.numRFD = net.rfdNodes.GetN();
+
+    checkpoint.packetsSent = context.packetsSent;
+    checkpoint.packetsReceived = context.packetsReceived;
+    checkpoint.totalDelaySeconds = context.totalDelaySeconds;
+    checkpoint.emergencyEvents = context.emergencyEvents;
+    checkpoint.relayReadings = context.relayReadings;
+    checkpoint.relayFrames = context.relayFrames;
+    checkpoint.relayBytes = context.relayBytes;
+    checkpoint.unbatchedFrames = context.unbatchedFrames;
+    checkpoint.unbatchedBytes = context.unbatchedBytes;
+    checkpoint.perHopDelaySeconds = context.perHopDelaySeconds;
+    checkpoint.sinkBytes = context.sinkBytes;
+    checkpoint.readingsSentByHops = context.readingsSentByHops;
+    checkpoint.readingsDeliveredByHops = context.readingsDeliveredByHops;
+
+    checkpoint.nodeDataCount = context.nodeDataCount;
+    checkpoint.demandDraws = context.demand->StreamPositions();
+    for (uint32_t i = 0; i < net.allNodes.GetN(); i++) {
+        checkpoint.remainingJ.push_back(context.batteries[i]->GetRemainingEnergy());
+        checkpoint.delivery.push_back(context.metrics.Delivery(i));
+    }
+
+    for (uint32_t i = 0; i < net.ffdNodes.GetN(); i++) {
+        Ptr<Node> node = net.ffdNodes.Get(i);
+        Ptr<ClusterHeadApplication> app =
+            node->GetNApplications() > 0 ? DynamicCast<ClusterHeadApplication>(node->GetApplication(0)) : nullptr;
+        checkpoint.heads.push_back(app ? app->SaveState() : ClusterHeadState());
+    }
+    for (uint32_t i = 0; i < net.rfdNodes.GetN(); i++) {
+        Ptr<Node> node = net.rfdNodes.Get(i);
+        Ptr<TrafficSensorApplication> app =
+            node->GetNApplications() > 0 ? DynamicCast<TrafficSensorApplication>(node->GetApplication(0)) : nullptr;
+        checkpoint.sensors.push_back(app ? app->SaveState() : SensorAppState());
+    }
+    return checkpoint;
+}
+
+// Writes a checkpoint of the scenario to path at simulation time `at`.
+// before, if set, runs first and may add to the checkpoint (the
+// co-simulation records SUMO's state file there). Returns false, scheduling
+// nothing, if `at` has already passed.
+bool ScheduleWsnCheckpoint(Time at, const std::string &path, const ScenarioContext &context, const WsnNetwork &net,
+                           std::function<void(WsnCheckpoint &)> before = nullptr) {
+    if (at < Simulator::Now()) {
+        std::cerr << "Checkpoint time " << at.GetSeconds() << " s is before the current time "
+                  << Simulator::Now().GetSeconds() << " s" << std::endl;
+        return false;
+    }
+    Simulator::Schedule(at - Simulator::Now(), [path, &context, &net, before]() {
+        WsnCheckpoint checkpoint = CaptureWsnCheckpoint(context, net);
+        if (before)
+            before(checkpoint);
+        if (checkpoint.Write(path))
+            std::cout << "Checkpoint at " << checkpoint.time << " s written to " << path << std::endl;
+        else
+            std::cerr << "Cannot write checkpoint " << path << std::endl;
+    });
+    return true;
+}
+
+// Makes a network just built by BuildWsnNetwork() carry on from a checkpoint.
+// Applications that were running start at the checkpoint time in their saved
+// state; those not yet started keep their start times. Batteries carry on
+// from their saved charge and radios draw on them from the checkpoint time.
+// Returns false if the checkpoint was taken of a differently sized scenario.
+bool RestoreWsnCheckpoint(const WsnCheckpoint &checkpoint, ScenarioContext &context, WsnNetwork &net) {
+    if (checkpoint.numFPC != net.fpcNodes.GetN() || checkpoint.numFFD != net.ffdNodes.GetN() ||
+        checkpoint.numRFD != net.rfdNodes.GetN()) {
+        return false;
+    }
+    Time resume = Seconds(checkpoint.time);
+
+    context.packetsSent = checkpoint.packetsSent;
+    context.packetsReceived = checkpoint.packetsReceived;
+    context.totalDelaySeconds = checkpoint.totalDelaySeconds;
+    context.emergencyEvents = checkpoint.emergencyEvents;
+    context.relayReadings = checkpoint.relayReadings;
+    context.relayFrames = checkpoint.relayFrames;
+    context.relayBytes = checkpoint.relayBytes;
+    context.unbatchedFrames = checkpoint.unbatchedFrames;
+    context.unbatchedBytes = checkpoint.unbatchedBytes;
+    context.perHopDelaySeconds = checkpoint.perHopDelaySeconds;
+    context.sinkBytes = checkpoint.sinkBytes;
+    context.readingsSentByHops = checkpoint.readingsSentByHops;
+    context.readingsDeliveredByHops = checkpoint.readingsDeliveredByHops;
+
+    context.nodeDataCount = checkpoint.nodeDataCount;
+    context.demand->SkipTo(checkpoint.demandDraws);
+    for (uint32_t i = 0; i < net.allNodes.GetN(); i++) {
+        context.batteries[i]->SetInitialEnergy(checkpoint.remainingJ[i]);
+        context.radioEnergy[i]->ChargeFrom(resume);
+        context.metrics.RestoreDelivery(i, checkpoint.delivery[i]);
+    }
+
+    for (uint32_t i = 0; i < net.ffdNodes.GetN(); i++) {
+        Ptr<Node> node = net.ffdNodes.Get(i);
+        Ptr<ClusterHeadApplication> app =
+            node->GetNApplications() > 0 ? DynamicCast<ClusterHeadApplication>(node->GetApplication(0)) : nullptr;
+        if (!app || !checkpoint.heads[i].started)
+            continue;
+        app->RestoreState(checkpoint.heads[i]);
+        app->SetStartTime(resume);
+    }
+    for (uint32_t i = 0; i < net.rfdNodes.GetN(); i++) {
+        Ptr<Node> node = net.rfdNodes.Get(i);
+        Ptr<TrafficSensorApplication> app =
+            node->GetNApplications() > 0 ? DynamicCast<TrafficSensorApplication>(node->GetApplication(0)) : nullptr;
+        if (!app || !checkpoint.sensors[i].started)
+            continue;
+        app->RestoreState(checkpoint.sensors[i]);
+        app->SetStartTime(resume);
+    }
+    return true;
+}
+
+#endif // WSN_CHECKPOINT_H
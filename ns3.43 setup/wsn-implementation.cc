@@ -6,371 +6,474 @@
 #include "ns3/applications-module.h"
 #include "ns3/netanim-module.h"
 #include "ns3/energy-module.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <memory>
 #include <vector>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TrafficWSN");
 
-// Custom header for emergency indication
-class EmergencyHeader : public Header {
-public:
-    EmergencyHeader() : m_isEmergency(false) {}
-    void SetEmergency(bool flag) { m_isEmergency = flag; }
-    bool IsEmergency() const { return m_isEmergency; }
-
-    static TypeId GetTypeId(void) {
-        static TypeId tid = TypeId("EmergencyHeader")
-            .SetParent<Header>()
-            .AddConstructor<EmergencyHeader>();
-        return tid;
+#include "wsn-scenario.h"
+#include "wsn-checkpoint.h"
+#include "wsn-partition.h"
+#include "wsn-trace.h"
+
+// Builds and runs one WSN scenario, or this rank's part of a partitioned
+// one. Returns a process exit code.
+int RunScenario(const ScenarioConfig &config, const WsnLayout &layout, const WsnPartition *partition = nullptr) {
+    const uint32_t numRFD = config.numRFD;
+    const uint32_t numFFD = config.numFFD;
+    const uint32_t numFPC = config.numFPC;
+    const double simTime = config.simTime;
+    const std::string &outputDir = config.outputDir;
+    const std::string &dataRate = config.dataRate;
+
+    ScenarioContext context;
+    context.demand = CreateDemandModel(config.demandModel);
+    if (!context.demand) {
+        std::cerr << "Unknown demand model: " << config.demandModel << std::endl;
+        return 1;
     }
 
-    virtual TypeId GetInstanceTypeId(void) const { return GetTypeId(); }
-    virtual void Serialize(Buffer::Iterator start) const {
-        start.WriteU8(m_isEmergency ? 1 : 0);
+    auto topologyStart = std::chrono::steady_clock::now();
+
+    WsnBackhaul backhaul;
+    if (partition) {
+        BuildWsnBackhaul(config.systemId, partition->ranks, PartitionLookahead(), Seconds(1.0), context, backhaul);
     }
-    virtual uint32_t GetSerializedSize(void) const { return 1; }
-    virtual uint32_t Deserialize(Buffer::Iterator start) {
-        uint8_t flag = start.ReadU8();
-        m_isEmergency = (flag == 1);
-        return GetSerializedSize();
+    WsnNetwork net;
+    if (!BuildWsnNetwork(config, layout, context, net)) {
+        Simulator::Destroy();
+        return 1;
     }
-    virtual void Print(std::ostream &os) const { os << "Emergency: " << m_isEmergency; }
-private:
-    bool m_isEmergency;
-};
-
-// Global variables for data collection
-std::map<uint32_t, uint32_t> nodeDataCount;
-std::ofstream trafficDataFile;
-
-// Renamed custom distance function to avoid ambiguity.
-double MyCalculateDistance(Vector a, Vector b) {
-    double dx = b.x - a.x;
-    double dy = b.y - a.y;
-    double dz = b.z - a.z;
-    return std::sqrt(dx * dx + dy * dy + dz * dz);
-}
-
-class TrafficSensorApplication : public Application {
-public:
-    TrafficSensorApplication();
-    virtual ~TrafficSensorApplication();
-
-    static TypeId GetTypeId(void);
-    void Setup(Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets,
-               DataRate dataRate, bool isRFD, bool simulateEmergency = false);
-
-private:
-    virtual void StartApplication(void);
-    virtual void StopApplication(void);
-
-    void SendPacket(void);
-    void SendEmergencyPacket(void);
-    void ScheduleTx(void);
-    void SleepCycle(void);
-
-    Ptr<Socket> m_socket;
-    Address m_peer;
-    uint32_t m_packetSize;
-    uint32_t m_nPackets;
-    DataRate m_dataRate;
-    EventId m_sendEvent;
-    bool m_running;
-    uint32_t m_packetsSent;
-    bool m_isRFD;
-    bool m_simulateEmergency;
-};
-
-TrafficSensorApplication::TrafficSensorApplication()
-    : m_socket(nullptr),
-      m_peer(),
-      m_packetSize(0),
-      m_nPackets(0),
-      m_dataRate(0),
-      m_running(false),
-      m_packetsSent(0),
-      m_isRFD(false),
-      m_simulateEmergency(false) {
-}
-
-TrafficSensorApplication::~TrafficSensorApplication() {
-    m_socket = nullptr;
-}
-
-TypeId TrafficSensorApplication::GetTypeId(void) {
-    static TypeId tid = TypeId("TrafficSensorApplication")
-        .SetParent<Application>()
-        .SetGroupName("WSN")
-        .AddConstructor<TrafficSensorApplication>();
-    return tid;
-}
-
-void TrafficSensorApplication::Setup(Ptr<Socket> socket, Address address, uint32_t packetSize,
-                                     uint32_t nPackets, DataRate dataRate, bool isRFD, bool simulateEmergency) {
-    m_socket = socket;
-    m_peer = address;
-    m_packetSize = packetSize;
-    m_nPackets = nPackets;
-    m_dataRate = dataRate;
-    m_isRFD = isRFD;
-    m_simulateEmergency = simulateEmergency;
-}
-
-void TrafficSensorApplication::StartApplication(void) {
-    m_running = true;
-    m_packetsSent = 0;
-
-    if (m_isRFD) {
-        Simulator::Schedule(Seconds(0.5), &TrafficSensorApplication::SleepCycle, this);
-    } else {
-        ScheduleTx();
+    const NodeContainer &fpcNodes = net.fpcNodes;
+    const NodeContainer &ffdNodes = net.ffdNodes;
+    const NodeContainer &rfdNodes = net.rfdNodes;
+    const NodeContainer &allNodes = net.allNodes;
+    std::string trafficDataPath = outputDir + "/traffic_sensor_data";
+
+    double topologyMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - topologyStart).count();
+    std::cout << "Topology built in " << topologyMs << " ms (" << numRFD << " RFD, "
+              << numFFD << " FFD, " << numFPC << " FPC)" << std::endl;
+
+    double resumedAt = 0.0;
+    if (!config.restoreFrom.empty()) {
+        WsnCheckpoint checkpoint;
+        if (!checkpoint.Read(config.restoreFrom) || !RestoreWsnCheckpoint(checkpoint, context, net)) {
+            std::cerr << "Cannot restore " << config.restoreFrom << " into a scenario of this size"
+                      << std::endl;
+            Simulator::Destroy();
+            return 1;
+        }
+        resumedAt = checkpoint.time;
+        std::cout << "Resuming from " << config.restoreFrom << " at " << resumedAt << " s" << std::endl;
+    }
+    if (config.checkpointAt > resumedAt && config.checkpointAt < simTime &&
+        !ScheduleWsnCheckpoint(Seconds(config.checkpointAt),
+                               config.checkpointFile.empty() ? outputDir + "/checkpoint.txt" : config.checkpointFile,
+                               context, net)) {
+        Simulator::Destroy();
+        return 1;
     }
-}
-
-void TrafficSensorApplication::SleepCycle(void) {
-    if (!m_running) return;
-    NS_LOG_INFO("Node " << GetNode()->GetId() << " entering sleep mode for energy saving");
-    Simulator::Schedule(Seconds(1.0), &TrafficSensorApplication::ScheduleTx, this);
-}
-
-void TrafficSensorApplication::StopApplication(void) {
-    m_running = false;
-    if (m_sendEvent.IsPending())
-        Simulator::Cancel(m_sendEvent);
-
-    if (m_socket)
-        m_socket->Close();
-}
 
-void TrafficSensorApplication::SendPacket(void) {
-    Ptr<Packet> packet = Create<Packet>(m_packetSize);
+    // NetAnim allows only one AnimationInterface per process.
+    std::unique_ptr<AnimationInterface> anim;
+    if (config.animation) {
+        anim = std::make_unique<AnimationInterface>(outputDir + "/traffic-wsn-animation.xml");
+        for (uint32_t i = 0; i < numFPC; i++) {
+            anim->UpdateNodeDescription(fpcNodes.Get(i), "FPC");
+            anim->UpdateNodeColor(fpcNodes.Get(i), 255, 0, 0);
+        }
+        for (uint32_t i = 0; i < numFFD; i++) {
+            anim->UpdateNodeDescription(ffdNodes.Get(i), "FFD");
+            anim->UpdateNodeColor(ffdNodes.Get(i), 0, 255, 0);
+        }
+        for (uint32_t i = 0; i < numRFD; i++) {
+            anim->UpdateNodeDescription(rfdNodes.Get(i), "RFD");
+            anim->UpdateNodeColor(rfdNodes.Get(i), 0, 0, 255);
+        }
+    }
 
-    if (m_isRFD) {
-        uint32_t trafficCount = rand() % 10;
-        uint32_t nodeId = GetNode()->GetId();
-        bool emergency = m_simulateEmergency && (trafficCount > 8);
+    // The sampled trace hooks the PHYs itself, so it can run alongside NetAnim.
+    std::unique_ptr<WsnPacketTrace> trace;
+    std::string tracePath = outputDir + "/traffic-wsn-trace.wstr";
+    if (config.trace) {
+        WsnTraceOptions options;
+        options.every = config.traceEvery;
+        options.start = config.traceStart;
+        options.stop = config.traceStop;
+        options.ParseNodes(config.traceNodes);
+        trace = std::make_unique<WsnPacketTrace>(options);
+        for (uint32_t i = 0; i < allNodes.GetN(); i++) {
+            uint8_t role = i < numFPC ? 0 : i < numFPC + numFFD ? 1 : 2;
+            trace->Attach(allNodes.Get(i), role, GetLrWpanDevice(allNodes.Get(i)));
+        }
+        if (!trace->Open(tracePath)) {
+            std::cerr << "Cannot write packet trace " << tracePath << std::endl;
+            Simulator::Destroy();
+            return 1;
+        }
+    }
 
-        EmergencyHeader eh;
-        eh.SetEmergency(emergency);
-        packet->AddHeader(eh);
+    Simulator::Stop(Seconds(simTime));
+    auto runStart = std::chrono::steady_clock::now();
+    Simulator::Run();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    uint64_t events = Simulator::GetEventCount();
+    anim.reset();
+    if (trace) {
+        trace->Close();
+        std::cout << "Packet trace: " << trace->Events() << " events (" << trace->Bytes() << " B) in " << tracePath
+                  << "; convert with trace-to-netanim.py" << std::endl;
+    }
 
-        trafficDataFile << Simulator::Now().GetSeconds() << ","
-                        << nodeId << ","
-                        << trafficCount << ","
-                        << (emergency ? 1 : 0) << std::endl;
+    // Remaining energy and projected lifetime at the average power drawn over
+    // the run (since the checkpoint, when restored from one).
+    std::ofstream energyFile((outputDir + "/energy.csv").c_str());
+    energyFile << "NodeID,Role,ConsumedJ,RemainingJ,AvgPowerMw,LifetimeDays\n";
+    double elapsed = Simulator::Now().GetSeconds() - resumedAt;
+    double rfdLifetimeSum = 0.0;
+    double rfdLifetimeMin = std::numeric_limits<double>::max();
+    for (uint32_t i = 0; i < allNodes.GetN(); i++) {
+        context.batteries[i]->UpdateEnergySource();
+        double consumed = context.radioEnergy[i]->GetTotalEnergyConsumption();
+        double powerW = elapsed > 0 ? consumed / elapsed : 0.0;
+        double lifetimeDays = powerW > 0 ? config.batteryJ / powerW / 86400.0 : std::numeric_limits<double>::infinity();
+        const char *role = i < numFPC ? "FPC" : i < numFPC + numFFD ? "FFD" : "RFD";
+        energyFile << allNodes.Get(i)->GetId() << "," << role << "," << consumed << ","
+                   << context.batteries[i]->GetRemainingEnergy() << "," << powerW * 1000.0 << ","
+                   << lifetimeDays << "\n";
+        if (i >= numFPC + numFFD) {
+            rfdLifetimeSum += lifetimeDays;
+            rfdLifetimeMin = std::min(rfdLifetimeMin, lifetimeDays);
+        }
+    }
+    energyFile.close();
+    double rfdLifetimeMean = numRFD > 0 ? rfdLifetimeSum / numRFD : 0.0;
+    if (numRFD == 0) {
+        rfdLifetimeMin = 0.0;
+    }
+    std::cout << "RFD projected battery lifetime (" << (config.dutyCycle ? "duty-cycled" : "always on")
+              << ", report every " << Seconds(config.reportInterval).GetSeconds() << " s): mean "
+              << rfdLifetimeMean << " days, min " << rfdLifetimeMin << " days (per node: "
+              << outputDir << "/energy.csv)" << std::endl;
+
+    // Collection tree: readings sent and delivered by route length, and what
+    // the FPCs actually absorbed.
+    std::ofstream hopsFile((outputDir + "/hops.csv").c_str());
+    hopsFile << "Hops,ReadingsSent,ReadingsDelivered,DeliveryRatio\n";
+    uint64_t deliveredReadings = 0, hopSum = 0;
+    uint32_t maxHops = 0;
+    for (size_t h = 0; h < context.readingsSentByHops.size() || h < context.readingsDeliveredByHops.size(); h++) {
+        uint64_t sent = h < context.readingsSentByHops.size() ? context.readingsSentByHops[h] : 0;
+        uint64_t delivered = h < context.readingsDeliveredByHops.size() ? context.readingsDeliveredByHops[h] : 0;
+        if (sent == 0 && delivered == 0)
+            continue;
+        hopsFile << h << "," << sent << "," << delivered << "," << (sent ? double(delivered) / sent : 0.0) << "\n";
+        deliveredReadings += delivered;
+        hopSum += h * delivered;
+        maxHops = std::max<uint32_t>(maxHops, h);
+    }
+    hopsFile.close();
+    double meanHops = deliveredReadings ? double(hopSum) / deliveredReadings : 0.0;
+    double perHopLatencyMs = context.packetsReceived ? 1000.0 * context.perHopDelaySeconds / context.packetsReceived : 0.0;
+    double sinkSeconds = (context.sinkLastRx - context.sinkFirstRx).GetSeconds();
+    double sinkThroughputKbps = sinkSeconds > 0 ? context.sinkBytes * 8 / sinkSeconds / 1000.0 : 0.0;
+    double bytesPerReading = deliveredReadings ? double(context.sinkBytes) / deliveredReadings : 0.0;
+    std::cout << (config.meshRouting ? "Mesh routing" : "Single-hop") << ": mean " << meanHops << " hops, max "
+              << maxHops << ", " << perHopLatencyMs << " ms per hop, sink throughput " << sinkThroughputKbps
+              << " kb/s (" << bytesPerReading << " bytes per reading), " << context.unreachableNodes
+              << " unreachable nodes (per hop count: " << outputDir << "/hops.csv)" << std::endl;
+
+    const LatencySamples &emergency = context.emergencyToFpc;
+    if (context.emergencyEvents > 0) {
+        std::cout << "Emergencies: " << emergency.Count() << " of " << context.emergencyEvents
+                  << " reached an FPC; sensing-to-FPC latency p50 " << emergency.PercentileMs(50) << " ms, p99 "
+                  << emergency.PercentileMs(99) << " ms, max " << emergency.MaxMs() << " ms" << std::endl;
+    }
 
-        NS_LOG_INFO("Node " << nodeId << " detected " << trafficCount
-                            << " vehicles at time " << Simulator::Now().GetSeconds()
-                            << (emergency ? " [EMERGENCY]" : ""));
+    // Reading delivery and delay from the sequence-numbered records, and link-layer losses.
+    const WsnMetrics &metrics = context.metrics;
+    metrics.WriteNodeCsv(outputDir + "/node-metrics.csv", numFPC, numFFD);
+    metrics.WriteThroughputCsv(outputDir + "/throughput.csv");
+    LogLinearHistogram delay = metrics.TotalDelay();
+    LinkCounters links = metrics.TotalLinks();
+    uint64_t readingsSent = metrics.ReadingsSent();
+    double readingPdr = readingsSent ? double(metrics.ReadingsDelivered()) / readingsSent : 0.0;
+    std::cout << "Readings: " << metrics.ReadingsDelivered() << " of " << readingsSent << " delivered ("
+              << metrics.ReadingsMissing() << " missing by sequence number), delay p50 " << delay.PercentileMs(50)
+              << " ms, p99 " << delay.PercentileMs(99) << " ms, max " << delay.MaxMs() << " ms; MAC "
+              << links.macTxOk << " ok, " << links.macTxDrop << " dropped, " << links.ccaFailures
+              << " CCA failures; PHY " << links.phyRxDrop << " rx drops; " << links.txBacklogDrop
+              << " dropped from full transmit backlogs (per node: " << outputDir
+              << "/node-metrics.csv)" << std::endl;
+    if (partition && config.systemId == 0) {
+        std::cout << "Backhaul: " << backhaul.reports << " reports from " << partition->ranks - 1
+                  << " other ranks for " << backhaul.reportedPackets << " packets received and "
+                  << backhaul.reportedEmergencies << " emergencies, mean delay "
+                  << (backhaul.reports ? 1000.0 * backhaul.reportDelaySeconds / backhaul.reports : 0.0) << " ms"
+                  << std::endl;
     }
 
-    m_socket->Send(packet);
-    m_packetsSent++;
+    Simulator::Destroy();
 
-    if (m_packetsSent < m_nPackets) {
-        ScheduleTx();
+    // Per-run summary, written via rename so a sweep never sees a partial file.
+    std::string summaryPath = outputDir + "/summary.json";
+    std::ofstream summary((summaryPath + ".tmp").c_str());
+    summary << "{\"numRFD\": " << numRFD
+            << ", \"numFFD\": " << numFFD
+            << ", \"numFPC\": " << numFPC
+            << ", \"dataRate\": \"" << dataRate << "\""
+            << ", \"simTime\": " << simTime
+            << ", \"rngRun\": " << RngSeedManager::GetRun()
+            << ", \"packetsSent\": " << context.packetsSent
+            << ", \"packetsReceived\": " << context.packetsReceived
+            << ", \"pdr\": " << (context.packetsSent ? double(context.packetsReceived) / context.packetsSent : 0.0)
+            << ", \"meanLatencyMs\": " << (context.packetsReceived ? 1000.0 * context.totalDelaySeconds / context.packetsReceived : 0.0)
+            << ", \"topologyMs\": " << topologyMs
+            << ", \"wallSeconds\": " << wallSeconds
+            << ", \"events\": " << events
+            << ", \"eventsPerSecond\": " << (wallSeconds > 0 ? events / wallSeconds : 0.0)
+            << ", \"reportInterval\": " << config.reportInterval
+            << ", \"dutyCycle\": " << (config.dutyCycle ? "true" : "false")
+            << ", \"reportPadding\": " << config.reportPadding
+            << ", \"lanesPerSensor\": " << config.lanesPerSensor
+            << ", \"rfdMeanLifetimeDays\": " << rfdLifetimeMean
+            << ", \"rfdMinLifetimeDays\": " << rfdLifetimeMin
+            << ", \"relayFrames\": " << context.relayFrames
+            << ", \"relayBytes\": " << context.relayBytes
+            << ", \"unbatchedFrames\": " << context.unbatchedFrames
+            << ", \"unbatchedBytes\": " << context.unbatchedBytes
+            << ", \"meshRouting\": " << (config.meshRouting ? "true" : "false")
+            << ", \"radioRange\": " << config.radioRange
+            << ", \"meanHops\": " << meanHops
+            << ", \"maxHops\": " << maxHops
+            << ", \"perHopLatencyMs\": " << perHopLatencyMs
+            << ", \"sinkThroughputKbps\": " << sinkThroughputKbps
+            << ", \"sinkBytesPerReading\": " << bytesPerReading
+            << ", \"unreachableNodes\": " << context.unreachableNodes
+            << ", \"readingsSent\": " << readingsSent
+            << ", \"readingsDelivered\": " << metrics.ReadingsDelivered()
+            << ", \"readingsMissing\": " << metrics.ReadingsMissing()
+            << ", \"readingPdr\": " << readingPdr
+            << ", \"delayP50Ms\": " << delay.PercentileMs(50)
+            << ", \"delayP90Ms\": " << delay.PercentileMs(90)
+            << ", \"delayP99Ms\": " << delay.PercentileMs(99)
+            << ", \"delayMaxMs\": " << delay.MaxMs()
+            << ", \"macTxOk\": " << links.macTxOk
+            << ", \"macTxDrop\": " << links.macTxDrop
+            << ", \"ccaFailures\": " << links.ccaFailures
+            << ", \"macRxDrop\": " << links.macRxDrop
+            << ", \"phyTxDrop\": " << links.phyTxDrop
+            << ", \"phyRxDrop\": " << links.phyRxDrop
+            << ", \"txBacklogDrop\": " << links.txBacklogDrop
+            << ", \"txBacklog\": " << config.txBacklog
+            << ", \"emergencyRate\": " << config.emergencyRate
+            << ", \"emergencyEvents\": " << context.emergencyEvents
+            << ", \"emergencyDelivered\": " << emergency.Count()
+            << ", \"emergencyP50Ms\": " << emergency.PercentileMs(50)
+            << ", \"emergencyP99Ms\": " << emergency.PercentileMs(99)
+            << ", \"emergencyMaxMs\": " << emergency.MaxMs()
+            << ", \"traceEvents\": " << (trace ? trace->Events() : 0);
+    if (partition) {
+        summary << ", \"rank\": " << config.systemId
+                << ", \"ranks\": " << partition->ranks
+                << ", \"radioLinks\": " << partition->radioLinks
+                << ", \"cutLinks\": " << partition->cutLinks
+                << ", \"backhaulReports\": " << backhaul.reports
+                << ", \"backhaulPackets\": " << backhaul.reportedPackets;
+    }
+    summary << "}" << std::endl;
+    summary.close();
+    std::rename((summaryPath + ".tmp").c_str(), summaryPath.c_str());
+
+    context.trafficDataLog->Close();
+
+    if (context.unbatchedFrames > 0) {
+        // Airtime at 250 kb/s per frame: payload + IPv4/UDP (28 B) + MAC header/FCS (11 B) + PHY SHR/PHR (6 B).
+        auto airtimeMs = [](uint64_t frames, uint64_t bytes) { return (bytes + frames * 45) * 8 / 250.0; };
+        double batched = airtimeMs(context.relayFrames, context.relayBytes);
+        double unbatched = airtimeMs(context.unbatchedFrames, context.unbatchedBytes);
+        std::cout << "FFD relay: " << context.relayReadings << " readings in " << context.relayFrames
+                  << " upstream frames (" << context.relayBytes << " B, " << batched << " ms airtime) vs "
+                  << context.unbatchedFrames << " frames (" << context.unbatchedBytes << " B, " << unbatched
+                  << " ms) forwarded one by one; airtime reduction "
+                  << 100.0 * (1.0 - batched / unbatched) << "%" << std::endl;
     }
-}
 
-void TrafficSensorApplication::SendEmergencyPacket(void) {
-    Ptr<Packet> packet = Create<Packet>(m_packetSize);
-    EmergencyHeader eh;
-    eh.SetEmergency(true);
-    packet->AddHeader(eh);
+    std::cout << "Simulation completed. Data stored in " << trafficDataPath
+              << (config.sensorLogFormat == "csv" ? ".csv" : config.sensorLogFormat == "both" ? ".{tslog,csv}" : ".tslog")
+              << std::endl;
 
-    m_socket->Send(packet);
-    NS_LOG_INFO("Node " << GetNode()->GetId() << " sent an emergency packet at time " << Simulator::Now().GetSeconds());
+    return 0;
 }
 
-void TrafficSensorApplication::ScheduleTx(void) {
-    if (m_running) {
-        Time tNext(Seconds(m_packetSize * 8 / static_cast<double>(m_dataRate.GetBitRate())));
-        m_sendEvent = Simulator::Schedule(tNext, &TrafficSensorApplication::SendPacket, this);
+#ifdef NS3_MPI
+// Runs this rank's districts of a scenario split across MPI ranks. Each rank
+// writes its own outputs under outputDir/rank-<r>.
+int RunPartitioned(ScenarioConfig config, const WsnLayout &layout, int *argc, char ***argv) {
+    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+    MpiInterface::Enable(argc, argv);
+    uint32_t rank = MpiInterface::GetSystemId();
+    uint32_t ranks = MpiInterface::GetSize();
+
+    WsnPartition partition;
+    if (!PartitionWsnLayout(layout, ranks, MaxLinkDistance(config), partition)) {
+        std::cerr << "Cannot split " << layout.fpc.size() << " FPC districts over " << ranks << " ranks"
+                  << std::endl;
+        MpiInterface::Disable();
+        return 1;
     }
-}
-
-void ReceivePacket(Ptr<Socket> socket) {
-    Ptr<Packet> packet;
-    Address from;
-
-    while ((packet = socket->RecvFrom(from))) {
-        EmergencyHeader eh;
-        packet->PeekHeader(eh);
-        uint32_t receiverNodeId = socket->GetNode()->GetId();
-        nodeDataCount[receiverNodeId]++;
-
-        NS_LOG_INFO("Node " << receiverNodeId << " received packet"
-                            << (eh.IsEmergency() ? " [EMERGENCY]" : ""));
-
-        if (receiverNodeId == 0) {
-            NS_LOG_INFO("FPC received data, total packets: " << nodeDataCount[receiverNodeId]);
-        }
+    if (rank == 0) {
+        std::cout << "Partitioned " << layout.fpc.size() << " districts over " << ranks << " ranks (nodes per rank:";
+        for (uint32_t n : partition.nodesPerRank)
+            std::cout << " " << n;
+        std::cout << "); " << partition.cutLinks << " of " << partition.radioLinks
+                  << " radio links cross ranks, lookahead " << PartitionLookahead().GetMicroSeconds() << " us"
+                  << std::endl;
     }
+
+    WsnLayout local = partition.LocalLayout(layout, rank);
+    config.systemId = rank;
+    config.numFPC = local.fpc.size();
+    config.numFFD = local.ffd.size();
+    config.numRFD = local.rfd.size();
+    config.outputDir += "/rank-" + std::to_string(rank);
+    config.animation = false;
+    SystemPath::MakeDirectories(config.outputDir);
+    int status = RunScenario(config, local, &partition);
+    MpiInterface::Disable();
+    return status;
 }
+#endif
 
 int main(int argc, char *argv[]) {
-    uint32_t numRFD = 10;
-    uint32_t numFFD = 3;
-    uint32_t numFPC = 1;
-    double simTime = 100.0;
-    std::string outputDir = ".";  // Default to current directory
+    ScenarioConfig config;
+    bool verbose = true;
+    uint32_t runs = 1;
+    std::string topologyFile;
+    bool partitioned = false;
 
     CommandLine cmd;
-    cmd.AddValue("numRFD", "Number of RFD nodes", numRFD);
-    cmd.AddValue("numFFD", "Number of FFD nodes", numFFD);
-    cmd.AddValue("simTime", "Simulation time in seconds", simTime);
-    cmd.AddValue("outputDir", "Directory for output files", outputDir);
+    cmd.AddValue("numRFD", "Number of RFD nodes", config.numRFD);
+    cmd.AddValue("numFFD", "Number of FFD nodes", config.numFFD);
+    cmd.AddValue("simTime", "Simulation time in seconds", config.simTime);
+    cmd.AddValue("outputDir", "Directory for output files", config.outputDir);
+    cmd.AddValue("sensorLogFormat", "Sensor log format: binary, csv or both", config.sensorLogFormat);
+    cmd.AddValue("dataRate", "Application data rate of RFD and FFD senders", config.dataRate);
+    cmd.AddValue("demandModel",
+                 "Vehicle-count model: uniform, poisson, diurnal or replay; tune it with e.g. "
+                 "--PoissonDemandModel::ArrivalRate=0.5 or --ReplayDemandModel::File=e1.xml",
+                 config.demandModel);
+    cmd.AddValue("aggregationWindow", "Seconds an FFD batches child readings (0 forwards each one)",
+                 config.aggregationWindow);
+    cmd.AddValue("reportInterval", "Seconds between RFD reports (0 derives it from packet size and data rate)",
+                 config.reportInterval);
+    cmd.AddValue("dutyCycle", "Turn RFD radios off between reports", config.dutyCycle);
+    cmd.AddValue("awakeWindow", "Seconds an RFD keeps listening after each report when duty cycling",
+                 config.awakeWindow);
+    cmd.AddValue("batteryJ", "Initial battery energy per node in joules", config.batteryJ);
+    cmd.AddValue("emergencyRate", "Emergency vehicle detections per second per RFD, reported immediately",
+                 config.emergencyRate);
+    cmd.AddValue("reportPadding", "Filler bytes after each RFD report (512 restores the old fixed-size frames)",
+                 config.reportPadding);
+    cmd.AddValue("lanesPerSensor", "Lanes each RFD counts separately; above 1 reports carry per-lane counts",
+                 config.lanesPerSensor);
+    cmd.AddValue("txBacklog", "Routine frames a node holds for its MAC before dropping the oldest (0: no limit)",
+                 config.txBacklog);
+    cmd.AddValue("meshRouting", "Route over a 6LoWPAN collection tree of FFDs instead of single-hop IPv4",
+                 config.meshRouting);
+    cmd.AddValue("radioRange", "Metres beyond which frames are lost (0: path loss only)", config.radioRange);
+    cmd.AddValue("pathLossExponent", "Log-distance path loss exponent", config.pathLossExponent);
+    cmd.AddValue("fieldSize", "Side in metres of the square the default layout covers", config.fieldSize);
+    cmd.AddValue("verbose", "Log per-packet activity", verbose);
+    cmd.AddValue("animation", "Write a NetAnim XML trace of every frame (slow on large runs; see --trace)",
+                 config.animation);
+    cmd.AddValue("trace", "Write a sampled binary packet trace; trace-to-netanim.py turns it into NetAnim XML",
+                 config.trace);
+    cmd.AddValue("traceEvery", "Trace one frame in this many (by packet UID)", config.traceEvery);
+    cmd.AddValue("traceNodes", "Node IDs to trace frames of, e.g. 0-3,17 (default: all)", config.traceNodes);
+    cmd.AddValue("traceStart", "Seconds from which frames are traced", config.traceStart);
+    cmd.AddValue("traceStop", "Seconds until which frames are traced (0: end of run)", config.traceStop);
+    cmd.AddValue("topologyFile", "sensor_map.csv from generate_grid.py; overrides numRFD/numFFD and placement",
+                 topologyFile);
+    cmd.AddValue("checkpointAt", "Save the scenario state at this time in seconds (0: never)", config.checkpointAt);
+    cmd.AddValue("checkpointFile", "Checkpoint file to write (default: outputDir/checkpoint.txt)",
+                 config.checkpointFile);
+    cmd.AddValue("restoreFrom", "Checkpoint to resume from; the scenario options must match the saved run",
+                 config.restoreFrom);
+    cmd.AddValue("partitioned", "Split the topology by FPC district across MPI ranks (run under mpirun; "
+                 "needs --topologyFile)", partitioned);
+    cmd.AddValue("runs", "Scenarios to run back to back in this process (RngRun, RngRun+1, ...)", runs);
     cmd.Parse(argc, argv);
 
-    LogComponentEnable("TrafficWSN", LOG_LEVEL_INFO);
-
-    NodeContainer fpcNodes, ffdNodes, rfdNodes;
-    fpcNodes.Create(numFPC);
-    ffdNodes.Create(numFFD);
-    rfdNodes.Create(numRFD);
-
-    NodeContainer allNodes;
-    allNodes.Add(fpcNodes);
-    allNodes.Add(ffdNodes);
-    allNodes.Add(rfdNodes);
-
-    LrWpanHelper lrWpanHelper;
-    NetDeviceContainer lrwpanDevices = lrWpanHelper.Install(allNodes);
-
-    // Assign unique short addresses to avoid IPv4 address collisions.
-    for (uint32_t i = 0; i < lrwpanDevices.GetN(); i++) {
-        Ptr<NetDevice> dev = lrwpanDevices.Get(i);
-        Ptr<ns3::lrwpan::LrWpanNetDevice> lrwpanDev = DynamicCast<ns3::lrwpan::LrWpanNetDevice>(dev);
-        if (lrwpanDev != nullptr) {
-            Ptr<ns3::lrwpan::LrWpanMac> mac = lrwpanDev->GetMac();
-            if (mac != nullptr) {
-                mac->SetShortAddress(i + 1);
-            }
-        }
+    if (verbose) {
+        LogComponentEnable("TrafficWSN", LOG_LEVEL_INFO);
     }
-
-    MobilityHelper mobility;
-    mobility.SetPositionAllocator("ns3::GridPositionAllocator",
-                                  "MinX", DoubleValue(50.0),
-                                  "MinY", DoubleValue(50.0),
-                                  "DeltaX", DoubleValue(0.0),
-                                  "DeltaY", DoubleValue(0.0),
-                                  "GridWidth", UintegerValue(1),
-                                  "LayoutType", StringValue("RowFirst"));
-    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-    mobility.Install(fpcNodes);
-
-    mobility.SetPositionAllocator("ns3::GridPositionAllocator",
-                                  "MinX", DoubleValue(30.0),
-                                  "MinY", DoubleValue(30.0),
-                                  "DeltaX", DoubleValue(20.0),
-                                  "DeltaY", DoubleValue(20.0),
-                                  "GridWidth", UintegerValue(2),
-                                  "LayoutType", StringValue("RowFirst"));
-    mobility.Install(ffdNodes);
-
-    mobility.SetPositionAllocator("ns3::RandomRectanglePositionAllocator",
-                                  "X", StringValue("ns3::UniformRandomVariable[Min=0.0|Max=100.0]"),
-                                  "Y", StringValue("ns3::UniformRandomVariable[Min=0.0|Max=100.0]"));
-    mobility.Install(rfdNodes);
-
-    InternetStackHelper internet;
-    internet.Install(allNodes);
-
-    Ipv4AddressHelper ipv4;
-    ipv4.SetBase("10.1.1.0", "255.255.255.0");
-    Ipv4InterfaceContainer interfaces = ipv4.Assign(lrwpanDevices);
-
-    // Debugging: Print the number of interfaces assigned
-    NS_LOG_INFO("Number of interfaces assigned: " << interfaces.GetN());
-
-    std::string trafficDataPath = outputDir + "/traffic_sensor_data.csv";
-    trafficDataFile.open(trafficDataPath.c_str());
-    trafficDataFile << "Time,NodeID,VehicleCount,Emergency" << std::endl;
-
-    uint16_t port = 9;
-    TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
-
-    Ptr<Socket> fpcRxSocket = Socket::CreateSocket(fpcNodes.Get(0), tid);
-    InetSocketAddress fpcRxSocketAddr = InetSocketAddress(Ipv4Address::GetAny(), port);
-    fpcRxSocket->Bind(fpcRxSocketAddr);
-    fpcRxSocket->SetRecvCallback(MakeCallback(&ReceivePacket));
-
-    std::vector<Ptr<Socket>> ffdRxSockets;
-    for (uint32_t i = 0; i < numFFD; i++) {
-        Ptr<Socket> socket = Socket::CreateSocket(ffdNodes.Get(i), tid);
-        InetSocketAddress socketAddr = InetSocketAddress(Ipv4Address::GetAny(), port);
-        socket->Bind(socketAddr);
-        socket->SetRecvCallback(MakeCallback(&ReceivePacket));
-        ffdRxSockets.push_back(socket);
-
-        Ptr<Socket> ffdTxSocket = Socket::CreateSocket(ffdNodes.Get(i), tid);
-        InetSocketAddress fpcAddr = InetSocketAddress(interfaces.GetAddress(0), port);
-
-        Ptr<TrafficSensorApplication> app = CreateObject<TrafficSensorApplication>();
-        app->Setup(ffdTxSocket, fpcAddr, 1024, 1000, DataRate("1kbps"), false, false);
-        ffdNodes.Get(i)->AddApplication(app);
-        app->SetStartTime(Seconds(1.0));
-        app->SetStopTime(Seconds(simTime));
+    if (config.lanesPerSensor < 1 || config.lanesPerSensor > kMaxSensorLanes) {
+        std::cerr << "--lanesPerSensor must be between 1 and " << kMaxSensorLanes << std::endl;
+        return 1;
+    }
+    if (config.trace && (config.traceEvery == 0 || !WsnTraceOptions().ParseNodes(config.traceNodes))) {
+        std::cerr << "--traceEvery must be at least 1 and --traceNodes a list like 0-3,17" << std::endl;
+        return 1;
     }
 
-    for (uint32_t i = 0; i < numRFD; i++) {
-        uint32_t closestFFD = 0;
-        double minDistance = std::numeric_limits<double>::max();
-
-        for (uint32_t j = 0; j < numFFD; j++) {
-            Vector ffdPos = ffdNodes.Get(j)->GetObject<MobilityModel>()->GetPosition();
-            Vector rfdPos = rfdNodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
-            double distance = MyCalculateDistance(ffdPos, rfdPos);
-            if (distance < minDistance) {
-                minDistance = distance;
-                closestFFD = j;
-            }
+    WsnLayout layout;
+    if (!topologyFile.empty()) {
+        if (!LoadWsnTopology(topologyFile, layout)) {
+            std::cerr << "Cannot read topology file " << topologyFile << std::endl;
+            return 1;
         }
+        config.numFPC = layout.fpc.size();
+        config.numFFD = layout.ffd.size();
+        config.numRFD = layout.rfd.size();
+    }
 
-        Ptr<Socket> socket = Socket::CreateSocket(rfdNodes.Get(i), tid);
-        uint32_t interfaceIndex = numFPC + closestFFD;
-        NS_LOG_INFO("Assigning interface for RFD " << i << " to FFD " << closestFFD << " with interface index " << interfaceIndex);
-        if (interfaceIndex < interfaces.GetN()) {
-            InetSocketAddress ffdAddr = InetSocketAddress(interfaces.GetAddress(interfaceIndex), port);
-
-            Ptr<TrafficSensorApplication> app = CreateObject<TrafficSensorApplication>();
-            app->Setup(socket, ffdAddr, 512, 1000, DataRate("1kbps"), true, true);
-            rfdNodes.Get(i)->AddApplication(app);
-            app->SetStartTime(Seconds(1.0 + (0.1 * i)));
-            app->SetStopTime(Seconds(simTime));
-        } else {
-            NS_LOG_ERROR("Interface index out of bounds: " << interfaceIndex);
+    if (partitioned) {
+#ifdef NS3_MPI
+        if (topologyFile.empty()) {
+            std::cerr << "--partitioned needs a --topologyFile to split" << std::endl;
+            return 1;
         }
+        return RunPartitioned(config, layout, &argc, &argv);
+#else
+        std::cerr << "--partitioned needs ns-3 configured with --enable-mpi" << std::endl;
+        return 1;
+#endif
     }
 
-    AnimationInterface anim("traffic-wsn-animation.xml");
-    for (uint32_t i = 0; i < numFPC; i++) {
-        anim.UpdateNodeDescription(fpcNodes.Get(i), "FPC");
-        anim.UpdateNodeColor(fpcNodes.Get(i), 255, 0, 0);
-    }
-    for (uint32_t i = 0; i < numFFD; i++) {
-        anim.UpdateNodeDescription(ffdNodes.Get(i), "FFD");
-        anim.UpdateNodeColor(ffdNodes.Get(i), 0, 255, 0);
-    }
-    for (uint32_t i = 0; i < numRFD; i++) {
-        anim.UpdateNodeDescription(rfdNodes.Get(i), "RFD");
-        anim.UpdateNodeColor(rfdNodes.Get(i), 0, 0, 255);
+    if (runs <= 1) {
+        return RunScenario(config, layout);
     }
 
-    Simulator::Stop(Seconds(simTime));
-    Simulator::Run();
-    Simulator::Destroy();
-
-    trafficDataFile.close();
-
-    std::cout << "Simulation completed. Data stored in traffic_sensor_data.csv" << std::endl;
-
+    // Replications share the process; each gets its own context, RNG run and
+    // output directory, where its checkpoint goes too. Only the first one
+    // records a NetAnim trace; sampled packet traces are written for each.
+    uint64_t firstRun = RngSeedManager::GetRun();
+    for (uint32_t r = 0; r < runs; r++) {
+        ScenarioConfig runConfig = config;
+        runConfig.outputDir = config.outputDir + "/run-" + std::to_string(firstRun + r);
+        runConfig.animation = config.animation && r == 0;
+        runConfig.checkpointFile.clear();
+        SystemPath::MakeDirectories(runConfig.outputDir);
+        RngSeedManager::SetRun(firstRun + r);
+        int status = RunScenario(runConfig, layout);
+        if (status != 0) {
+            return status;
+        }
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,262 @@
+#ifndef WSN_METRICS_H
+#define WSN_METRICS_H
+
+// Always-on instrumentation for the WSN scenario: per-node delivery and
+// end-to-end delay of sensor readings, LR-WPAN MAC/PHY event counters, and
+// sink throughput over time. Everything is fixed-size per node and O(1) per
+// event, so it stays enabled in large sweeps.
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lr-wpan-module.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+// Fixed-size log-linear (HDR-style) histogram of microsecond values. Each
+// power of two is split into 2^kSubBits linear sub-buckets, so a bucket's
+// width is at most 1/2^kSubBits (12.5%) of its lower bound; values below
+// 2^kSubBits us are exact and values above 2^kMaxExponent us (67 s) land in
+// the last bucket.
+class LogLinearHistogram {
+public:
+    static const uint32_t kSubBits = 3;
+    static const uint32_t kMaxExponent = 26;
+    static const uint32_t kBuckets = (kMaxExponent - kSubBits + 2) << kSubBits;
+
+    LogLinearHistogram() : m_total(0), m_max(0) { m_counts.fill(0); }
+
+    void Add(uint64_t us) {
+        m_counts[BucketOf(us)]++;
+        m_total++;
+        m_max = std::max(m_max, us);
+    }
+
+    void Merge(const LogLinearHistogram &other) {
+        for (uint32_t b = 0; b < kBuckets; b++)
+            m_counts[b] += other.m_counts[b];
+        m_total += other.m_total;
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    uint64_t Count() const { return m_total; }
+    double MaxMs() const { return m_max / 1000.0; }
+
+    // Midpoint of the bucket holding the p-th percentile (nearest rank).
+    double PercentileMs(double p) const {
+        if (m_total == 0)
+            return 0.0;
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100.0 * m_total)));
+        uint64_t seen = 0;
+        for (uint32_t b = 0; b < kBuckets; b++) {
+            seen += m_counts[b];
+            if (seen >= rank)
+                return std::min<double>((LowerBound(b) + LowerBound(b + 1)) / 2.0, m_max) / 1000.0;
+        }
+        return MaxMs();
+    }
+
+private:
+    static uint32_t BucketOf(uint64_t us) {
+        if (us < (1u << kSubBits))
+            return static_cast<uint32_t>(us);
+        uint32_t exponent = 63 - __builtin_clzll(us);
+        if (exponent > kMaxExponent)
+            return kBuckets - 1;
+        uint32_t sub = static_cast<uint32_t>(us >> (exponent - kSubBits)) & ((1u << kSubBits) - 1);
+        return ((exponent - kSubBits + 1) << kSubBits) + sub;
+    }
+
+    static uint64_t LowerBound(uint32_t bucket) {
+        if (bucket < (1u << kSubBits))
+            return bucket;
+        uint32_t exponent = (bucket >> kSubBits) + kSubBits - 1;
+        uint64_t sub = bucket & ((1u << kSubBits) - 1);
+        return ((1ull << kSubBits) + sub) << (exponent - kSubBits);
+    }
+
+    std::array<uint32_t, kBuckets> m_counts;
+    uint64_t m_total;
+    uint64_t m_max;
+};
+
+// LR-WPAN events counted per node from the MAC and PHY trace sources.
+struct LinkCounters {
+    uint32_t macTxOk = 0;
+    uint32_t macTxDrop = 0;     // Gave up after CSMA/CA or retransmission failures
+    uint32_t ccaFailures = 0;   // Channel access failures (channel busy after all backoffs)
+    uint32_t macRxDrop = 0;
+    uint32_t phyTxDrop = 0;
+    uint32_t phyRxDrop = 0;     // Frames lost to collisions, errors or a busy receiver
+    uint32_t txBacklogDrop = 0; // Routine frames dropped from a full transmit backlog
+
+    void Add(const LinkCounters &o) {
+        macTxOk += o.macTxOk;
+        macTxDrop += o.macTxDrop;
+        ccaFailures += o.ccaFailures;
+        macRxDrop += o.macRxDrop;
+        phyTxDrop += o.phyTxDrop;
+        phyRxDrop += o.phyRxDrop;
+        txBacklogDrop += o.txBacklogDrop;
+    }
+};
+
+// Readings a node sent (by sequence number) and those that reached an FPC.
+// Merged records count every reading they stand for, so lost readings are
+// what the sequence numbers say was sent minus what was delivered.
+struct NodeDelivery {
+    uint32_t sent = 0;
+    uint32_t delivered = 0;
+    uint32_t highestSeq = 0;  // Highest sequence number delivered plus one, unwrapped
+    uint16_t lastSeq = 0;     // The same, as carried on air
+};
+
+class WsnMetrics {
+public:
+    WsnMetrics() : m_binSeconds(1.0) {}
+
+    // Sizes the per-node tables; must be called before any Attach().
+    void Resize(uint32_t nodes, double throughputBinSeconds = 1.0) {
+        m_delay.assign(nodes, LogLinearHistogram());
+        m_delivery.assign(nodes, NodeDelivery());
+        m_links.assign(nodes, LinkCounters());
+        m_binSeconds = throughputBinSeconds;
+    }
+
+    void Attach(uint32_t index, Ptr<lrwpan::LrWpanNetDevice> dev) {
+        if (!dev)
+            return;
+        LinkCounters *c = &m_links[index];
+        Ptr<lrwpan::LrWpanMac> mac = dev->GetMac();
+        mac->TraceConnectWithoutContext("MacTxOk", MakeBoundCallback(&WsnMetrics::Count, &c->macTxOk));
+        mac->TraceConnectWithoutContext("MacTxDrop", MakeBoundCallback(&WsnMetrics::Count, &c->macTxDrop));
+        mac->TraceConnectWithoutContext("MacRxDrop", MakeBoundCallback(&WsnMetrics::Count, &c->macRxDrop));
+        mac->TraceConnectWithoutContext("MacState",
+                                        MakeBoundCallback(&WsnMetrics::CountCcaFailure, &c->ccaFailures));
+        Ptr<lrwpan::LrWpanPhy> phy = dev->GetPhy();
+        phy->TraceConnectWithoutContext("PhyTxDrop", MakeBoundCallback(&WsnMetrics::Count, &c->phyTxDrop));
+        phy->TraceConnectWithoutContext("PhyRxDrop", MakeBoundCallback(&WsnMetrics::Count, &c->phyRxDrop));
+    }
+
+    // Counter a node's transmit queue bumps for every frame it drops.
+    uint32_t *TxBacklogDropCounter(uint32_t index) { return &m_links[index].txBacklogDrop; }
+
+    void ReadingSent(uint32_t index) { m_delivery[index].sent++; }
+
+    // A record from node index reached an FPC, standing for samples readings,
+    // the latest with sequence number seq, sampled delayUs ago.
+    void ReadingDelivered(uint32_t index, uint16_t seq, uint32_t samples, uint64_t delayUs) {
+        NodeDelivery &d = m_delivery[index];
+        if (d.delivered == 0) {
+            d.highestSeq = seq + 1u;
+            d.lastSeq = seq;
+        } else {
+            uint16_t ahead = static_cast<uint16_t>(seq - d.lastSeq);
+            if (ahead != 0 && ahead < 0x8000) {
+                d.highestSeq += ahead;
+                d.lastSeq = seq;
+            }
+        }
+        d.delivered += samples;
+        m_delay[index].Add(delayUs);
+    }
+
+    // Application bytes absorbed by the FPCs, binned for throughput over time.
+    void SinkReceived(Time now, uint32_t bytes, uint32_t readings) {
+        size_t bin = static_cast<size_t>(now.GetSeconds() / m_binSeconds);
+        if (bin >= m_sinkBytes.size()) {
+            m_sinkBytes.resize(bin + 1, 0);
+            m_sinkReadings.resize(bin + 1, 0);
+        }
+        m_sinkBytes[bin] += bytes;
+        m_sinkReadings[bin] += readings;
+    }
+
+    // Delivery state of one node, for checkpoints. Delay histograms are not
+    // carried over: a restored run reports delays from the checkpoint on.
+    const NodeDelivery &Delivery(uint32_t index) const { return m_delivery[index]; }
+    void RestoreDelivery(uint32_t index, const NodeDelivery &d) { m_delivery[index] = d; }
+
+    LogLinearHistogram TotalDelay() const {
+        LogLinearHistogram total;
+        for (const LogLinearHistogram &h : m_delay)
+            total.Merge(h);
+        return total;
+    }
+
+    LinkCounters TotalLinks() const {
+        LinkCounters total;
+        for (const LinkCounters &c : m_links)
+            total.Add(c);
+        return total;
+    }
+
+    uint64_t ReadingsSent() const {
+        uint64_t n = 0;
+        for (const NodeDelivery &d : m_delivery)
+            n += d.sent;
+        return n;
+    }
+
+    uint64_t ReadingsDelivered() const {
+        uint64_t n = 0;
+        for (const NodeDelivery &d : m_delivery)
+            n += d.delivered;
+        return n;
+    }
+
+    // Readings the FPCs can tell were lost from sequence gaps alone.
+    uint64_t ReadingsMissing() const {
+        uint64_t n = 0;
+        for (const NodeDelivery &d : m_delivery)
+            n += d.highestSeq > d.delivered ? d.highestSeq - d.delivered : 0;
+        return n;
+    }
+
+    // One row per node: delivery, delay percentiles and link counters.
+    void WriteNodeCsv(const std::string &path, uint32_t numFPC, uint32_t numFFD) const {
+        std::ofstream out(path.c_str());
+        out << "NodeID,Role,ReadingsSent,ReadingsDelivered,SeqGaps,DelayP50Ms,DelayP99Ms,DelayMaxMs,"
+               "MacTxOk,MacTxDrop,CcaFailures,MacRxDrop,PhyTxDrop,PhyRxDrop,TxBacklogDrop\n";
+        for (uint32_t i = 0; i < m_links.size(); i++) {
+            const NodeDelivery &d = m_delivery[i];
+            const LinkCounters &c = m_links[i];
+            out << i << "," << (i < numFPC ? "FPC" : i < numFPC + numFFD ? "FFD" : "RFD") << "," << d.sent
+                << "," << d.delivered << "," << (d.highestSeq > d.delivered ? d.highestSeq - d.delivered : 0)
+                << "," << m_delay[i].PercentileMs(50) << "," << m_delay[i].PercentileMs(99) << ","
+                << m_delay[i].MaxMs() << "," << c.macTxOk << "," << c.macTxDrop << "," << c.ccaFailures << ","
+                << c.macRxDrop << "," << c.phyTxDrop << "," << c.phyRxDrop << "," << c.txBacklogDrop << "\n";
+        }
+    }
+
+    void WriteThroughputCsv(const std::string &path) const {
+        std::ofstream out(path.c_str());
+        out << "Time,Bytes,Readings,Kbps\n";
+        for (size_t b = 0; b < m_sinkBytes.size(); b++) {
+            out << b * m_binSeconds << "," << m_sinkBytes[b] << "," << m_sinkReadings[b] << ","
+                << m_sinkBytes[b] * 8 / m_binSeconds / 1000.0 << "\n";
+        }
+    }
+
+private:
+    static void Count(uint32_t *counter, Ptr<const Packet>) { (*counter)++; }
+    static void CountCcaFailure(uint32_t *counter, lrwpan::MacState, lrwpan::MacState state) {
+        if (state == lrwpan::CHANNEL_ACCESS_FAILURE)
+            (*counter)++;
+    }
+
+    std::vector<LogLinearHistogram> m_delay;  // Reading delay by source node
+    std::vector<NodeDelivery> m_delivery;
+    std::vector<LinkCounters> m_links;
+    std::vector<uint64_t> m_sinkBytes;        // Per throughput bin
+    std::vector<uint64_t> m_sinkReadings;
+    double m_binSeconds;
+};
+
+#endif // WSN_METRICS_H
@@ -0,0 +1,344 @@
+#ifndef WSN_PARTITION_H
+#define WSN_PARTITION_H
+
+// Partitioned execution of large WSN scenarios over ns-3's distributed
+// simulator (MPI). The topology is split by district (an FPC with the FFDs
+// reporting to it and their RFDs), each district belongs to one rank, and a
+// rank builds and simulates only its own districts on its own LR-WPAN
+// channel.
+//
+// ns-3 cannot carry a wireless channel across ranks, so radio links between
+// nodes of different ranks are lost; PartitionWsnLayout() keeps them few by
+// recursive coordinate bisection of the district centres, balanced by node
+// count, followed by greedy moves of boundary districts that cut fewer
+// links. What does cross ranks is a point-to-point backhaul from every
+// rank's gateway to rank 0's, on which each rank reports its district
+// totals; ns-3 uses that link's delay as the lookahead.
+//
+// Header-only for the scratch build; include it after wsn-scenario.h.
+
+#include "ns3/point-to-point-module.h"
+#include "spatial-index.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+struct WsnPartition {
+    uint32_t ranks = 1;
+    std::vector<uint32_t> ffdDistrict;  // District (FPC index) of each FFD
+    std::vector<uint32_t> rfdDistrict;  // District of each RFD
+    std::vector<uint32_t> rankOf;       // Rank of each district
+    std::vector<uint32_t> nodesPerRank;
+    uint64_t radioLinks = 0;  // Node pairs within radio reach
+    uint64_t cutLinks = 0;    // Of those, pairs on different ranks
+
+    // The part of layout that rank simulates, with parents renumbered.
+    WsnLayout LocalLayout(const WsnLayout &layout, uint32_t rank) const {
+        WsnLayout local;
+        std::vector<int32_t> fpcIndex(layout.fpc.size(), -1), ffdIndex(layout.ffd.size(), -1);
+        for (size_t d = 0; d < layout.fpc.size(); d++) {
+            if (rankOf[d] != rank)
+                continue;
+            fpcIndex[d] = local.fpc.size();
+            local.fpc.push_back(layout.fpc[d]);
+        }
+        for (size_t i = 0; i < layout.ffd.size(); i++) {
+            if (rankOf[ffdDistrict[i]] != rank)
+                continue;
+            ffdIndex[i] = local.ffd.size();
+            local.ffd.push_back(layout.ffd[i]);
+            local.ffdParent.push_back(fpcIndex[ffdDistrict[i]]);
+        }
+        for (size_t i = 0; i < layout.rfd.size(); i++) {
+            if (rankOf[rfdDistrict[i]] != rank)
+                continue;
+            int32_t parent = i < layout.rfdParent.size() ? layout.rfdParent[i] : -1;
+            local.rfd.push_back(layout.rfd[i]);
+            local.rfdParent.push_back(parent >= 0 ? ffdIndex[parent] : -1);
+        }
+        return local;
+    }
+};
+
+// Splits layout (which must give every node's position) into ranks parts.
+// Returns false when there are fewer districts than ranks.
+bool PartitionWsnLayout(const WsnLayout &layout, uint32_t ranks, double maxLink, WsnPartition &partition) {
+    const uint32_t districts = layout.fpc.size();
+    if (districts < ranks || ranks == 0)
+        return false;
+    partition.ranks = ranks;
+
+    // Districts: FFDs report to their layout parent or the nearest FPC, RFDs
+    // belong to their FFD's district.
+    std::vector<double> xs, ys;
+    auto coords = [](const std::vector<Vector> &points, std::vector<double> &x, std::vector<double> &y) {
+        x.clear();
+        y.clear();
+        for (const Vector &p : points) {
+            x.push_back(p.x);
+            y.push_back(p.y);
+        }
+    };
+    GridSpatialIndex fpcIndex, ffdIndex;
+    coords(layout.fpc, xs, ys);
+    fpcIndex.Build(xs, ys);
+    coords(layout.ffd, xs, ys);
+    ffdIndex.Build(xs, ys);
+
+    partition.ffdDistrict.assign(layout.ffd.size(), 0);
+    for (size_t i = 0; i < layout.ffd.size(); i++) {
+        int32_t parent = i < layout.ffdParent.size() ? layout.ffdParent[i] : -1;
+        partition.ffdDistrict[i] = parent >= 0 && static_cast<uint32_t>(parent) < districts
+                                       ? parent
+                                       : fpcIndex.Nearest(layout.ffd[i].x, layout.ffd[i].y);
+    }
+    partition.rfdDistrict.assign(layout.rfd.size(), 0);
+    for (size_t i = 0; i < layout.rfd.size(); i++) {
+        int32_t parent = i < layout.rfdParent.size() ? layout.rfdParent[i] : -1;
+        if (parent < 0 || static_cast<size_t>(parent) >= layout.ffd.size())
+            parent = layout.ffd.empty() ? -1 : ffdIndex.Nearest(layout.rfd[i].x, layout.rfd[i].y);
+        partition.rfdDistrict[i] =
+            parent >= 0 ? partition.ffdDistrict[parent] : fpcIndex.Nearest(layout.rfd[i].x, layout.rfd[i].y);
+    }
+
+    // Every node's district, weight and centre of each district.
+    std::vector<uint32_t> districtOf;
+    std::vector<Vector> all;
+    for (uint32_t d = 0; d < districts; d++) {
+        districtOf.push_back(d);
+        all.push_back(layout.fpc[d]);
+    }
+    for (size_t i = 0; i < layout.ffd.size(); i++) {
+        districtOf.push_back(partition.ffdDistrict[i]);
+        all.push_back(layout.ffd[i]);
+    }
+    for (size_t i = 0; i < layout.rfd.size(); i++) {
+        districtOf.push_back(partition.rfdDistrict[i]);
+        all.push_back(layout.rfd[i]);
+    }
+    std::vector<uint32_t> weight(districts, 0);
+    std::vector<double> cx(districts, 0.0), cy(districts, 0.0);
+    for (size_t i = 0; i < all.size(); i++) {
+        weight[districtOf[i]]++;
+        cx[districtOf[i]] += all[i].x;
+        cy[districtOf[i]] += all[i].y;
+    }
+    for (uint32_t d = 0; d < districts; d++) {
+        cx[d] /= weight[d];
+        cy[d] /= weight[d];
+    }
+
+    // Radio links between districts: node pairs within maxLink of each other.
+    std::map<std::pair<uint32_t, uint32_t>, uint64_t> between;
+    coords(all, xs, ys);
+    GridSpatialIndex nodeIndex;
+    nodeIndex.Build(xs, ys, maxLink);
+    std::vector<uint32_t> near;
+    partition.radioLinks = 0;
+    for (uint32_t i = 0; i < all.size(); i++) {
+        nodeIndex.WithinRadius(xs[i], ys[i], maxLink, near);
+        for (uint32_t j : near) {
+            if (j <= i)
+                continue;
+            partition.radioLinks++;
+            uint32_t a = districtOf[i], b = districtOf[j];
+            if (a != b)
+                between[std::make_pair(std::min(a, b), std::max(a, b))]++;
+        }
+    }
+    std::vector<std::vector<std::pair<uint32_t, uint64_t>>> neighbours(districts);
+    for (const auto &entry : between) {
+        neighbours[entry.first.first].emplace_back(entry.first.second, entry.second);
+        neighbours[entry.first.second].emplace_back(entry.first.first, entry.second);
+    }
+
+    // Recursive coordinate bisection: split along the wider axis so each side
+    // carries node weight in proportion to the ranks it gets.
+    partition.rankOf.assign(districts, 0);
+    std::vector<uint32_t> order(districts);
+    std::iota(order.begin(), order.end(), 0);
+    std::function<void(size_t, size_t, uint32_t, uint32_t)> bisect = [&](size_t first, size_t last, uint32_t rank0,
+                                                                         uint32_t count) {
+        if (count == 1) {
+            for (size_t k = first; k < last; k++)
+                partition.rankOf[order[k]] = rank0;
+            return;
+        }
+        double minX = std::numeric_limits<double>::max(), maxX = -minX, minY = minX, maxY = -minX;
+        uint64_t total = 0;
+        for (size_t k = first; k < last; k++) {
+            minX = std::min(minX, cx[order[k]]);
+            maxX = std::max(maxX, cx[order[k]]);
+            minY = std::min(minY, cy[order[k]]);
+            maxY = std::max(maxY, cy[order[k]]);
+            total += weight[order[k]];
+        }
+        const std::vector<double> &axis = maxX - minX >= maxY - minY ? cx : cy;
+        std::sort(order.begin() + first, order.begin() + last,
+                  [&axis](uint32_t a, uint32_t b) { return axis[a] < axis[b] || (axis[a] == axis[b] && a < b); });
+        uint32_t leftRanks = count / 2;
+        double target = static_cast<double>(total) * leftRanks / count;
+        size_t split = first;
+        uint64_t acc = 0;
+        while (split < last && acc + weight[order[split]] / 2.0 < target)
+            acc += weight[order[split++]];
+        // Leave at least one district per rank on either side.
+        split = std::max(split, first + leftRanks);
+        split = std::min(split, last - (count - leftRanks));
+        bisect(first, split, rank0, leftRanks);
+        bisect(split, last, rank0 + leftRanks, count - leftRanks);
+    };
+    bisect(0, districts, 0, ranks);
+
+    // Refinement: move a district to a neighbouring rank when that cuts fewer
+    // links and keeps both ranks within 5% of an even load.
+    std::vector<uint64_t> load(ranks, 0);
+    std::vector<uint32_t> districtsOn(ranks, 0);
+    for (uint32_t d = 0; d < districts; d++) {
+        load[partition.rankOf[d]] += weight[d];
+        districtsOn[partition.rankOf[d]]++;
+    }
+    const double even = static_cast<double>(all.size()) / ranks;
+    for (int pass = 0; pass < 8; pass++) {
+        bool moved = false;
+        for (uint32_t d = 0; d < districts; d++) {
+            uint32_t own = partition.rankOf[d];
+            if (districtsOn[own] == 1 || load[own] - weight[d] < 0.95 * even)
+                continue;
+            std::map<uint32_t, uint64_t> linksTo;
+            for (const auto &n : neighbours[d])
+                linksTo[partition.rankOf[n.first]] += n.second;
+            uint32_t best = own;
+            int64_t bestGain = 0;
+            for (const auto &entry : linksTo) {
+                int64_t gain = static_cast<int64_t>(entry.second) - static_cast<int64_t>(linksTo[own]);
+                if (entry.first == own || gain <= bestGain)
+                    continue;
+                if (load[entry.first] + weight[d] > 1.05 * even)
+                    continue;
+                best = entry.first;
+                bestGain = gain;
+            }
+            if (best == own)
+                continue;
+            partition.rankOf[d] = best;
+            load[own] -= weight[d];
+            load[best] += weight[d];
+            districtsOn[own]--;
+            districtsOn[best]++;
+            moved = true;
+        }
+        if (!moved)
+            break;
+    }
+
+    partition.nodesPerRank.assign(load.begin(), load.end());
+    partition.cutLinks = 0;
+    for (const auto &entry : between) {
+        if (partition.rankOf[entry.first.first] != partition.rankOf[entry.first.second])
+            partition.cutLinks += entry.second;
+    }
+    return true;
+}
+
+// Conservative-synchronisation lookahead: the airtime of a full-size
+// 802.15.4 frame (6-byte synchronisation header and PHR plus a 127-byte PSDU
+// at 250 kb/s), so ranks exchange district reports on the timescale of one
+// radio frame. It is the backhaul link delay, from which ns-3's distributed
+// simulator derives how far each rank may run ahead of the others.
+Time PartitionLookahead(void) {
+    return MicroSeconds((6 + 127) * 32);
+}
+
+// Per-rank gateways and the backhaul between them. Each rank reports its
+// received packets and sensed emergencies since the previous report to rank 0
+// every interval.
+struct WsnBackhaul {
+    NodeContainer gateways;       // One per rank, node IDs 0..ranks-1 on every rank
+    Ipv4InterfaceContainer links; // Gateway r's address at 2(r-1)+1; rank 0's side at 2(r-1)
+    Ptr<Socket> socket;
+    uint64_t lastReceived = 0;
+    uint64_t lastEmergencies = 0;
+    uint64_t reports = 0;             // Reports rank 0 received
+    uint64_t reportedPackets = 0;     // Packets received on the reporting ranks
+    uint64_t reportedEmergencies = 0;
+    double reportDelaySeconds = 0.0;  // Summed backhaul delay of the reports
+};
+
+void ReceiveBackhaulReport(WsnBackhaul *backhaul, Ptr<Socket> socket) {
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv())) {
+        uint8_t buf[8];
+        if (packet->CopyData(buf, sizeof(buf)) != sizeof(buf))
+            continue;
+        uint32_t received = 0, emergencies = 0;
+        for (int k = 0; k < 4; k++) {
+            received = (received << 8) | buf[k];
+            emergencies = (emergencies << 8) | buf[4 + k];
+        }
+        backhaul->reports++;
+        backhaul->reportedPackets += received;
+        backhaul->reportedEmergencies += emergencies;
+        SendTimeTag sendTime;
+        if (packet->PeekPacketTag(sendTime))
+            backhaul->reportDelaySeconds += (Simulator::Now() - sendTime.GetSendTime()).GetSeconds();
+    }
+}
+
+void SendBackhaulReport(WsnBackhaul *backhaul, ScenarioContext *context, Time interval) {
+    uint32_t received = static_cast<uint32_t>(context->packetsReceived - backhaul->lastReceived);
+    uint32_t emergencies = static_cast<uint32_t>(context->emergencyEvents - backhaul->lastEmergencies);
+    backhaul->lastReceived = context->packetsReceived;
+    backhaul->lastEmergencies = context->emergencyEvents;
+    uint8_t buf[8] = {static_cast<uint8_t>(received >> 24), static_cast<uint8_t>(received >> 16),
+                      static_cast<uint8_t>(received >> 8), static_cast<uint8_t>(received),
+                      static_cast<uint8_t>(emergencies >> 24), static_cast<uint8_t>(emergencies >> 16),
+                      static_cast<uint8_t>(emergencies >> 8), static_cast<uint8_t>(emergencies)};
+    Ptr<Packet> packet = Create<Packet>(buf, sizeof(buf));
+    SendTimeTag sendTime;
+    sendTime.SetSendTime(Simulator::Now());
+    packet->AddPacketTag(sendTime);
+    backhaul->socket->Send(packet);
+    Simulator::Schedule(interval, &SendBackhaulReport, backhaul, context, interval);
+}
+
+// Creates the gateways and backhaul links. Must run before any other node is
+// created, and identically on every rank, so node IDs and interfaces agree
+// across ranks.
+void BuildWsnBackhaul(uint32_t rank, uint32_t ranks, Time lookahead, Time interval, ScenarioContext &context,
+                      WsnBackhaul &backhaul) {
+    for (uint32_t r = 0; r < ranks; r++)
+        backhaul.gateways.Create(1, r);
+    InternetStackHelper internet;
+    internet.Install(backhaul.gateways);
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
+    p2p.SetChannelAttribute("Delay", TimeValue(lookahead));
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase("172.16.0.0", "255.255.255.252");
+    for (uint32_t r = 1; r < ranks; r++) {
+        NetDeviceContainer devices = p2p.Install(backhaul.gateways.Get(0), backhaul.gateways.Get(r));
+        backhaul.links.Add(ipv4.Assign(devices));
+        ipv4.NewNetwork();
+    }
+
+    const uint16_t port = 10;
+    TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+    backhaul.socket = Socket::CreateSocket(backhaul.gateways.Get(rank), tid);
+    if (rank == 0) {
+        backhaul.socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), port));
+        backhaul.socket->SetRecvCallback(MakeBoundCallback(&ReceiveBackhaulReport, &backhaul));
+    } else {
+        backhaul.socket->Bind();
+        backhaul.socket->Connect(InetSocketAddress(backhaul.links.GetAddress(2 * (rank - 1)), port));
+        Simulator::Schedule(interval, &SendBackhaulReport, &backhaul, &context, interval);
+    }
+}
+
+#endif // WSN_PARTITION_H
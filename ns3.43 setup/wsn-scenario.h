@@ -0,0 +1,1929 @@
+#ifndef WSN_SCENARIO_H
+#define WSN_SCENARIO_H
+
+// Building blocks of the WSN scenario: frame headers, demand and energy
+// models, the RFD sensor and FFD cluster-head applications, and
+// BuildWsnNetwork(), which wires them into an LR-WPAN network, either as one
+// single-hop IPv4 segment or as a 6LoWPAN collection tree. Shared by
+// wsn-implementation and the wsn-sumo-cosim co-simulation.
+//
+// Header-only for the scratch build; include it after NS_LOG_COMPONENT_DEFINE,
+// it logs under the including program's component.
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/lr-wpan-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/energy-module.h"
+#include "ns3/propagation-module.h"
+#include "ns3/sixlowpan-module.h"
+#include "ns3/spectrum-module.h"
+#include "sensor-log.h"
+#include "spatial-index.h"
+#include "spsc-ring.h"
+#include "wsn-metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+// Most lanes an RFD reports separately (see ScenarioConfig::lanesPerSensor).
+const uint32_t kMaxSensorLanes = 4;
+
+// One sensor reading, or several merged by a cluster head.
+struct SensorRecord {
+    uint32_t nodeId;
+    uint8_t samples;   // Readings merged into this record (at most 127)
+    uint8_t count;     // Latest vehicle count
+    uint8_t maxCount;  // Largest vehicle count among the merged readings
+    bool emergency;    // OR of the merged readings' emergency flags
+    uint16_t seq;       // Sending RFD's sequence number of the latest reading
+    uint32_t sampledUs; // When the latest reading was taken, in microseconds (wraps after ~71 min)
+    uint8_t lanes = 0;                         // Lanes counted separately; 0 for a single-lane sensor
+    uint8_t laneCounts[kMaxSensorLanes] = {};  // Latest count per lane, summing to count
+};
+
+// Sensor report carried by every WSN data frame: zero or more sensor records.
+// RFDs send one record; FFDs merge their children's readings into one frame.
+// Only the frame time is sent in full; the other times are varint deltas
+// back from it, so a fresh RFD reading costs one byte of timestamp.
+//   u8 flags (bit 0: emergency), u8 record count, u32 frame time (us, wraps after ~71 min),
+//   varint frame time - emergency sensed (us), on emergency frames only
+//   per record: varint node ID, u8 record flags (bit 0: emergency, bit 1: merged, bit 2: lanes),
+//               u8 count, [u8 samples, u8 max count if merged], varint sequence number,
+//               varint frame time - sample time (us), [u8 lanes, u8 count per lane if lanes]
+class SensorReportHeader : public Header {
+public:
+    SensorReportHeader() : m_isEmergency(false), m_frameUs(0), m_generatedUs(0) {}
+    void SetEmergency(bool flag) { m_isEmergency = flag; }
+    bool IsEmergency() const { return m_isEmergency; }
+
+    // The sender's clock when it builds the frame; record and emergency
+    // times are sent relative to it.
+    void SetFrameTime(Time t) { m_frameUs = static_cast<uint32_t>(t.GetMicroSeconds()); }
+
+    // When the emergency was sensed; carried end to end on emergency frames
+    // only. Decoded against the current time, so valid for up to ~71 min.
+    void SetGenerated(Time t) { m_generatedUs = static_cast<uint32_t>(t.GetMicroSeconds()); }
+    Time GetGenerated() const { return UnwrapUs(m_generatedUs); }
+
+    void AddRecord(const SensorRecord &record) {
+        m_records.push_back(record);
+        m_isEmergency = m_isEmergency || record.emergency;
+    }
+    const std::vector<SensorRecord> &GetRecords() const { return m_records; }
+
+    // Most recent time whose low 32 bits of microseconds are `us`.
+    static Time UnwrapUs(uint32_t us) {
+        uint32_t nowUs = static_cast<uint32_t>(Simulator::Now().GetMicroSeconds());
+        return Simulator::Now() - MicroSeconds(static_cast<uint32_t>(nowUs - us));
+    }
+
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("SensorReportHeader")
+            .SetParent<Header>()
+            .AddConstructor<SensorReportHeader>();
+        return tid;
+    }
+
+    virtual TypeId GetInstanceTypeId(void) const { return GetTypeId(); }
+    virtual void Serialize(Buffer::Iterator start) const {
+        start.WriteU8(m_isEmergency ? 1 : 0);
+        start.WriteU8(static_cast<uint8_t>(m_records.size()));
+        start.WriteHtonU32(m_frameUs);
+        if (m_isEmergency)
+            WriteVarint(start, m_frameUs - m_generatedUs);
+        for (const SensorRecord &r : m_records) {
+            WriteVarint(start, r.nodeId);
+            start.WriteU8((r.emergency ? 1 : 0) | (Merged(r) ? 2 : 0) | (r.lanes ? 4 : 0));
+            start.WriteU8(r.count);
+            if (Merged(r)) {
+                start.WriteU8(r.samples);
+                start.WriteU8(r.maxCount);
+            }
+            WriteVarint(start, r.seq);
+            WriteVarint(start, m_frameUs - r.sampledUs);
+            if (r.lanes) {
+                start.WriteU8(r.lanes);
+                for (uint8_t lane = 0; lane < r.lanes; lane++)
+                    start.WriteU8(r.laneCounts[lane]);
+            }
+        }
+    }
+    virtual uint32_t GetSerializedSize(void) const {
+        uint32_t size = 6 + (m_isEmergency ? VarintSize(m_frameUs - m_generatedUs) : 0);
+        for (const SensorRecord &r : m_records) {
+            size += VarintSize(r.nodeId) + 2 + (Merged(r) ? 2 : 0) + VarintSize(r.seq) +
+                    VarintSize(m_frameUs - r.sampledUs) + (r.lanes ? 1 + r.lanes : 0);
+        }
+        return size;
+    }
+    virtual uint32_t Deserialize(Buffer::Iterator start) {
+        Buffer::Iterator begin = start;
+        m_isEmergency = (start.ReadU8() & 1) != 0;
+        m_records.resize(start.ReadU8());
+        m_frameUs = start.ReadNtohU32();
+        if (m_isEmergency)
+            m_generatedUs = m_frameUs - ReadVarint(start);
+        for (SensorRecord &r : m_records) {
+            r = SensorRecord();
+            r.nodeId = ReadVarint(start);
+            uint8_t flags = start.ReadU8();
+            r.emergency = (flags & 1) != 0;
+            r.count = start.ReadU8();
+            r.samples = 1;
+            r.maxCount = r.count;
+            if (flags & 2) {
+                r.samples = start.ReadU8();
+                r.maxCount = start.ReadU8();
+            }
+            r.seq = static_cast<uint16_t>(ReadVarint(start));
+            r.sampledUs = m_frameUs - ReadVarint(start);
+            if (flags & 4) {
+                r.lanes = std::min<uint8_t>(start.ReadU8(), kMaxSensorLanes);
+                for (uint8_t lane = 0; lane < r.lanes; lane++)
+                    r.laneCounts[lane] = start.ReadU8();
+            }
+        }
+        return start.GetDistanceFrom(begin);
+    }
+    virtual void Print(std::ostream &os) const {
+        os << "Emergency: " << m_isEmergency << " Records: " << m_records.size();
+    }
+
+private:
+    // A record standing for one reading sends neither samples nor max count.
+    static bool Merged(const SensorRecord &r) { return r.samples != 1 || r.maxCount != r.count; }
+
+    // LEB128: 7 bits per byte, low bits first, high bit set on all but the last.
+    static void WriteVarint(Buffer::Iterator &i, uint32_t value) {
+        while (value >= 0x80) {
+            i.WriteU8(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        i.WriteU8(static_cast<uint8_t>(value));
+    }
+    static uint32_t ReadVarint(Buffer::Iterator &i) {
+        uint32_t value = 0;
+        for (uint32_t shift = 0; shift < 35; shift += 7) {
+            uint8_t byte = i.ReadU8();
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+        return value;
+    }
+    static uint32_t VarintSize(uint32_t value) {
+        uint32_t size = 1;
+        for (; value >= 0x80; value >>= 7)
+            size++;
+        return size;
+    }
+
+    bool m_isEmergency;
+    uint32_t m_frameUs;
+    uint32_t m_generatedUs;
+    std::vector<SensorRecord> m_records;
+};
+
+// Packet tag carrying the application send time, used for end-to-end delay.
+// Tags are simulator metadata and add nothing to the frame on air.
+class SendTimeTag : public Tag {
+public:
+    SendTimeTag() : m_sendTime(0) {}
+    void SetSendTime(Time t) { m_sendTime = t.GetTimeStep(); }
+    Time GetSendTime() const { return TimeStep(m_sendTime); }
+
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("SendTimeTag")
+            .SetParent<Tag>()
+            .AddConstructor<SendTimeTag>();
+        return tid;
+    }
+
+    virtual TypeId GetInstanceTypeId(void) const { return GetTypeId(); }
+    virtual uint32_t GetSerializedSize(void) const { return 8; }
+    virtual void Serialize(TagBuffer i) const { i.WriteU64(m_sendTime); }
+    virtual void Deserialize(TagBuffer i) { m_sendTime = i.ReadU64(); }
+    virtual void Print(std::ostream &os) const { os << "SendTime: " << m_sendTime; }
+private:
+    uint64_t m_sendTime;
+};
+
+// Source of the vehicle counts reported by RFD sensors. Each node draws from
+// its own RandomVariableStream, so results depend only on RngSeed/RngRun and
+// the stream numbers, never on event order or on other nodes.
+class TrafficDemandModel : public Object {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("TrafficDemandModel")
+            .SetParent<Object>()
+            .SetGroupName("WSN");
+        return tid;
+    }
+
+    // Creates one stream per node, numbered from `stream`. Returns the number
+    // of streams used.
+    virtual int64_t AssignStreams(int64_t stream, uint32_t numNodes) = 0;
+
+    // Vehicles seen by node `node` (index within the scenario) during the
+    // report interval ending at `now`.
+    virtual uint32_t GetVehicleCount(uint32_t node, Time now, Time interval) = 0;
+
+    // Models that see vehicle classes say whether an emergency vehicle is at
+    // node `node` at `now`; with the others a sensor infers an emergency from
+    // a high count.
+    virtual bool SensesEmergencies() const { return false; }
+    virtual bool EmergencyVehicle(uint32_t node, Time now) { return false; }
+
+    // Values drawn so far from each node's stream. A run restored from a
+    // checkpoint skips its fresh streams to these positions and so continues
+    // the same random sequences. Empty for models without streams.
+    const std::vector<uint64_t> &StreamPositions() const { return m_draws; }
+
+    void SkipTo(const std::vector<uint64_t> &positions) {
+        for (size_t i = 0; i < positions.size() && i < m_streams.size(); i++) {
+            for (; m_draws[i] < positions[i]; m_draws[i]++)
+                m_streams[i]->GetValue();
+        }
+    }
+
+protected:
+    void CreateStreams(int64_t stream, uint32_t numNodes) {
+        m_streams.resize(numNodes);
+        m_draws.assign(numNodes, 0);
+        for (uint32_t i = 0; i < numNodes; i++) {
+            m_streams[i] = CreateObject<UniformRandomVariable>();
+            m_streams[i]->SetStream(stream + i);
+        }
+    }
+
+    // Next U(0,1) value from the node's stream.
+    double Draw(uint32_t node) {
+        m_draws[node]++;
+        return m_streams[node]->GetValue();
+    }
+
+private:
+    std::vector<Ptr<UniformRandomVariable>> m_streams;
+    std::vector<uint64_t> m_draws;
+};
+
+// Uniform 0..9 vehicles per report; the original rand() % 10 behaviour.
+class UniformDemandModel : public TrafficDemandModel {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("UniformDemandModel")
+            .SetParent<TrafficDemandModel>()
+            .SetGroupName("WSN")
+            .AddConstructor<UniformDemandModel>()
+            .AddAttribute("MaxCount", "Largest vehicle count per report",
+                          UintegerValue(9),
+                          MakeUintegerAccessor(&UniformDemandModel::m_maxCount),
+                          MakeUintegerChecker<uint32_t>());
+        return tid;
+    }
+
+    virtual int64_t AssignStreams(int64_t stream, uint32_t numNodes) {
+        CreateStreams(stream, numNodes);
+        return numNodes;
+    }
+
+    // Same value UniformRandomVariable::GetInteger(0, MaxCount) returns.
+    virtual uint32_t GetVehicleCount(uint32_t node, Time now, Time interval) {
+        return static_cast<uint32_t>(Draw(node) * (m_maxCount + 1.0));
+    }
+
+private:
+    uint32_t m_maxCount;
+};
+
+// Poisson vehicle arrivals at a constant rate per sensor.
+class PoissonDemandModel : public TrafficDemandModel {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("PoissonDemandModel")
+            .SetParent<TrafficDemandModel>()
+            .SetGroupName("WSN")
+            .AddConstructor<PoissonDemandModel>()
+            .AddAttribute("ArrivalRate", "Mean vehicle arrivals per second at each sensor",
+                          DoubleValue(1.0),
+                          MakeDoubleAccessor(&PoissonDemandModel::m_arrivalRate),
+                          MakeDoubleChecker<double>(0.0));
+        return tid;
+    }
+
+    virtual int64_t AssignStreams(int64_t stream, uint32_t numNodes) {
+        CreateStreams(stream, numNodes);
+        return numNodes;
+    }
+
+    virtual uint32_t GetVehicleCount(uint32_t node, Time now, Time interval) {
+        return SamplePoisson(node, RateAt(now) * interval.GetSeconds());
+    }
+
+protected:
+    virtual double RateAt(Time now) const { return m_arrivalRate; }
+
+    double m_arrivalRate;
+
+private:
+    // Knuth's product method for small means, a rounded normal beyond that.
+    uint32_t SamplePoisson(uint32_t node, double mean) {
+        if (mean <= 0.0)
+            return 0;
+        if (mean < 30.0) {
+            double limit = std::exp(-mean);
+            double product = Draw(node);
+            uint32_t k = 0;
+            while (product > limit) {
+                k++;
+                product *= Draw(node);
+            }
+            return k;
+        }
+        double z = std::sqrt(-2.0 * std::log(1.0 - Draw(node))) * std::cos(2.0 * M_PI * Draw(node));
+        double k = std::round(mean + std::sqrt(mean) * z);
+        return k < 0.0 ? 0 : static_cast<uint32_t>(k);
+    }
+};
+
+// Poisson arrivals whose rate follows a daily profile:
+// rate(t) = ArrivalRate * (1 + Amplitude * cos(2 pi (t - PeakTime) / Period)).
+class DiurnalDemandModel : public PoissonDemandModel {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("DiurnalDemandModel")
+            .SetParent<PoissonDemandModel>()
+            .SetGroupName("WSN")
+            .AddConstructor<DiurnalDemandModel>()
+            .AddAttribute("Amplitude", "Relative swing of the arrival rate around its mean (0..1)",
+                          DoubleValue(0.8),
+                          MakeDoubleAccessor(&DiurnalDemandModel::m_amplitude),
+                          MakeDoubleChecker<double>(0.0, 1.0))
+            .AddAttribute("Period", "Length of one demand cycle",
+                          TimeValue(Hours(24)),
+                          MakeTimeAccessor(&DiurnalDemandModel::m_period),
+                          MakeTimeChecker())
+            .AddAttribute("PeakTime", "Simulation time of the first demand peak",
+                          TimeValue(Hours(8)),
+                          MakeTimeAccessor(&DiurnalDemandModel::m_peakTime),
+                          MakeTimeChecker());
+        return tid;
+    }
+
+protected:
+    virtual double RateAt(Time now) const {
+        double phase = 2.0 * M_PI * (now - m_peakTime).GetSeconds() / m_period.GetSeconds();
+        return m_arrivalRate * (1.0 + m_amplitude * std::cos(phase));
+    }
+
+private:
+    double m_amplitude;
+    Time m_period;
+    Time m_peakTime;
+};
+
+// Replays vehicle counts from SUMO induction-loop (E1 detector) output.
+// Detectors are sorted by ID and dealt to nodes round-robin; each report gets
+// the detector's nVehContrib scaled to the report interval.
+class ReplayDemandModel : public TrafficDemandModel {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ReplayDemandModel")
+            .SetParent<TrafficDemandModel>()
+            .SetGroupName("WSN")
+            .AddConstructor<ReplayDemandModel>()
+            .AddAttribute("File", "SUMO induction-loop output (<interval .../> elements)",
+                          StringValue(""),
+                          MakeStringAccessor(&ReplayDemandModel::m_file),
+                          MakeStringChecker());
+        return tid;
+    }
+
+    // Replay is deterministic and uses no streams.
+    virtual int64_t AssignStreams(int64_t stream, uint32_t numNodes) {
+        Load();
+        return 0;
+    }
+
+    virtual uint32_t GetVehicleCount(uint32_t node, Time now, Time interval) {
+        if (m_detectors.empty())
+            return 0;
+        const std::vector<Interval> &intervals = m_detectors[node % m_detectors.size()];
+        double t = now.GetSeconds();
+        auto it = std::upper_bound(intervals.begin(), intervals.end(), t,
+                                   [](double time, const Interval &iv) { return time < iv.end; });
+        if (it == intervals.end() || t < it->begin)
+            return 0;
+        double share = interval.GetSeconds() / std::max(it->end - it->begin, 1e-9);
+        return static_cast<uint32_t>(std::round(it->vehicles * share));
+    }
+
+private:
+    struct Interval {
+        double begin;
+        double end;
+        double vehicles;
+    };
+
+    static bool ReadAttribute(const std::string &line, const char *name, std::string &value) {
+        std::string key = std::string(" ") + name + "=\"";
+        size_t start = line.find(key);
+        if (start == std::string::npos)
+            return false;
+        start += key.size();
+        size_t end = line.find('"', start);
+        if (end == std::string::npos)
+            return false;
+        value = line.substr(start, end - start);
+        return true;
+    }
+
+    void Load() {
+        m_detectors.clear();
+        std::ifstream in(m_file.c_str());
+        if (!in.is_open()) {
+            NS_FATAL_ERROR("Cannot open induction-loop output " << m_file);
+        }
+        std::map<std::string, std::vector<Interval>> byDetector;
+        std::string line, id, begin, end, vehicles;
+        while (std::getline(in, line)) {
+            if (line.find("<interval") == std::string::npos)
+                continue;
+            if (ReadAttribute(line, "id", id) && ReadAttribute(line, "begin", begin) &&
+                ReadAttribute(line, "end", end) && ReadAttribute(line, "nVehContrib", vehicles)) {
+                byDetector[id].push_back({std::stod(begin), std::stod(end), std::stod(vehicles)});
+            }
+        }
+        for (auto &detector : byDetector) {
+            std::sort(detector.second.begin(), detector.second.end(),
+                      [](const Interval &a, const Interval &b) { return a.begin < b.begin; });
+            m_detectors.push_back(std::move(detector.second));
+        }
+        NS_LOG_INFO("Replaying " << m_detectors.size() << " induction loops from " << m_file);
+    }
+
+    std::string m_file;
+    std::vector<std::vector<Interval>> m_detectors;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(UniformDemandModel);
+NS_OBJECT_ENSURE_REGISTERED(PoissonDemandModel);
+NS_OBJECT_ENSURE_REGISTERED(DiurnalDemandModel);
+NS_OBJECT_ENSURE_REGISTERED(ReplayDemandModel);
+
+// Radio energy model for the LR-WPAN transceiver, driven by the PHY's
+// TrxState trace. Default currents are CC2420 datasheet values; TRX_OFF
+// is charged at the voltage-regulator-off current, as it is the only
+// non-listening state the ns-3 PHY has.
+class LrWpanRadioEnergyModel : public energy::DeviceEnergyModel {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("LrWpanRadioEnergyModel")
+            .SetParent<energy::DeviceEnergyModel>()
+            .SetGroupName("WSN")
+            .AddConstructor<LrWpanRadioEnergyModel>()
+            .AddAttribute("TxCurrentA", "Current while transmitting",
+                          DoubleValue(0.0174),
+                          MakeDoubleAccessor(&LrWpanRadioEnergyModel::m_txCurrentA),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("RxCurrentA", "Current while listening or receiving",
+                          DoubleValue(0.0188),
+                          MakeDoubleAccessor(&LrWpanRadioEnergyModel::m_rxCurrentA),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("IdleCurrentA", "Current with the oscillator running but no RX/TX",
+                          DoubleValue(0.000426),
+                          MakeDoubleAccessor(&LrWpanRadioEnergyModel::m_idleCurrentA),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("SleepCurrentA", "Current with the transceiver off",
+                          DoubleValue(0.00000002),
+                          MakeDoubleAccessor(&LrWpanRadioEnergyModel::m_sleepCurrentA),
+                          MakeDoubleChecker<double>(0.0));
+        return tid;
+    }
+
+    LrWpanRadioEnergyModel()
+        : m_state(lrwpan::IEEE_802_15_4_PHY_TRX_OFF),
+          m_lastUpdate(Seconds(0)),
+          m_chargeFrom(Seconds(0)),
+          m_totalEnergyJ(0.0) {
+    }
+
+    // Starts tracking the transceiver state of phy through its
+    // (time, old, new) TrxState trace.
+    void Attach(Ptr<lrwpan::LrWpanPhy> phy) {
+        phy->TraceConnectWithoutContext("TrxState",
+                                        MakeCallback(&LrWpanRadioEnergyModel::TrxStateChanged, this));
+    }
+
+    // Charges nothing up to `at`. A network rebuilt to resume from a
+    // checkpoint has its radios listening from t = 0, but the energy they
+    // used before the checkpoint is already off the restored battery.
+    void ChargeFrom(Time at) {
+        m_chargeFrom = at;
+        m_lastUpdate = at;
+        // Settle the source at `at`, while this model still draws nothing.
+        if (m_source) {
+            Simulator::Schedule(at - Simulator::Now(), &energy::EnergySource::UpdateEnergySource, m_source);
+        }
+    }
+
+    virtual void SetEnergySource(Ptr<energy::EnergySource> source) { m_source = source; }
+
+    virtual double GetTotalEnergyConsumption(void) const {
+        if (!Charging()) {
+            return m_totalEnergyJ;
+        }
+        double pendingS = (Simulator::Now() - m_lastUpdate).GetSeconds();
+        return m_totalEnergyJ + pendingS * CurrentFor(m_state) * SupplyVoltage();
+    }
+
+    // Transceiver states are tracked through the PHY trace, not DeviceEnergyModel states.
+    virtual void ChangeState(int newState) {}
+
+    virtual void HandleEnergyDepletion(void) {
+        NS_LOG_INFO("Radio energy depleted at " << Simulator::Now().GetSeconds() << "s");
+    }
+    virtual void HandleEnergyRecharged(void) {}
+    virtual void HandleEnergyChanged(void) {}
+
+private:
+    void TrxStateChanged(Time time, lrwpan::PhyEnumeration oldState, lrwpan::PhyEnumeration newState) {
+        if (!Charging()) {
+            m_state = newState;
+            return;
+        }
+        Time now = Simulator::Now();
+        m_totalEnergyJ += (now - m_lastUpdate).GetSeconds() * CurrentFor(m_state) * SupplyVoltage();
+        m_lastUpdate = now;
+        // Let the source charge the old current up to now before switching.
+        if (m_source) {
+            m_source->UpdateEnergySource();
+        }
+        m_state = newState;
+    }
+
+    double CurrentFor(lrwpan::PhyEnumeration state) const {
+        switch (state) {
+        case lrwpan::IEEE_802_15_4_PHY_BUSY_TX:
+            return m_txCurrentA;
+        case lrwpan::IEEE_802_15_4_PHY_RX_ON:
+        case lrwpan::IEEE_802_15_4_PHY_BUSY_RX:
+            return m_rxCurrentA;
+        case lrwpan::IEEE_802_15_4_PHY_TRX_OFF:
+        case lrwpan::IEEE_802_15_4_PHY_FORCE_TRX_OFF:
+            return m_sleepCurrentA;
+        default:
+            return m_idleCurrentA;
+        }
+    }
+
+    double SupplyVoltage(void) const { return m_source ? m_source->GetSupplyVoltage() : 0.0; }
+
+    bool Charging(void) const { return Simulator::Now() > m_chargeFrom; }
+
+    virtual double DoGetCurrentA(void) const { return Charging() ? CurrentFor(m_state) : 0.0; }
+
+    Ptr<energy::EnergySource> m_source;
+    lrwpan::PhyEnumeration m_state;
+    Time m_lastUpdate;
+    Time m_chargeFrom;  // Nothing is charged up to this time
+    double m_totalEnergyJ;
+    double m_txCurrentA;
+    double m_rxCurrentA;
+    double m_idleCurrentA;
+    double m_sleepCurrentA;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LrWpanRadioEnergyModel);
+
+// Returns the node's LR-WPAN device, or nullptr if it has none.
+Ptr<lrwpan::LrWpanNetDevice> GetLrWpanDevice(Ptr<Node> node) {
+    for (uint32_t i = 0; i < node->GetNDevices(); i++) {
+        Ptr<lrwpan::LrWpanNetDevice> dev = DynamicCast<lrwpan::LrWpanNetDevice>(node->GetDevice(i));
+        if (dev != nullptr) {
+            return dev;
+        }
+    }
+    return nullptr;
+}
+
+// A reading as delivered to the FPC, handed to an in-process consumer such
+// as the co-simulation traffic light controller.
+struct DeliveredReading {
+    uint32_t nodeId;
+    uint8_t count;
+    uint8_t maxCount;
+    bool emergency;
+    Time sampled;    // When the delivered (latest merged) reading was taken
+    Time delivered;  // When the FPC received it
+};
+
+// Latency samples with exact nearest-rank percentiles. Meant for rare events
+// such as emergencies, not for per-packet accounting.
+struct LatencySamples {
+    std::vector<double> seconds;
+
+    void Add(Time latency) { seconds.push_back(latency.GetSeconds()); }
+    size_t Count() const { return seconds.size(); }
+
+    double PercentileMs(double p) const {
+        if (seconds.empty())
+            return 0.0;
+        std::vector<double> sorted(seconds);
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        size_t k = rank == 0 ? 0 : rank - 1;
+        std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+        return 1000.0 * sorted[k];
+    }
+    double MaxMs() const { return seconds.empty() ? 0.0 : 1000.0 * *std::max_element(seconds.begin(), seconds.end()); }
+};
+
+// Per-scenario data collection state, owned by RunScenario() and handed to
+// the applications and receive callbacks. Counters are flat vectors indexed by
+// the node's position in the scenario, so accounting is O(1) per packet and
+// several scenarios can run one after another in the same process.
+struct ScenarioContext {
+    uint32_t firstNodeId = 0;                      // ns-3 node ID of the scenario's first node (the first FPC)
+    uint32_t numFPC = 1;                           // Scenario indices below this are FPC sinks
+    std::vector<uint32_t> nodeDataCount;           // Packets received per node
+    std::unique_ptr<SensorLogWriter> trafficDataLog;
+    Ptr<TrafficDemandModel> demand;                // Vehicle counts, one random stream per node
+    uint64_t packetsSent = 0;
+    uint64_t packetsReceived = 0;
+    double totalDelaySeconds = 0.0;
+
+    // Cluster-head relay accounting: what the FFDs sent upstream versus what
+    // forwarding every received RFD frame unchanged would have cost.
+    uint64_t relayReadings = 0;
+    uint64_t relayFrames = 0;
+    uint64_t relayBytes = 0;
+    uint64_t unbatchedFrames = 0;
+    uint64_t unbatchedBytes = 0;
+
+    // Per-node battery and radio energy model, indexed like nodeDataCount.
+    std::vector<Ptr<energy::BasicEnergySource>> batteries;
+    std::vector<Ptr<LrWpanRadioEnergyModel>> radioEnergy;
+
+    // Optional ring the FPC pushes every delivered reading into.
+    SpscRing<DeliveredReading> *deliveredReadings = nullptr;
+
+    // Route length from each node to its FPC in hops, RFD readings sent and
+    // delivered per route length, and collection-tree throughput at the sinks.
+    std::vector<uint32_t> hopsToSink;
+    std::vector<uint64_t> readingsSentByHops;
+    std::vector<uint64_t> readingsDeliveredByHops;
+    double perHopDelaySeconds = 0.0;  // Sum over received packets of delay / IP hops travelled
+    uint64_t sinkBytes = 0;
+    Time sinkFirstRx;
+    Time sinkLastRx;
+    uint32_t unreachableNodes = 0;   // Nodes with no route to an FPC
+
+    // Per-node delivery, reading delay, MAC/PHY counters and sink throughput.
+    WsnMetrics metrics;
+
+    // Emergencies sensed by RFDs, and sensing-to-FPC latency of those delivered.
+    uint64_t emergencyEvents = 0;
+    LatencySamples emergencyToFpc;
+
+    uint32_t Index(uint32_t nodeId) const { return nodeId - firstNodeId; }
+
+    void CountReading(std::vector<uint64_t> &byHops, uint32_t index) {
+        uint32_t hops = hopsToSink[index];
+        if (hops >= byHops.size())
+            byHops.resize(hops + 1, 0);
+        byHops[hops]++;
+    }
+};
+
+struct ScenarioConfig {
+    uint32_t numRFD = 10;
+    uint32_t numFFD = 3;
+    uint32_t numFPC = 1;
+    double simTime = 100.0;
+    std::string outputDir = ".";
+    std::string sensorLogFormat = "binary";
+    std::string dataRate = "1kbps";
+    std::string demandModel = "uniform";
+    double aggregationWindow = 2.0;  // Seconds an FFD batches readings; 0 forwards each one
+    double reportInterval = 0.0;     // Seconds between RFD reports; 0 derives it from packet size and data rate
+    bool dutyCycle = false;          // Turn RFD radios off between reports
+    double awakeWindow = 0.01;       // Seconds an RFD keeps listening after each report
+    double batteryJ = 27000.0;       // Initial energy per node (2 x AA, 2.5 Ah at 3 V)
+    bool meshRouting = false;        // 6LoWPAN collection tree instead of single-hop IPv4
+    double radioRange = 0.0;         // Metres beyond which nothing is received; 0 leaves only path loss
+    double pathLossExponent = 3.0;   // Log-distance path loss exponent
+    double fieldSize = 100.0;        // Side of the square the default layout spreads nodes over
+    double emergencyRate = 0.0;      // Emergency vehicle detections per second per RFD
+    uint32_t reportPadding = 0;      // Filler bytes after each RFD report; 512 restores the old fixed-size frames
+    uint32_t lanesPerSensor = 1;     // Lanes each RFD reports separately (up to kMaxSensorLanes)
+    uint32_t txBacklog = 32;         // Routine frames a node holds for its MAC before dropping the oldest; 0: no limit
+    bool animation = false;          // NetAnim XML of every frame; slow and very large beyond small runs
+    bool trace = false;              // Sampled binary packet trace instead (see wsn-trace.h)
+    uint32_t traceEvery = 1;         // Trace frames whose packet UID is a multiple of this
+    std::string traceNodes;          // Node IDs to trace, e.g. "0-3,17"; empty traces every node
+    double traceStart = 0.0;         // Trace frames going on air from this time on
+    double traceStop = 0.0;          // ...and before this time; 0 traces to the end of the run
+    double checkpointAt = 0.0;       // Write a checkpoint at this time (see wsn-checkpoint.h); 0 disables it
+    std::string checkpointFile;      // Defaults to outputDir/checkpoint.txt
+    std::string restoreFrom;         // Checkpoint to resume from instead of starting at time zero
+    uint32_t systemId = 0;           // MPI rank the nodes belong to (see wsn-partition.h)
+};
+
+// Hop limit mesh senders stamp on their packets; receivers derive the hops
+// travelled from what is left of it.
+const uint8_t kMeshHopLimit = 64;
+
+// Longest usable link: where log-distance loss takes a 0 dBm transmission
+// down to the LR-WPAN receiver sensitivity, capped by radioRange.
+double MaxLinkDistance(const ScenarioConfig &config) {
+    const double txPowerDbm = 0.0;           // LrWpanPhy default
+    const double rxSensitivityDbm = -106.58; // LrWpanPhy default
+    const double referenceLossDb = 46.6777;  // LogDistancePropagationLossModel default at 1 m
+    double reach = std::pow(10.0, (txPowerDbm - rxSensitivityDbm - referenceLossDb) /
+                                      (10.0 * config.pathLossExponent));
+    return config.radioRange > 0 ? std::min(reach, config.radioRange) : reach;
+}
+
+// First stream number for the demand model; node i uses kDemandStreamBase + i.
+const int64_t kDemandStreamBase = 1000;
+// Emergency arrivals of node i use kEmergencyStreamBase + i, clear of any demand stream.
+const int64_t kEmergencyStreamBase = 1000000;
+
+Ptr<TrafficDemandModel> CreateDemandModel(const std::string &name) {
+    if (name == "uniform")
+        return CreateObject<UniformDemandModel>();
+    if (name == "poisson")
+        return CreateObject<PoissonDemandModel>();
+    if (name == "diurnal")
+        return CreateObject<DiurnalDemandModel>();
+    if (name == "replay")
+        return CreateObject<ReplayDemandModel>();
+    return nullptr;
+}
+
+// Two-class transmit path in front of the LR-WPAN MAC. The MAC has a single
+// FIFO, so an emergency frame handed to it waits behind every routine frame
+// already queued. Routine frames are held here instead and released one at
+// a time, when the MAC queue has drained; urgent frames skip that backlog
+// and go to the socket at once, behind at most the frame already on air.
+// The routine backlog holds at most `capacity` frames; under overload the
+// oldest is dropped for the newest and counted in *drops, so overload shows
+// up as loss rather than as ever-growing memory and delay.
+class PriorityTxQueue {
+public:
+    PriorityTxQueue() : m_macQueued(0), m_peakBacklog(0), m_capacity(0), m_drops(nullptr) {}
+
+    // A capacity of 0 leaves the backlog unbounded.
+    void Setup(Ptr<Socket> socket, Ptr<lrwpan::LrWpanMac> mac, uint32_t capacity = 0, uint32_t *drops = nullptr) {
+        m_socket = socket;
+        m_mac = mac;
+        m_capacity = capacity;
+        m_drops = drops;
+        if (m_mac) {
+            m_mac->TraceConnectWithoutContext("MacTxEnqueue", MakeCallback(&PriorityTxQueue::MacEnqueued, this));
+            m_mac->TraceConnectWithoutContext("MacTxDequeue", MakeCallback(&PriorityTxQueue::MacDequeued, this));
+        }
+    }
+
+    void Stop(void) {
+        if (m_mac) {
+            m_mac->TraceDisconnectWithoutContext("MacTxEnqueue", MakeCallback(&PriorityTxQueue::MacEnqueued, this));
+            m_mac->TraceDisconnectWithoutContext("MacTxDequeue", MakeCallback(&PriorityTxQueue::MacDequeued, this));
+        }
+        if (m_releaseEvent.IsPending())
+            Simulator::Cancel(m_releaseEvent);
+        m_backlog.clear();
+        m_mac = nullptr;
+    }
+
+    void Send(Ptr<Packet> packet, bool urgent) {
+        if (urgent || !m_mac) {
+            m_socket->Send(packet);
+            return;
+        }
+        if (m_capacity > 0 && m_backlog.size() >= m_capacity) {
+            m_backlog.pop_front();
+            if (m_drops)
+                (*m_drops)++;
+        }
+        m_backlog.push_back(packet);
+        m_peakBacklog = std::max<size_t>(m_peakBacklog, m_backlog.size());
+        Release();
+    }
+
+    size_t PeakBacklog() const { return m_peakBacklog; }
+
+private:
+    void MacEnqueued(Ptr<const Packet>) { m_macQueued++; }
+    void MacDequeued(Ptr<const Packet>) {
+        if (m_macQueued > 0)
+            m_macQueued--;
+        // Not from inside the MAC's own dequeue.
+        if (m_macQueued == 0 && !m_backlog.empty() && !m_releaseEvent.IsPending())
+            m_releaseEvent = Simulator::ScheduleNow(&PriorityTxQueue::Release, this);
+    }
+
+    void Release(void) {
+        if (m_macQueued > 0 || m_backlog.empty())
+            return;
+        Ptr<Packet> packet = m_backlog.front();
+        m_backlog.pop_front();
+        m_socket->Send(packet);
+    }
+
+    Ptr<Socket> m_socket;
+    Ptr<lrwpan::LrWpanMac> m_mac;
+    std::deque<Ptr<Packet>> m_backlog;  // Routine frames not yet handed to the MAC
+    uint32_t m_macQueued;               // Frames in the MAC queue, from its enqueue/dequeue traces
+    size_t m_peakBacklog;
+    uint32_t m_capacity;
+    uint32_t *m_drops;                  // Frames pushed out of a full backlog
+    EventId m_releaseEvent;
+};
+
+// What a checkpoint keeps of a sensor application (see wsn-checkpoint.h).
+// Pending timers are stored as nanoseconds left at the checkpoint, -1 when
+// none is pending.
+struct SensorAppState {
+    bool started = false;
+    uint32_t packetsSent = 0;
+    uint16_t seq = 0;
+    uint8_t lastCount = 0;
+    int64_t nextSendNs = -1;
+    int64_t nextEmergencyNs = -1;
+    uint64_t emergencyDraws = 0;  // Values drawn from the emergency gap stream
+};
+
+class TrafficSensorApplication : public Application {
+public:
+    TrafficSensorApplication();
+    virtual ~TrafficSensorApplication();
+
+    static TypeId GetTypeId(void);
+    void Setup(ScenarioContext *context, Ptr<Socket> socket, Address address, uint32_t packetSize,
+               uint32_t nPackets, DataRate dataRate, bool isRFD, bool simulateEmergency = false);
+
+    // Checkpointing. SaveState() captures the application as it is now;
+    // RestoreState() makes the next StartApplication() carry on from a saved
+    // state instead of starting afresh.
+    SensorAppState SaveState(void) const;
+    void RestoreState(const SensorAppState &state);
+
+private:
+    virtual void StartApplication(void);
+    virtual void StopApplication(void);
+
+    void SendPacket(void);
+    void SendEmergencyPacket(void);
+    void ScheduleEmergency(void);
+    void ScheduleTx(void);
+    void SleepCycle(void);
+    void EnterSleep(void);
+    Time ReportInterval(void) const;
+
+    ScenarioContext *m_context;
+    Ptr<Socket> m_socket;
+    Address m_peer;
+    uint32_t m_packetSize;  // Nominal report size; with the data rate it sets the default report interval
+    uint32_t m_padding;     // Filler bytes sent after the report header
+    uint32_t m_lanes;
+    uint32_t m_txBacklog;   // Routine frames held for the MAC before the oldest is dropped
+    uint32_t m_nPackets;
+    DataRate m_dataRate;
+    EventId m_sendEvent;
+    bool m_running;
+    uint32_t m_packetsSent;
+    bool m_isRFD;
+    bool m_simulateEmergency;
+    Time m_reportInterval;
+    bool m_dutyCycle;
+    Time m_awakeWindow;
+    Ptr<lrwpan::LrWpanMac> m_mac;
+    EventId m_sleepEvent;
+    PriorityTxQueue m_tx;
+    double m_emergencyRate;
+    Ptr<ExponentialRandomVariable> m_emergencyGap;
+    EventId m_emergencyEvent;
+    uint64_t m_emergencyDraws;
+    uint8_t m_lastCount;  // Vehicle count of the latest routine report
+    uint16_t m_seq;       // Sequence number of the next reading
+    bool m_restored;
+    SensorAppState m_restore;
+};
+
+TrafficSensorApplication::TrafficSensorApplication()
+    : m_context(nullptr),
+      m_socket(nullptr),
+      m_peer(),
+      m_packetSize(0),
+      m_padding(0),
+      m_lanes(1),
+      m_txBacklog(32),
+      m_nPackets(0),
+      m_dataRate(0),
+      m_running(false),
+      m_packetsSent(0),
+      m_isRFD(false),
+      m_simulateEmergency(false),
+      m_dutyCycle(false),
+      m_emergencyRate(0.0),
+      m_emergencyGap(CreateObject<ExponentialRandomVariable>()),
+      m_emergencyDraws(0),
+      m_lastCount(0),
+      m_seq(0),
+      m_restored(false) {
+}
+
+TrafficSensorApplication::~TrafficSensorApplication() {
+    m_socket = nullptr;
+    m_mac = nullptr;
+}
+
+TypeId TrafficSensorApplication::GetTypeId(void) {
+    static TypeId tid = TypeId("TrafficSensorApplication")
+        .SetParent<Application>()
+        .SetGroupName("WSN")
+        .AddConstructor<TrafficSensorApplication>()
+        .AddAttribute("ReportInterval", "Time between reports; zero derives it from packet size and data rate",
+                      TimeValue(Seconds(0)),
+                      MakeTimeAccessor(&TrafficSensorApplication::m_reportInterval),
+                      MakeTimeChecker())
+        .AddAttribute("DutyCycle", "Switch the RFD transceiver off between reports",
+                      BooleanValue(false),
+                      MakeBooleanAccessor(&TrafficSensorApplication::m_dutyCycle),
+                      MakeBooleanChecker())
+        .AddAttribute("AwakeWindow", "How long the receiver stays on after each report when duty cycling",
+                      TimeValue(MilliSeconds(10)),
+                      MakeTimeAccessor(&TrafficSensorApplication::m_awakeWindow),
+                      MakeTimeChecker())
+        .AddAttribute("EmergencyRate", "Emergency vehicle detections per second (Poisson); 0 disables them",
+                      DoubleValue(0.0),
+                      MakeDoubleAccessor(&TrafficSensorApplication::m_emergencyRate),
+                      MakeDoubleChecker<double>(0.0))
+        .AddAttribute("Padding", "Filler bytes after the report header (the original fixed-size reports were 512)",
+                      UintegerValue(0),
+                      MakeUintegerAccessor(&TrafficSensorApplication::m_padding),
+                      MakeUintegerChecker<uint32_t>())
+        .AddAttribute("Lanes", "Lanes the sensor counts separately; above 1 each report carries per-lane counts",
+                      UintegerValue(1),
+                      MakeUintegerAccessor(&TrafficSensorApplication::m_lanes),
+                      MakeUintegerChecker<uint32_t>(1, kMaxSensorLanes))
+        .AddAttribute("TxBacklog", "Routine reports held for the MAC before the oldest is dropped (0: no limit)",
+                      UintegerValue(32),
+                      MakeUintegerAccessor(&TrafficSensorApplication::m_txBacklog),
+                      MakeUintegerChecker<uint32_t>());
+    return tid;
+}
+
+void TrafficSensorApplication::Setup(ScenarioContext *context, Ptr<Socket> socket, Address address,
+                                     uint32_t packetSize, uint32_t nPackets, DataRate dataRate, bool isRFD,
+                                     bool simulateEmergency) {
+    m_context = context;
+    m_socket = socket;
+    m_peer = address;
+    m_packetSize = packetSize;
+    m_nPackets = nPackets;
+    m_dataRate = dataRate;
+    m_isRFD = isRFD;
+    m_simulateEmergency = simulateEmergency;
+}
+
+SensorAppState TrafficSensorApplication::SaveState(void) const {
+    SensorAppState state;
+    state.started = m_running;
+    state.packetsSent = m_packetsSent;
+    state.seq = m_seq;
+    state.lastCount = m_lastCount;
+    if (m_sendEvent.IsPending())
+        state.nextSendNs = Simulator::GetDelayLeft(m_sendEvent).GetNanoSeconds();
+    if (m_emergencyEvent.IsPending())
+        state.nextEmergencyNs = Simulator::GetDelayLeft(m_emergencyEvent).GetNanoSeconds();
+    state.emergencyDraws = m_emergencyDraws;
+    return state;
+}
+
+void TrafficSensorApplication::RestoreState(const SensorAppState &state) {
+    m_restored = true;
+    m_restore = state;
+}
+
+void TrafficSensorApplication::StartApplication(void) {
+    m_running = true;
+    m_packetsSent = 0;
+    if (m_restored) {
+        m_packetsSent = m_restore.packetsSent;
+        m_seq = m_restore.seq;
+        m_lastCount = m_restore.lastCount;
+    }
+    if (Inet6SocketAddress::IsMatchingType(m_peer))
+        m_socket->Bind6();
+    else
+        m_socket->Bind();
+    m_socket->Connect(m_peer);
+
+    Ptr<lrwpan::LrWpanNetDevice> dev = GetLrWpanDevice(GetNode());
+    m_mac = dev ? dev->GetMac() : nullptr;
+    m_tx.Setup(m_socket, m_mac, m_txBacklog,
+               m_context->metrics.TxBacklogDropCounter(m_context->Index(GetNode()->GetId())));
+
+    // A restored application resumes its report timer where it was; one
+    // saved before its first report was scheduled warms up as usual.
+    if (m_restored && m_restore.nextSendNs >= 0) {
+        if (m_isRFD)
+            EnterSleep();
+        m_sendEvent = Simulator::Schedule(NanoSeconds(m_restore.nextSendNs), &TrafficSensorApplication::SendPacket,
+                                          this);
+    } else if (m_isRFD) {
+        Simulator::Schedule(Seconds(0.5), &TrafficSensorApplication::SleepCycle, this);
+    } else {
+        ScheduleTx();
+    }
+
+    if (m_isRFD && m_simulateEmergency && m_emergencyRate > 0) {
+        m_emergencyGap->SetAttribute("Mean", DoubleValue(1.0 / m_emergencyRate));
+        m_emergencyGap->SetStream(kEmergencyStreamBase + m_context->Index(GetNode()->GetId()));
+        if (m_restored) {
+            for (; m_emergencyDraws < m_restore.emergencyDraws; m_emergencyDraws++)
+                m_emergencyGap->GetValue();
+        }
+        if (m_restored && m_restore.nextEmergencyNs >= 0) {
+            m_emergencyEvent = Simulator::Schedule(NanoSeconds(m_restore.nextEmergencyNs),
+                                                   &TrafficSensorApplication::SendEmergencyPacket, this);
+        } else {
+            ScheduleEmergency();
+        }
+    }
+}
+
+void TrafficSensorApplication::ScheduleEmergency(void) {
+    m_emergencyDraws++;
+    m_emergencyEvent = Simulator::Schedule(Seconds(m_emergencyGap->GetValue()),
+                                           &TrafficSensorApplication::SendEmergencyPacket, this);
+}
+
+void TrafficSensorApplication::SleepCycle(void) {
+    if (!m_running) return;
+    EnterSleep();
+    Simulator::Schedule(Seconds(1.0), &TrafficSensorApplication::ScheduleTx, this);
+}
+
+// With the receiver no longer required on when idle, the MAC puts the PHY in
+// TRX_OFF as soon as it has nothing to send; it wakes the radio by itself
+// for the next transmission and for the ACK that follows it.
+void TrafficSensorApplication::EnterSleep(void) {
+    if (!m_running || !m_dutyCycle || !m_mac) return;
+    NS_LOG_INFO("Node " << GetNode()->GetId() << " entering sleep mode for energy saving");
+    m_mac->SetRxOnWhenIdle(false);
+}
+
+void TrafficSensorApplication::StopApplication(void) {
+    m_running = false;
+    if (m_sendEvent.IsPending())
+        Simulator::Cancel(m_sendEvent);
+    if (m_sleepEvent.IsPending())
+        Simulator::Cancel(m_sleepEvent);
+    if (m_emergencyEvent.IsPending())
+        Simulator::Cancel(m_emergencyEvent);
+    m_tx.Stop();
+
+    if (m_socket)
+        m_socket->Close();
+}
+
+void TrafficSensorApplication::SendPacket(void) {
+    Ptr<Packet> packet = Create<Packet>(m_padding);
+    bool urgent = false;
+
+    if (m_isRFD) {
+        uint32_t nodeId = GetNode()->GetId();
+        uint32_t trafficCount = m_context->demand->GetVehicleCount(m_context->Index(nodeId), Simulator::Now(),
+                                                                   ReportInterval());
+        bool emergency = m_simulateEmergency &&
+                         (m_context->demand->SensesEmergencies()
+                              ? m_context->demand->EmergencyVehicle(m_context->Index(nodeId), Simulator::Now())
+                              : trafficCount > 8);
+
+        uint8_t count = static_cast<uint8_t>(std::min<uint32_t>(trafficCount, 255));
+        m_lastCount = count;
+        SensorRecord record = {nodeId, 1, count, count, emergency, m_seq++,
+                               static_cast<uint32_t>(Simulator::Now().GetMicroSeconds())};
+        if (m_lanes > 1) {
+            // The sensor's count spread evenly over the lanes it watches
+            record.lanes = static_cast<uint8_t>(std::min(m_lanes, kMaxSensorLanes));
+            for (uint8_t lane = 0; lane < record.lanes; lane++)
+                record.laneCounts[lane] = count / record.lanes + (lane < count % record.lanes ? 1 : 0);
+        }
+        SensorReportHeader report;
+        report.AddRecord(record);
+        report.SetFrameTime(Simulator::Now());
+        report.SetGenerated(Simulator::Now());
+        m_context->metrics.ReadingSent(m_context->Index(nodeId));
+        packet->AddHeader(report);
+        urgent = emergency;
+        if (emergency)
+            m_context->emergencyEvents++;
+
+        m_context->CountReading(m_context->readingsSentByHops, m_context->Index(nodeId));
+
+        NS_LOG_INFO("Node " << nodeId << " detected " << trafficCount
+                            << " vehicles at time " << Simulator::Now().GetSeconds()
+                            << (emergency ? " [EMERGENCY]" : ""));
+    }
+
+    SendTimeTag sendTime;
+    sendTime.SetSendTime(Simulator::Now());
+    packet->AddPacketTag(sendTime);
+
+    m_tx.Send(packet, urgent);
+    m_packetsSent++;
+    m_context->packetsSent++;
+
+    // Listen briefly after the report (e.g. for downlink), then sleep again.
+    if (m_isRFD && m_dutyCycle && m_mac) {
+        m_mac->SetRxOnWhenIdle(true);
+        m_sleepEvent = Simulator::Schedule(m_awakeWindow, &TrafficSensorApplication::EnterSleep, this);
+    }
+
+    if (m_packetsSent < m_nPackets) {
+        ScheduleTx();
+    }
+}
+
+// An emergency vehicle was detected: report it now, as a short frame that
+// skips the routine backlog, rather than on the next report tick.
+void TrafficSensorApplication::SendEmergencyPacket(void) {
+    if (!m_running)
+        return;
+    uint32_t nodeId = GetNode()->GetId();
+    uint32_t index = m_context->Index(nodeId);
+
+    SensorReportHeader report;
+    report.AddRecord({nodeId, 1, m_lastCount, m_lastCount, true, m_seq++,
+                      static_cast<uint32_t>(Simulator::Now().GetMicroSeconds())});
+    report.SetFrameTime(Simulator::Now());
+    report.SetGenerated(Simulator::Now());
+    m_context->metrics.ReadingSent(index);
+    Ptr<Packet> packet = Create<Packet>();
+    packet->AddHeader(report);
+
+    SendTimeTag sendTime;
+    sendTime.SetSendTime(Simulator::Now());
+    packet->AddPacketTag(sendTime);
+
+    m_tx.Send(packet, true);
+    m_context->packetsSent++;
+    m_context->emergencyEvents++;
+    m_context->CountReading(m_context->readingsSentByHops, index);
+    NS_LOG_INFO("Node " << nodeId << " sent an emergency packet at time " << Simulator::Now().GetSeconds());
+
+    if (m_dutyCycle && m_mac) {
+        m_mac->SetRxOnWhenIdle(true);
+        if (m_sleepEvent.IsPending())
+            Simulator::Cancel(m_sleepEvent);
+        m_sleepEvent = Simulator::Schedule(m_awakeWindow, &TrafficSensorApplication::EnterSleep, this);
+    }
+    ScheduleEmergency();
+}
+
+Time TrafficSensorApplication::ReportInterval(void) const {
+    if (m_reportInterval.IsStrictlyPositive())
+        return m_reportInterval;
+    return Seconds(m_packetSize * 8 / static_cast<double>(m_dataRate.GetBitRate()));
+}
+
+void TrafficSensorApplication::ScheduleTx(void) {
+    if (m_running) {
+        Time tNext(ReportInterval());
+        m_sendEvent = Simulator::Schedule(tNext, &TrafficSensorApplication::SendPacket, this);
+    }
+}
+
+// Per-packet receive accounting shared by the FPC sink and the cluster heads.
+// Returns the receiver's index within the scenario.
+uint32_t RecordReception(ScenarioContext *context, Ptr<Node> receiver, Ptr<const Packet> packet) {
+    uint32_t receiverIndex = context->Index(receiver->GetId());
+    context->nodeDataCount[receiverIndex]++;
+    context->packetsReceived++;
+
+    SendTimeTag sendTime;
+    if (packet->PeekPacketTag(sendTime)) {
+        double delay = (Simulator::Now() - sendTime.GetSendTime()).GetSeconds();
+        context->totalDelaySeconds += delay;
+
+        // Only mesh receivers ask for the hop limit; single-hop frames travel one hop.
+        uint32_t hops = 1;
+        SocketIpv6HopLimitTag hopLimit;
+        if (packet->PeekPacketTag(hopLimit) && hopLimit.GetHopLimit() <= kMeshHopLimit)
+            hops = kMeshHopLimit + 1 - hopLimit.GetHopLimit();
+        context->perHopDelaySeconds += delay / hops;
+    }
+    return receiverIndex;
+}
+
+void ReceivePacket(ScenarioContext *context, Ptr<Socket> socket) {
+    Ptr<Packet> packet;
+    Address from;
+
+    while ((packet = socket->RecvFrom(from))) {
+        SensorReportHeader eh;
+        packet->PeekHeader(eh);
+        uint32_t receiverIndex = RecordReception(context, socket->GetNode(), packet);
+
+        NS_LOG_INFO("Node " << socket->GetNode()->GetId() << " received packet with "
+                            << eh.GetRecords().size() << " readings"
+                            << (eh.IsEmergency() ? " [EMERGENCY]" : ""));
+
+        if (receiverIndex < context->numFPC) {
+            NS_LOG_INFO("FPC received data, total packets: " << context->nodeDataCount[receiverIndex]);
+            if (context->sinkBytes == 0)
+                context->sinkFirstRx = Simulator::Now();
+            context->sinkLastRx = Simulator::Now();
+            context->sinkBytes += packet->GetSize();
+            // The sensor log holds what reached the sink, decoded from the
+            // frame and stamped with when each reading was taken.
+            uint32_t nowUs = static_cast<uint32_t>(Simulator::Now().GetMicroSeconds());
+            for (const SensorRecord &record : eh.GetRecords()) {
+                uint32_t index = context->Index(record.nodeId);
+                uint32_t ageUs = nowUs - record.sampledUs;
+                context->CountReading(context->readingsDeliveredByHops, index);
+                context->metrics.ReadingDelivered(index, record.seq, record.samples, ageUs);
+                context->trafficDataLog->Append({(Simulator::Now() - MicroSeconds(ageUs)).GetSeconds(), index,
+                                                 record.count, record.emergency});
+            }
+            context->metrics.SinkReceived(Simulator::Now(), packet->GetSize(), eh.GetRecords().size());
+            if (eh.IsEmergency()) {
+                context->emergencyToFpc.Add(Simulator::Now() - eh.GetGenerated());
+            }
+            if (context->deliveredReadings != nullptr) {
+                // Each record carries its own sample time; frames held in an
+                // aggregation window or a busy MAC arrive that much older.
+                for (const SensorRecord &record : eh.GetRecords()) {
+                    context->deliveredReadings->Push({record.nodeId, record.count, record.maxCount, record.emergency,
+                                                      SensorReportHeader::UnwrapUs(record.sampledUs),
+                                                      Simulator::Now()});
+                }
+            }
+        }
+    }
+}
+
+// What a checkpoint keeps of a cluster head.
+struct ClusterHeadState {
+    bool started = false;
+    std::vector<SensorRecord> pending;  // Merged records not yet forwarded
+    int64_t nextFlushNs = -1;
+};
+
+// FFD cluster-head relay. Readings received from child RFDs are merged per
+// child (latest count, max count, OR-ed emergency flag) for up to
+// AggregationWindow and forwarded to the FPC as one multi-record frame.
+// Emergency readings skip the window and go out immediately.
+class ClusterHeadApplication : public Application {
+public:
+    ClusterHeadApplication();
+    virtual ~ClusterHeadApplication();
+
+    static TypeId GetTypeId(void);
+    void Setup(ScenarioContext *context, Ptr<Socket> rxSocket, Ptr<Socket> txSocket, Address fpcAddress);
+
+    // Checkpointing, as for TrafficSensorApplication.
+    ClusterHeadState SaveState(void) const;
+    void RestoreState(const ClusterHeadState &state);
+
+private:
+    virtual void StartApplication(void);
+    virtual void StopApplication(void);
+
+    void HandleRead(Ptr<Socket> socket);
+    void Merge(const SensorRecord &record);
+    void Flush(void);
+    void SendRecords(const std::vector<SensorRecord> &records, Time generated = Time());
+
+    ScenarioContext *m_context;
+    Ptr<Socket> m_rxSocket;
+    Ptr<Socket> m_txSocket;
+    Address m_fpcAddress;
+    Time m_window;
+    uint32_t m_maxRecordsPerFrame;
+    uint32_t m_txBacklog;
+    std::vector<SensorRecord> m_pending;  // One merged record per child
+    EventId m_flushEvent;
+    PriorityTxQueue m_tx;
+    bool m_started;
+    bool m_restored;
+    ClusterHeadState m_restore;
+};
+
+ClusterHeadApplication::ClusterHeadApplication()
+    : m_context(nullptr),
+      m_rxSocket(nullptr),
+      m_txSocket(nullptr),
+      m_maxRecordsPerFrame(6),
+      m_txBacklog(32),
+      m_started(false),
+      m_restored(false) {
+}
+
+ClusterHeadApplication::~ClusterHeadApplication() {
+    m_rxSocket = nullptr;
+    m_txSocket = nullptr;
+}
+
+TypeId ClusterHeadApplication::GetTypeId(void) {
+    static TypeId tid = TypeId("ClusterHeadApplication")
+        .SetParent<Application>()
+        .SetGroupName("WSN")
+        .AddConstructor<ClusterHeadApplication>()
+        .AddAttribute("AggregationWindow", "How long readings are batched before forwarding; 0 forwards each one",
+                      TimeValue(Seconds(2.0)),
+                      MakeTimeAccessor(&ClusterHeadApplication::m_window),
+                      MakeTimeChecker())
+        .AddAttribute("MaxRecordsPerFrame", "Records per upstream frame (keeps frames within the 127-byte PSDU)",
+                      UintegerValue(6),
+                      MakeUintegerAccessor(&ClusterHeadApplication::m_maxRecordsPerFrame),
+                      MakeUintegerChecker<uint32_t>(1, 255))
+        .AddAttribute("TxBacklog", "Routine frames held for the MAC before the oldest is dropped (0: no limit)",
+                      UintegerValue(32),
+                      MakeUintegerAccessor(&ClusterHeadApplication::m_txBacklog),
+                      MakeUintegerChecker<uint32_t>());
+    return tid;
+}
+
+void ClusterHeadApplication::Setup(ScenarioContext *context, Ptr<Socket> rxSocket, Ptr<Socket> txSocket,
+                                   Address fpcAddress) {
+    m_context = context;
+    m_rxSocket = rxSocket;
+    m_txSocket = txSocket;
+    m_fpcAddress = fpcAddress;
+}
+
+ClusterHeadState ClusterHeadApplication::SaveState(void) const {
+    ClusterHeadState state;
+    state.started = m_started;
+    state.pending = m_pending;
+    if (m_flushEvent.IsPending())
+        state.nextFlushNs = Simulator::GetDelayLeft(m_flushEvent).GetNanoSeconds();
+    return state;
+}
+
+void ClusterHeadApplication::RestoreState(const ClusterHeadState &state) {
+    m_restored = true;
+    m_restore = state;
+}
+
+void ClusterHeadApplication::StartApplication(void) {
+    m_started = true;
+    m_rxSocket->SetRecvCallback(MakeCallback(&ClusterHeadApplication::HandleRead, this));
+    if (Inet6SocketAddress::IsMatchingType(m_fpcAddress))
+        m_txSocket->Bind6();
+    else
+        m_txSocket->Bind();
+    m_txSocket->Connect(m_fpcAddress);
+    Ptr<lrwpan::LrWpanNetDevice> dev = GetLrWpanDevice(GetNode());
+    m_tx.Setup(m_txSocket, dev ? dev->GetMac() : nullptr, m_txBacklog,
+               m_context->metrics.TxBacklogDropCounter(m_context->Index(GetNode()->GetId())));
+
+    if (m_restored) {
+        m_pending = m_restore.pending;
+        if (m_restore.nextFlushNs >= 0)
+            m_flushEvent = Simulator::Schedule(NanoSeconds(m_restore.nextFlushNs), &ClusterHeadApplication::Flush,
+                                               this);
+    }
+}
+
+void ClusterHeadApplication::StopApplication(void) {
+    m_started = false;
+    if (m_flushEvent.IsPending())
+        Simulator::Cancel(m_flushEvent);
+    m_rxSocket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+    m_tx.Stop();
+    m_txSocket->Close();
+}
+
+void ClusterHeadApplication::HandleRead(Ptr<Socket> socket) {
+    Ptr<Packet> packet;
+    Address from;
+
+    while ((packet = socket->RecvFrom(from))) {
+        RecordReception(m_context, GetNode(), packet);
+        m_context->unbatchedFrames++;
+        m_context->unbatchedBytes += packet->GetSize();
+
+        SensorReportHeader eh;
+        packet->PeekHeader(eh);
+        const std::vector<SensorRecord> &records = eh.GetRecords();
+        m_context->relayReadings += records.size();
+        NS_LOG_INFO("FFD " << GetNode()->GetId() << " received " << records.size() << " readings"
+                           << (eh.IsEmergency() ? " [EMERGENCY]" : ""));
+
+        if (eh.IsEmergency() || m_window.IsZero()) {
+            SendRecords(records, eh.GetGenerated());
+            continue;
+        }
+        for (const SensorRecord &record : records) {
+            Merge(record);
+        }
+        if (!m_flushEvent.IsPending()) {
+            m_flushEvent = Simulator::Schedule(m_window, &ClusterHeadApplication::Flush, this);
+        }
+    }
+}
+
+void ClusterHeadApplication::Merge(const SensorRecord &record) {
+    for (SensorRecord &pending : m_pending) {
+        if (pending.nodeId == record.nodeId) {
+            uint8_t samples = static_cast<uint8_t>(std::min(pending.samples + record.samples, 127));
+            uint8_t maxCount = std::max(pending.maxCount, record.maxCount);
+            bool emergency = pending.emergency || record.emergency;
+            pending = record;  // Latest count, lane counts, sequence number and sample time
+            pending.samples = samples;
+            pending.maxCount = maxCount;
+            pending.emergency = emergency;
+            return;
+        }
+    }
+    m_pending.push_back(record);
+}
+
+void ClusterHeadApplication::Flush(void) {
+    SendRecords(m_pending);
+    m_pending.clear();
+}
+
+void ClusterHeadApplication::SendRecords(const std::vector<SensorRecord> &records, Time generated) {
+    for (size_t first = 0; first < records.size(); first += m_maxRecordsPerFrame) {
+        size_t last = std::min<size_t>(first + m_maxRecordsPerFrame, records.size());
+        SensorReportHeader eh;
+        for (size_t i = first; i < last; i++) {
+            eh.AddRecord(records[i]);
+        }
+        eh.SetFrameTime(Simulator::Now());
+        eh.SetGenerated(generated);
+
+        Ptr<Packet> packet = Create<Packet>();
+        packet->AddHeader(eh);
+        SendTimeTag sendTime;
+        sendTime.SetSendTime(Simulator::Now());
+        packet->AddPacketTag(sendTime);
+
+        m_tx.Send(packet, eh.IsEmergency());
+        m_context->packetsSent++;
+        m_context->relayFrames++;
+        m_context->relayBytes += packet->GetSize();
+    }
+}
+
+// Node placement for BuildWsnNetwork(). An empty list keeps the default
+// layout for that role, scaled by ScenarioConfig::fieldSize (100 m): FPC at
+// the centre, FFDs on a 2-wide grid, RFDs uniformly over the field.
+// ffdParent / rfdParent give each FFD's FPC and each RFD's FFD by index
+// within their role; empty (or -1) means nearest.
+struct WsnLayout {
+    std::vector<Vector> fpc;
+    std::vector<Vector> ffd;
+    std::vector<Vector> rfd;
+    std::vector<int32_t> ffdParent;
+    std::vector<int32_t> rfdParent;
+};
+
+// Reads a sensor_map.csv written by generate_grid.py
+// (NodeID,Role,X,Y,Parent,Junction,Lane; FPCs, then FFDs, then RFDs).
+bool LoadWsnTopology(const std::string &path, WsnLayout &layout) {
+    std::ifstream in(path.c_str());
+    if (!in.is_open())
+        return false;
+    std::string line;
+    std::getline(in, line);  // Header
+    while (std::getline(in, line)) {
+        std::istringstream row(line);
+        std::string nodeId, role, x, y, parent;
+        if (!std::getline(row, nodeId, ',') || !std::getline(row, role, ',') || !std::getline(row, x, ',') ||
+            !std::getline(row, y, ',') || !std::getline(row, parent, ','))
+            continue;
+        Vector pos(std::stod(x), std::stod(y), 0.0);
+        int32_t parentIndex = parent.empty() ? -1 : std::stoi(parent);
+        if (role == "FPC") {
+            layout.fpc.push_back(pos);
+        } else if (role == "FFD") {
+            layout.ffd.push_back(pos);
+            layout.ffdParent.push_back(parentIndex);
+        } else if (role == "RFD") {
+            layout.rfd.push_back(pos);
+            layout.rfdParent.push_back(parentIndex);
+        }
+    }
+    return !layout.fpc.empty();
+}
+
+// Nodes and addresses of a built scenario, FPCs first, then FFDs, then RFDs.
+struct WsnNetwork {
+    NodeContainer fpcNodes;
+    NodeContainer ffdNodes;
+    NodeContainer rfdNodes;
+    NodeContainer allNodes;
+    NetDeviceContainer devices;
+    Ipv4InterfaceContainer interfaces;    // Single-hop mode
+    NetDeviceContainer sixLowPanDevices;  // Mesh mode
+    Ipv6InterfaceContainer interfaces6;   // Mesh mode
+
+    // UDP address of the node at scenario index i.
+    Address SocketAddress(uint32_t i, uint16_t port) const {
+        if (interfaces6.GetN() > 0)
+            return Inet6SocketAddress(interfaces6.GetAddress(i, 1), port);
+        return InetSocketAddress(interfaces.GetAddress(i), port);
+    }
+};
+
+// Collection tree for mesh mode. FPCs and FFDs form the routing backbone;
+// RFDs are leaves, as 802.15.4 reduced-function devices do not route. Each
+// backbone node's parent is its closest neighbour one hop nearer an FPC
+// (breadth-first from every FPC over links up to maxLink metres), much like
+// an RPL DODAG with hop-count rank. parent[i] is a scenario index, -1 for
+// FPCs and for nodes with no path to one; depth[i] is the hop count to the
+// FPC, or UINT32_MAX when unreachable.
+struct CollectionTree {
+    std::vector<int32_t> parent;
+    std::vector<uint32_t> depth;
+};
+
+CollectionTree BuildCollectionTree(const std::vector<double> &xs, const std::vector<double> &ys, uint32_t numFPC,
+                                   double maxLink) {
+    const uint32_t n = xs.size();
+    CollectionTree tree;
+    tree.parent.assign(n, -1);
+    tree.depth.assign(n, std::numeric_limits<uint32_t>::max());
+
+    GridSpatialIndex index;
+    index.Build(xs, ys, maxLink);
+    auto dist2 = [&](uint32_t a, uint32_t b) {
+        return (xs[a] - xs[b]) * (xs[a] - xs[b]) + (ys[a] - ys[b]) * (ys[a] - ys[b]);
+    };
+
+    std::vector<uint32_t> frontier, next, neighbours;
+    for (uint32_t i = 0; i < numFPC && i < n; i++) {
+        tree.depth[i] = 0;
+        frontier.push_back(i);
+    }
+    for (uint32_t level = 1; !frontier.empty(); level++) {
+        next.clear();
+        for (uint32_t u : frontier) {
+            index.WithinRadius(xs[u], ys[u], maxLink, neighbours);
+            for (uint32_t v : neighbours) {
+                if (tree.depth[v] < level)
+                    continue;
+                if (tree.depth[v] != level) {
+                    tree.depth[v] = level;
+                    tree.parent[v] = u;
+                    next.push_back(v);
+                } else if (dist2(u, v) < dist2(tree.parent[v], v)) {
+                    tree.parent[v] = u;
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+    return tree;
+}
+
+// Creates the nodes, LR-WPAN devices, energy models, IP stack, sensor log
+// and applications for config. Returns false if the sensor log cannot be
+// opened. context.demand must be set.
+bool BuildWsnNetwork(const ScenarioConfig &config, const WsnLayout &layout, ScenarioContext &context,
+                     WsnNetwork &net) {
+    const uint32_t numRFD = config.numRFD;
+    const uint32_t numFFD = config.numFFD;
+    const uint32_t numFPC = config.numFPC;
+    const double simTime = config.simTime;
+
+    // Every device gets short address i + 1; 0xfffe and 0xffff are reserved
+    // by IEEE 802.15.4, so the last usable one is 0xfffd.
+    if (uint64_t(numFPC) + numFFD + numRFD > 0xfffd) {
+        std::cerr << "Too many nodes (" << uint64_t(numFPC) + numFFD + numRFD
+                  << "): at most 65533 fit the 802.15.4 short address space" << std::endl;
+        return false;
+    }
+
+    net.fpcNodes.Create(numFPC, config.systemId);
+    net.ffdNodes.Create(numFFD, config.systemId);
+    net.rfdNodes.Create(numRFD, config.systemId);
+    net.allNodes.Add(net.fpcNodes);
+    net.allNodes.Add(net.ffdNodes);
+    net.allNodes.Add(net.rfdNodes);
+
+    context.firstNodeId = net.fpcNodes.Get(0)->GetId();
+    context.numFPC = numFPC;
+    context.nodeDataCount.assign(net.allNodes.GetN(), 0);
+    context.metrics.Resize(net.allNodes.GetN());
+    context.demand->AssignStreams(kDemandStreamBase, net.allNodes.GetN());
+
+    // Same channel LrWpanHelper builds by default, with a configurable path
+    // loss exponent and an optional hard range cut-off.
+    Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel>();
+    Ptr<LogDistancePropagationLossModel> pathLoss = CreateObject<LogDistancePropagationLossModel>();
+    pathLoss->SetPathLossExponent(config.pathLossExponent);
+    if (config.radioRange > 0) {
+        Ptr<RangePropagationLossModel> range = CreateObject<RangePropagationLossModel>();
+        range->SetAttribute("MaxRange", DoubleValue(config.radioRange));
+        pathLoss->SetNext(range);
+    }
+    channel->AddPropagationLossModel(pathLoss);
+    channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+
+    LrWpanHelper lrWpanHelper;
+    lrWpanHelper.SetChannel(channel);
+    net.devices = lrWpanHelper.Install(net.allNodes);
+
+    // Assign unique short addresses to avoid IPv4 address collisions.
+    for (uint32_t i = 0; i < net.devices.GetN(); i++) {
+        Ptr<NetDevice> dev = net.devices.Get(i);
+        Ptr<ns3::lrwpan::LrWpanNetDevice> lrwpanDev = DynamicCast<ns3::lrwpan::LrWpanNetDevice>(dev);
+        if (lrwpanDev != nullptr) {
+            Ptr<ns3::lrwpan::LrWpanMac> mac = lrwpanDev->GetMac();
+            if (mac != nullptr) {
+                mac->SetShortAddress(i + 1);
+            }
+        }
+    }
+
+    // Battery and radio energy model on every node.
+    for (uint32_t i = 0; i < net.allNodes.GetN(); i++) {
+        Ptr<Node> node = net.allNodes.Get(i);
+        Ptr<energy::BasicEnergySource> battery = CreateObject<energy::BasicEnergySource>();
+        battery->SetInitialEnergy(config.batteryJ);
+        battery->SetSupplyVoltage(3.0);
+        battery->SetNode(node);
+        node->AggregateObject(battery);
+
+        Ptr<LrWpanRadioEnergyModel> radio = CreateObject<LrWpanRadioEnergyModel>();
+        radio->SetEnergySource(battery);
+        battery->AppendDeviceEnergyModel(radio);
+        radio->Attach(GetLrWpanDevice(node)->GetPhy());
+        context.metrics.Attach(i, GetLrWpanDevice(node));
+
+        context.batteries.push_back(battery);
+        context.radioEnergy.push_back(radio);
+    }
+
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    auto placeAt = [&mobility](const std::vector<Vector> &positions) {
+        Ptr<ListPositionAllocator> list = CreateObject<ListPositionAllocator>();
+        for (const Vector &pos : positions) {
+            list->Add(pos);
+        }
+        mobility.SetPositionAllocator(list);
+    };
+
+    if (layout.fpc.empty()) {
+        mobility.SetPositionAllocator("ns3::GridPositionAllocator",
+                                      "MinX", DoubleValue(0.5 * config.fieldSize),
+                                      "MinY", DoubleValue(0.5 * config.fieldSize),
+                                      "DeltaX", DoubleValue(0.0),
+                                      "DeltaY", DoubleValue(0.0),
+                                      "GridWidth", UintegerValue(1),
+                                      "LayoutType", StringValue("RowFirst"));
+    } else {
+        placeAt(layout.fpc);
+    }
+    mobility.Install(net.fpcNodes);
+
+    if (layout.ffd.empty()) {
+        mobility.SetPositionAllocator("ns3::GridPositionAllocator",
+                                      "MinX", DoubleValue(0.3 * config.fieldSize),
+                                      "MinY", DoubleValue(0.3 * config.fieldSize),
+                                      "DeltaX", DoubleValue(0.2 * config.fieldSize),
+                                      "DeltaY", DoubleValue(0.2 * config.fieldSize),
+                                      "GridWidth", UintegerValue(2),
+                                      "LayoutType", StringValue("RowFirst"));
+    } else {
+        placeAt(layout.ffd);
+    }
+    mobility.Install(net.ffdNodes);
+
+    if (layout.rfd.empty()) {
+        std::string side = "ns3::UniformRandomVariable[Min=0.0|Max=" + std::to_string(config.fieldSize) + "]";
+        mobility.SetPositionAllocator("ns3::RandomRectanglePositionAllocator",
+                                      "X", StringValue(side),
+                                      "Y", StringValue(side));
+    } else {
+        placeAt(layout.rfd);
+    }
+    mobility.Install(net.rfdNodes);
+
+    // Who reports to whom: each FFD's FPC and each RFD's cluster head, as
+    // indices within their role (sinkOf) or scenario indices (headOf, -1 when
+    // the RFD cannot reach the backbone).
+    std::vector<double> xs(net.allNodes.GetN()), ys(net.allNodes.GetN());
+    for (uint32_t i = 0; i < net.allNodes.GetN(); i++) {
+        Vector pos = net.allNodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
+        xs[i] = pos.x;
+        ys[i] = pos.y;
+    }
+    const uint32_t numBackbone = numFPC + numFFD;
+    std::vector<uint32_t> sinkOf(numFFD, 0);
+    std::vector<int32_t> headOf(numRFD, -1);
+    context.hopsToSink.assign(net.allNodes.GetN(), 0);
+    CollectionTree tree;
+
+    if (config.meshRouting) {
+        double maxLink = MaxLinkDistance(config);
+        std::vector<double> bx(xs.begin(), xs.begin() + numBackbone), by(ys.begin(), ys.begin() + numBackbone);
+        tree = BuildCollectionTree(bx, by, numFPC, maxLink);
+        for (uint32_t i = 0; i < numFFD; i++) {
+            uint32_t root = numFPC + i;
+            while (tree.parent[root] >= 0)
+                root = tree.parent[root];
+            sinkOf[i] = root < numFPC ? root : 0;
+            if (tree.depth[numFPC + i] == std::numeric_limits<uint32_t>::max()) {
+                context.unreachableNodes++;
+            } else {
+                context.hopsToSink[numFPC + i] = tree.depth[numFPC + i];
+            }
+        }
+
+        // RFDs join their layout parent when it is in reach and on the tree,
+        // otherwise the reachable backbone node with the fewest hops to an FPC.
+        GridSpatialIndex backboneIndex;
+        backboneIndex.Build(bx, by, maxLink);
+        std::vector<uint32_t> candidates;
+        for (uint32_t i = 0; i < numRFD; i++) {
+            uint32_t index = numBackbone + i;
+            int32_t preferred = i < layout.rfdParent.size() && layout.rfdParent[i] >= 0
+                                    ? static_cast<int32_t>(numFPC) + layout.rfdParent[i] : -1;
+            backboneIndex.WithinRadius(xs[index], ys[index], maxLink, candidates);
+            double bestD2 = std::numeric_limits<double>::max();
+            for (uint32_t c : candidates) {
+                if (tree.depth[c] == std::numeric_limits<uint32_t>::max())
+                    continue;
+                if (static_cast<int32_t>(c) == preferred) {
+                    headOf[i] = c;
+                    break;
+                }
+                double d2 = (xs[c] - xs[index]) * (xs[c] - xs[index]) + (ys[c] - ys[index]) * (ys[c] - ys[index]);
+                if (headOf[i] < 0 || tree.depth[c] < tree.depth[headOf[i]] ||
+                    (tree.depth[c] == tree.depth[headOf[i]] && d2 < bestD2)) {
+                    headOf[i] = c;
+                    bestD2 = d2;
+                }
+            }
+            if (headOf[i] < 0) {
+                context.unreachableNodes++;
+            } else {
+                context.hopsToSink[index] = tree.depth[headOf[i]] + 1;
+            }
+        }
+        NS_LOG_INFO("Collection tree: links up to " << maxLink << " m, " << context.unreachableNodes
+                    << " nodes without a route to an FPC");
+    } else {
+        // Single hop: FFDs report to their layout FPC or the nearest one, RFDs
+        // to their layout FFD or the nearest one.
+        GridSpatialIndex fpcIndex;
+        fpcIndex.Build(std::vector<double>(xs.begin(), xs.begin() + numFPC),
+                       std::vector<double>(ys.begin(), ys.begin() + numFPC));
+        for (uint32_t i = 0; i < numFFD; i++) {
+            int64_t fpc = i < layout.ffdParent.size() ? layout.ffdParent[i] : -1;
+            if (fpc < 0 || fpc >= numFPC) {
+                fpc = fpcIndex.Nearest(xs[numFPC + i], ys[numFPC + i]);
+            }
+            sinkOf[i] = fpc < 0 ? 0 : static_cast<uint32_t>(fpc);
+            context.hopsToSink[numFPC + i] = 1;
+        }
+
+        // Cache cluster-head positions once and index them for the RFD -> FFD assignment.
+        GridSpatialIndex ffdIndex;
+        ffdIndex.Build(std::vector<double>(xs.begin() + numFPC, xs.begin() + numBackbone),
+                       std::vector<double>(ys.begin() + numFPC, ys.begin() + numBackbone));
+        for (uint32_t i = 0; i < numRFD; i++) {
+            int64_t parent = i < layout.rfdParent.size() ? layout.rfdParent[i] : -1;
+            if (parent < 0 || parent >= numFFD) {
+                parent = ffdIndex.Nearest(xs[numBackbone + i], ys[numBackbone + i]);
+            }
+            headOf[i] = numFPC + (parent < 0 ? 0 : static_cast<uint32_t>(parent));
+            context.hopsToSink[numBackbone + i] = 2;
+        }
+    }
+
+    InternetStackHelper internet;
+    if (config.meshRouting) {
+        internet.SetIpv4StackInstall(false);
+        internet.Install(net.allNodes);
+        // Addresses are unique by construction; skip the DAD burst at start-up.
+        for (uint32_t i = 0; i < net.allNodes.GetN(); i++) {
+            net.allNodes.Get(i)->GetObject<Icmpv6L4Protocol>()->SetAttribute("DAD", BooleanValue(false));
+        }
+
+        SixLowPanHelper sixLowPan;
+        net.sixLowPanDevices = sixLowPan.Install(net.devices);
+        Ipv6AddressHelper ipv6;
+        ipv6.SetBase(Ipv6Address("2001:1::"), Ipv6Prefix(64));
+        net.interfaces6 = ipv6.Assign(net.sixLowPanDevices);
+
+        // Everything shares one on-link prefix, so each backbone node gets a
+        // host route to its FPC through its tree parent, and forwards.
+        Ipv6StaticRoutingHelper routingHelper;
+        for (uint32_t i = 0; i < numBackbone; i++) {
+            net.interfaces6.SetForwarding(i, true);
+            if (tree.parent[i] < 0)
+                continue;
+            Ptr<Ipv6> ipv6Stack = net.allNodes.Get(i)->GetObject<Ipv6>();
+            Ptr<Ipv6StaticRouting> routing = routingHelper.GetStaticRouting(ipv6Stack);
+            routing->AddHostRouteTo(net.interfaces6.GetAddress(sinkOf[i - numFPC], 1),
+                                    net.interfaces6.GetAddress(tree.parent[i], 1),
+                                    net.interfaces6.GetInterfaceIndex(i));
+        }
+        NS_LOG_INFO("Number of interfaces assigned: " << net.interfaces6.GetN());
+    } else {
+        internet.Install(net.allNodes);
+
+        Ipv4AddressHelper ipv4;
+        ipv4.SetBase("10.1.0.0", "255.255.0.0");  // Room for city-scale grids (~65k nodes)
+        net.interfaces = ipv4.Assign(net.devices);
+
+        // Debugging: Print the number of interfaces assigned
+        NS_LOG_INFO("Number of interfaces assigned: " << net.interfaces.GetN());
+    }
+
+    std::string trafficDataPath = config.outputDir + "/traffic_sensor_data";
+    context.trafficDataLog = CreateSensorLogWriter(config.sensorLogFormat, trafficDataPath);
+    if (!context.trafficDataLog || !context.trafficDataLog->IsOpen()) {
+        std::cerr << "Cannot open sensor log (format " << config.sensorLogFormat << ") at " << trafficDataPath
+                  << std::endl;
+        return false;
+    }
+
+    uint16_t port = 9;
+    TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+    // Mesh receivers ask for the remaining hop limit, mesh senders set it.
+    auto openReceiver = [&](Ptr<Node> node) {
+        Ptr<Socket> socket = Socket::CreateSocket(node, tid);
+        if (config.meshRouting) {
+            socket->Bind(Inet6SocketAddress(Ipv6Address::GetAny(), port));
+            socket->SetIpv6RecvHopLimit(true);
+        } else {
+            socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), port));
+        }
+        return socket;
+    };
+    auto openSender = [&](Ptr<Node> node) {
+        Ptr<Socket> socket = Socket::CreateSocket(node, tid);
+        if (config.meshRouting)
+            socket->SetIpv6HopLimit(kMeshHopLimit);
+        return socket;
+    };
+
+    for (uint32_t k = 0; k < numFPC; k++) {
+        Ptr<Socket> fpcRxSocket = openReceiver(net.fpcNodes.Get(k));
+        fpcRxSocket->SetRecvCallback(MakeBoundCallback(&ReceivePacket, &context));
+    }
+
+    for (uint32_t i = 0; i < numFFD; i++) {
+        Ptr<Socket> ffdRxSocket = openReceiver(net.ffdNodes.Get(i));
+        Ptr<Socket> ffdTxSocket = openSender(net.ffdNodes.Get(i));
+
+        Ptr<ClusterHeadApplication> app = CreateObject<ClusterHeadApplication>();
+        app->SetAttribute("AggregationWindow", TimeValue(Seconds(config.aggregationWindow)));
+        app->SetAttribute("TxBacklog", UintegerValue(config.txBacklog));
+        app->Setup(&context, ffdRxSocket, ffdTxSocket, net.SocketAddress(sinkOf[i], port));
+        net.ffdNodes.Get(i)->AddApplication(app);
+        app->SetStartTime(Seconds(1.0));
+        app->SetStopTime(Seconds(simTime));
+    }
+
+    for (uint32_t i = 0; i < numRFD; i++) {
+        if (headOf[i] < 0) {
+            NS_LOG_WARN("RFD " << i << " has no cluster head in radio reach; not started");
+            continue;
+        }
+        NS_LOG_INFO("Assigning RFD " << i << " to node " << headOf[i] << " (" << context.hopsToSink[numBackbone + i]
+                    << " hops from its FPC)");
+
+        Ptr<TrafficSensorApplication> app = CreateObject<TrafficSensorApplication>();
+        app->SetAttribute("ReportInterval", TimeValue(Seconds(config.reportInterval)));
+        app->SetAttribute("DutyCycle", BooleanValue(config.dutyCycle));
+        app->SetAttribute("AwakeWindow", TimeValue(Seconds(config.awakeWindow)));
+        app->SetAttribute("EmergencyRate", DoubleValue(config.emergencyRate));
+        app->SetAttribute("Padding", UintegerValue(config.reportPadding));
+        app->SetAttribute("Lanes", UintegerValue(config.lanesPerSensor));
+        app->SetAttribute("TxBacklog", UintegerValue(config.txBacklog));
+        app->Setup(&context, openSender(net.rfdNodes.Get(i)), net.SocketAddress(headOf[i], port), 512, 1000,
+                   DataRate(config.dataRate), true, true);
+        net.rfdNodes.Get(i)->AddApplication(app);
+        app->SetStartTime(Seconds(1.0 + (0.1 * (i % 100))));  // Bounded stagger for large grids
+        app->SetStopTime(Seconds(simTime));
+    }
+    return true;
+}
+
+#endif // WSN_SCENARIO_H
@@ -0,0 +1,524 @@
+// In-process WSN/SUMO co-simulation. The LR-WPAN sensor network and the
+// TraCI traffic light controller run in one ns-3 process: every reading the
+// FPC receives is pushed into a lock-free SPSC ring, and the controller
+// drains the ring on each control tick and drives SUMO directly, with no
+// sensor file in between.
+//
+// Sensors are placed from the SUMO network: one FFD cluster head at every
+// traffic-light junction and one RFD per E1 detector on its incoming lanes
+// (--detectors), or, without detectors, one RFD near the stop line of each
+// incoming lane. The FPC sits next to the first junction. By default each
+// RFD counts the vehicles on its lane in the running SUMO simulation, so the
+// lights react to the traffic they shape; --demandModel selects one of the
+// synthetic models instead.
+//
+//   ./ns3 run "scratch/wsn-sumo-cosim --sumoConfig=example.sumocfg --netFile=example.net.xml"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/lr-wpan-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/energy-module.h"
+#include "ns3/traci-module.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("WsnSumoCosim");
+
+#include "wsn-scenario.h"
+#include "wsn-checkpoint.h"
+#include "sumo-net.h"
+#include "traffic-control.h"
+
+// The SUMO junction and lane an RFD watches.
+struct SensorSite {
+    std::string junction;
+    std::string lane;
+    Vector position;
+};
+
+// Derives the WSN layout from the SUMO network. Fills sites (one per RFD,
+// in RFD order) and returns false if the network has no traffic lights.
+bool LayoutFromSumo(const SumoNet &net, double stopLineOffset, WsnLayout &layout, std::vector<SensorSite> &sites) {
+    std::map<std::string, std::vector<const SumoDetector *>> detectorsByLane;
+    for (const SumoDetector &detector : net.Detectors()) {
+        detectorsByLane[detector.lane].push_back(&detector);
+    }
+
+    for (const SumoJunction &junction : net.Junctions()) {
+        if (junction.type.find("traffic_light") == std::string::npos)
+            continue;
+        layout.ffd.push_back(Vector(junction.x, junction.y, 0.0));
+        for (const std::string &lane : junction.incLanes) {
+            std::vector<double> positions;
+            auto it = detectorsByLane.find(lane);
+            if (it != detectorsByLane.end()) {
+                for (const SumoDetector *detector : it->second) {
+                    positions.push_back(detector->pos);
+                }
+            } else if (detectorsByLane.empty()) {
+                positions.push_back(-stopLineOffset);
+            }
+            for (double pos : positions) {
+                double x, y;
+                if (net.PointOnLane(lane, pos, x, y)) {
+                    sites.push_back({junction.id, lane, Vector(x, y, 0.0)});
+                    layout.rfd.push_back(sites.back().position);
+                }
+            }
+        }
+    }
+    if (layout.ffd.empty())
+        return false;
+    layout.fpc.push_back(Vector(layout.ffd[0].x + 10.0, layout.ffd[0].y + 10.0, 0.0));
+    return true;
+}
+
+// Vehicle counts from the running SUMO simulation, so that the readings the
+// controller acts on reflect the traffic its own signal timings produce. At
+// each sample an RFD reports the vehicles on the lane it watches, and an
+// emergency when one of them has vehicle class "emergency". A lane watched
+// by several RFDs is queried once per sample time.
+class SumoLaneDemandModel : public TrafficDemandModel {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("SumoLaneDemandModel")
+            .SetParent<TrafficDemandModel>()
+            .SetGroupName("WSN");
+        return tid;
+    }
+
+    // sites are in RFD order, the first RFD having scenario index firstRfdIndex.
+    SumoLaneDemandModel(const std::vector<SensorSite> &sites, uint32_t firstRfdIndex) {
+        m_laneOf.assign(firstRfdIndex + sites.size(), std::string());
+        for (size_t i = 0; i < sites.size(); i++) {
+            m_laneOf[firstRfdIndex + i] = sites[i].lane;
+        }
+    }
+
+    // SUMO is started once the network is built; counts are 0 until then.
+    void SetClient(Ptr<TraciClient> client) { m_client = client; }
+
+    // Reads SUMO as it runs and uses no streams.
+    virtual int64_t AssignStreams(int64_t stream, uint32_t numNodes) { return 0; }
+
+    virtual uint32_t GetVehicleCount(uint32_t node, Time now, Time interval) {
+        LaneSample *sample = Sample(node, now);
+        return sample ? static_cast<uint32_t>(sample->vehicles.size()) : 0;
+    }
+
+    virtual bool SensesEmergencies() const { return true; }
+
+    virtual bool EmergencyVehicle(uint32_t node, Time now) {
+        LaneSample *sample = Sample(node, now);
+        if (!sample)
+            return false;
+        if (!sample->classesRead) {
+            for (const std::string &vehicle : sample->vehicles) {
+                if (m_client->VehicleGetVehicleClass(vehicle) == "emergency") {
+                    sample->emergency = true;
+                    break;
+                }
+            }
+            sample->classesRead = true;
+        }
+        return sample->emergency;
+    }
+
+private:
+    struct LaneSample {
+        Time at = Time::Min();
+        std::vector<std::string> vehicles;
+        bool classesRead = false;  // Vehicle classes only read when asked for an emergency
+        bool emergency = false;
+    };
+
+    LaneSample *Sample(uint32_t node, Time now) {
+        if (!m_client || node >= m_laneOf.size() || m_laneOf[node].empty())
+            return nullptr;
+        LaneSample &sample = m_samples[m_laneOf[node]];
+        if (sample.at != now) {
+            sample.at = now;
+            sample.vehicles = m_client->LaneGetLastStepVehicleIDs(m_laneOf[node]);
+            sample.classesRead = false;
+            sample.emergency = false;
+        }
+        return &sample;
+    }
+
+    Ptr<TraciClient> m_client;
+    std::vector<std::string> m_laneOf;  // Lane watched by each scenario node index, empty for FPC/FFDs
+    std::map<std::string, LaneSample> m_samples;
+};
+
+// Controller side of the co-simulation: consumes delivered readings from the
+// ring, keeps the latest reading per RFD, adds their sum per junction to the
+// junction state store each tick and runs the traffic light controller on it.
+class CosimController {
+public:
+    // `junctionState` is an empty store carrying the smoothing settings.
+    CosimController(ScenarioContext *context, const std::vector<SensorSite> &sites, uint32_t firstRfdIndex,
+                    Ptr<TraciClient> client, size_t ringCapacity, const JunctionStateStore &junctionState)
+        : m_ring(ringCapacity),
+          m_context(context),
+          m_client(client),
+          m_commands(client),
+          m_junctionState(junctionState),
+          m_readings(0),
+          m_latencySum(0.0),
+          m_latencyMax(0.0),
+          m_networkSum(0.0) {
+        context->deliveredReadings = &m_ring;
+        m_junctionOf.assign(firstRfdIndex + sites.size(), -1);
+        for (size_t i = 0; i < sites.size(); i++) {
+            m_junctionOf[firstRfdIndex + i] = m_junctionState.Intern(sites[i].junction);
+        }
+        m_laneOf.assign(m_junctionOf.size(), std::string());
+        for (size_t i = 0; i < sites.size(); i++) {
+            m_laneOf[firstRfdIndex + i] = sites[i].lane;
+        }
+        m_latest.assign(m_junctionOf.size(), {0, false});
+        m_junctionSums.assign(m_junctionState.Size(), {0, false});
+        m_emergencySensed.assign(m_junctionState.Size(), Time::Max());
+    }
+
+    // Replaces the fixed-threshold policy; the phase-timing policies get the
+    // lights' phase plans from the network and per-lane sensor counts.
+    void SetPolicy(std::unique_ptr<SignalControlPolicy> policy, const SumoNet &net) {
+        m_controller.SetPlans(net.TrafficLights());
+        m_controller.SetPolicy(std::move(policy));
+    }
+
+    // First tick one interval after `from`.
+    void Start(Time interval, Time from = Seconds(0)) {
+        m_interval = interval;
+        Simulator::Schedule(from + interval, &CosimController::Tick, this);
+    }
+
+    uint64_t Readings() const { return m_readings; }
+    double MeanLatencyMs() const { return m_readings ? 1000.0 * m_latencySum / m_readings : 0.0; }
+    double MaxLatencyMs() const { return 1000.0 * m_latencyMax; }
+    double MeanNetworkMs() const { return m_readings ? 1000.0 * m_networkSum / m_readings : 0.0; }
+    uint64_t Dropped() const { return m_ring.Dropped(); }
+    const LatencySamples &EmergencyToSwitch() const { return m_emergencyToSwitch; }
+    const TrafficLightController &Controller() const { return m_controller; }
+
+private:
+    void Tick(void) {
+        Time now = Simulator::Now();
+        DeliveredReading reading;
+        while (m_ring.Pop(reading)) {
+            uint32_t index = m_context->Index(reading.nodeId);
+            if (index >= m_junctionOf.size() || m_junctionOf[index] < 0)
+                continue;
+            m_latest[index] = {reading.count, reading.emergency};
+
+            // Sensing-to-actuation: from the RFD's reading to the control
+            // decision that uses it.
+            double latency = (now - reading.sampled).GetSeconds();
+            m_latencySum += latency;
+            m_latencyMax = std::max(m_latencyMax, latency);
+            m_networkSum += (reading.delivered - reading.sampled).GetSeconds();
+            m_readings++;
+
+            int32_t junction = m_junctionOf[index];
+            if (reading.emergency && reading.sampled < m_emergencySensed[junction])
+                m_emergencySensed[junction] = reading.sampled;
+        }
+
+        m_junctionSums.assign(m_junctionSums.size(), {0, false});
+        for (auto &lane : m_laneReadings) {
+            lane.second = LaneReading();
+        }
+        for (size_t i = 0; i < m_junctionOf.size(); i++) {
+            if (m_junctionOf[i] < 0)
+                continue;
+            TrafficData &data = m_junctionSums[m_junctionOf[i]];
+            data.vehicleCount += m_latest[i].vehicleCount;
+            data.emergency = data.emergency || m_latest[i].emergency;
+            LaneReading &lane = m_laneReadings[m_laneOf[i]];
+            lane.vehicles += m_latest[i].vehicleCount;
+            lane.emergency = lane.emergency || m_latest[i].emergency;
+        }
+        for (size_t junction = 0; junction < m_junctionSums.size(); junction++) {
+            m_junctionState.Push(junction, m_junctionSums[junction].vehicleCount, m_junctionSums[junction].emergency,
+                                 now.GetSeconds());
+        }
+        m_controller.Adjust(m_client, m_junctionState, m_commands, &m_laneReadings);
+
+        // Sensing-to-switch for emergencies: from the earliest unserved
+        // emergency reading at a junction to the tick the policy starts
+        // serving it (the emergency program, or preempting the phases).
+        for (const TrafficLightControl &tls : m_controller.Lights()) {
+            if (!tls.emergency)
+                continue;
+            for (uint32_t junction : tls.junctionIds) {
+                if (junction >= m_emergencySensed.size() || m_emergencySensed[junction] == Time::Max())
+                    continue;
+                m_emergencyToSwitch.Add(now - m_emergencySensed[junction]);
+                m_emergencySensed[junction] = Time::Max();
+            }
+        }
+
+        Simulator::Schedule(m_interval, &CosimController::Tick, this);
+    }
+
+    SpscRing<DeliveredReading> m_ring;
+    ScenarioContext *m_context;
+    Ptr<TraciClient> m_client;
+    TraciClientCommandSink m_commands;
+    TrafficLightController m_controller;
+    Time m_interval;
+
+    JunctionStateStore m_junctionState;  // Sensor junctions get IDs 0..n-1, the lights' other junctions follow
+    std::vector<int32_t> m_junctionOf;   // Junction ID of each scenario node index, -1 for FPC/FFDs
+    std::vector<TrafficData> m_junctionSums;  // This tick's readings summed per sensor junction
+    std::vector<TrafficData> m_latest;   // Latest reading per scenario node index
+    std::vector<std::string> m_laneOf;   // Lane watched by each scenario node index, empty for FPC/FFDs
+    LaneReadings m_laneReadings;         // Latest readings summed per lane
+    std::vector<Time> m_emergencySensed;  // Earliest unserved emergency per junction, Time::Max() if none
+    LatencySamples m_emergencyToSwitch;
+
+    uint64_t m_readings;
+    double m_latencySum;
+    double m_latencyMax;
+    double m_networkSum;
+};
+
+int main(int argc, char *argv[]) {
+    ScenarioConfig config;
+    config.reportInterval = 1.0;
+    config.aggregationWindow = 0.5;
+    config.demandModel = "sumo";
+    config.animation = false;
+    std::string sumoConfig = "sumo-config.xml";
+    std::string netFile = "example.net.xml";
+    std::string detectorFile;
+    double stopLineOffset = 5.0;
+    double controlInterval = 1.0;
+    std::string signalPolicy = "fixed-threshold";
+    uint32_t junctionWindow = 4;
+    std::string junctionStatistic = "mean";
+    double emergencyHold = 5.0;
+    double stepLength = 0.1;
+    bool usingGui = false;
+    uint32_t ringCapacity = 4096;
+    bool verbose = false;
+
+    CommandLine cmd;
+    cmd.AddValue("sumoConfig", "SUMO configuration file", sumoConfig);
+    cmd.AddValue("netFile", "SUMO network the sensors are placed on", netFile);
+    cmd.AddValue("detectors", "SUMO additional file with E1 detectors to place RFDs at", detectorFile);
+    cmd.AddValue("stopLineOffset", "Metres before the stop line for RFDs when no detectors are given",
+                 stopLineOffset);
+    cmd.AddValue("simTime", "Simulation time in seconds", config.simTime);
+    cmd.AddValue("controlInterval", "Seconds between traffic light control decisions", controlInterval);
+    cmd.AddValue("signalPolicy", "Traffic light policy: fixed-threshold, max-pressure or actuated", signalPolicy);
+    cmd.AddValue("junctionWindow", "Control ticks of junction readings the controller smooths over", junctionWindow);
+    cmd.AddValue("junctionStatistic", "Vehicle count the controller uses: latest, mean, max or ewma of the window",
+                 junctionStatistic);
+    cmd.AddValue("emergencyHold", "Seconds an emergency reading keeps its junction in emergency mode",
+                 emergencyHold);
+    cmd.AddValue("stepLength", "SUMO simulation step length", stepLength);
+    cmd.AddValue("gui", "Use SUMO GUI", usingGui);
+    cmd.AddValue("outputDir", "Directory for output files", config.outputDir);
+    cmd.AddValue("sensorLogFormat", "Sensor log format: binary, csv or both", config.sensorLogFormat);
+    cmd.AddValue("demandModel", "Vehicle-count model: sumo (the RFD's lane in the running simulation), or the "
+                 "synthetic uniform, poisson, diurnal or replay", config.demandModel);
+    cmd.AddValue("reportInterval", "Seconds between RFD reports", config.reportInterval);
+    cmd.AddValue("aggregationWindow", "Seconds an FFD batches child readings (0 forwards each one)",
+                 config.aggregationWindow);
+    cmd.AddValue("emergencyRate", "Synthetic emergency vehicle detections per second per RFD, on top of any "
+                 "seen in SUMO", config.emergencyRate);
+    cmd.AddValue("txBacklog", "Routine frames a node holds for its MAC before dropping the oldest (0: no limit)",
+                 config.txBacklog);
+    cmd.AddValue("reportPadding", "Filler bytes after each RFD report (512 restores the old fixed-size frames)",
+                 config.reportPadding);
+    cmd.AddValue("ringCapacity", "Readings buffered between the FPC and the controller", ringCapacity);
+    cmd.AddValue("checkpointAt", "Save WSN and SUMO state at this time in seconds (0: never)",
+                 config.checkpointAt);
+    cmd.AddValue("checkpointFile", "Checkpoint file to write (default: outputDir/checkpoint.txt); SUMO's state "
+                 "goes next to it with a .sumo.xml suffix", config.checkpointFile);
+    cmd.AddValue("restoreFrom", "Checkpoint to resume from; the scenario options must match the saved run",
+                 config.restoreFrom);
+    cmd.AddValue("verbose", "Log per-packet activity", verbose);
+    cmd.Parse(argc, argv);
+
+    if (verbose) {
+        LogComponentEnable("WsnSumoCosim", LOG_LEVEL_INFO);
+    }
+    LogComponentEnable("TraciClient", LOG_LEVEL_WARN);
+
+    SumoNet sumoNet;
+    if (!sumoNet.Load(netFile)) {
+        std::cerr << "Cannot read SUMO network " << netFile << std::endl;
+        return 1;
+    }
+    if (!detectorFile.empty() && !sumoNet.LoadDetectors(detectorFile)) {
+        std::cerr << "Cannot read detector file " << detectorFile << std::endl;
+        return 1;
+    }
+
+    WsnLayout layout;
+    std::vector<SensorSite> sites;
+    if (!LayoutFromSumo(sumoNet, stopLineOffset, layout, sites)) {
+        std::cerr << "No traffic-light junctions in " << netFile << std::endl;
+        return 1;
+    }
+    config.numFPC = layout.fpc.size();
+    config.numFFD = layout.ffd.size();
+    config.numRFD = layout.rfd.size();
+
+    ScenarioContext context;
+    Ptr<SumoLaneDemandModel> liveDemand;
+    if (config.demandModel == "sumo") {
+        liveDemand = CreateObject<SumoLaneDemandModel>(sites, config.numFPC + config.numFFD);
+        context.demand = liveDemand;
+    } else {
+        context.demand = CreateDemandModel(config.demandModel);
+    }
+    if (!context.demand) {
+        std::cerr << "Unknown demand model: " << config.demandModel << std::endl;
+        return 1;
+    }
+    WsnNetwork net;
+    if (!BuildWsnNetwork(config, layout, context, net)) {
+        Simulator::Destroy();
+        return 1;
+    }
+    std::cout << "Placed " << config.numRFD << " RFDs and " << config.numFFD << " FFDs on " << netFile
+              << (detectorFile.empty() ? " (stop-line positions)" : " (detector positions)") << std::endl;
+
+    // A restored run needs SUMO's state from the same instant; SUMO takes its
+    // clock from the state file and the TraCI client starts at that time.
+    WsnCheckpoint checkpoint;
+    if (!config.restoreFrom.empty()) {
+        if (!checkpoint.Read(config.restoreFrom) || checkpoint.sumoState.empty() ||
+            !RestoreWsnCheckpoint(checkpoint, context, net)) {
+            std::cerr << "Cannot restore " << config.restoreFrom
+                      << " (needs a co-simulation checkpoint of this scenario)" << std::endl;
+            Simulator::Destroy();
+            return 1;
+        }
+        std::cout << "Resuming from " << config.restoreFrom << " at " << checkpoint.time << " s" << std::endl;
+    }
+
+    std::unique_ptr<SignalControlPolicy> policy = CreateSignalPolicy(signalPolicy, controlInterval);
+    if (!policy) {
+        std::cerr << "Unknown signal policy: " << signalPolicy << std::endl;
+        return 1;
+    }
+    JunctionStateStore::Statistic statistic;
+    if (!JunctionStateStore::ParseStatistic(junctionStatistic, statistic)) {
+        std::cerr << "Unknown junction statistic: " << junctionStatistic << std::endl;
+        return 1;
+    }
+
+    // SUMO writes its half of a checkpoint itself (--save-state.times), since
+    // TraciClient has no call for it; the state covers the step ending at the
+    // checkpoint time.
+    bool saveCheckpoint = config.checkpointAt > checkpoint.time && config.checkpointAt < config.simTime;
+    std::string checkpointPath =
+        config.checkpointFile.empty() ? config.outputDir + "/checkpoint.txt" : config.checkpointFile;
+    std::string sumoState = checkpointPath + ".sumo.xml";
+    std::ostringstream sumoOptions;
+    if (!checkpoint.sumoState.empty())
+        sumoOptions << " --load-state " << checkpoint.sumoState;
+    if (saveCheckpoint)
+        sumoOptions << " --save-state.times " << config.checkpointAt << " --save-state.files " << sumoState;
+
+    Ptr<TraciClient> client = CreateObject<TraciClient>();
+    client->SetAttribute("SumoConfigPath", StringValue(sumoConfig));
+    client->SetAttribute("SumoBinaryPath", StringValue(usingGui ? "sumo-gui" : "sumo"));
+    client->SetAttribute("SumoWaitForConnection", BooleanValue(true));
+    client->SetAttribute("SynchInterval", TimeValue(Seconds(stepLength)));
+    client->SetAttribute("StartTime", TimeValue(Seconds(checkpoint.time)));
+    client->SetAttribute("SumoGUI", BooleanValue(usingGui));
+    if (!sumoOptions.str().empty())
+        client->SetAttribute("SumoAdditionalCmdOptions", StringValue(sumoOptions.str().substr(1)));
+    client->Init();
+    if (liveDemand)
+        liveDemand->SetClient(client);
+
+    CosimController controller(&context, sites, config.numFPC + config.numFFD, client, ringCapacity,
+                               JunctionStateStore(junctionWindow, statistic, 0.5, emergencyHold));
+    controller.SetPolicy(std::move(policy), sumoNet);
+    controller.Start(Seconds(controlInterval), Seconds(checkpoint.time));
+
+    if (saveCheckpoint &&
+        !ScheduleWsnCheckpoint(Seconds(config.checkpointAt), checkpointPath, context, net,
+                               [sumoState](WsnCheckpoint &cp) { cp.sumoState = sumoState; })) {
+        Simulator::Destroy();
+        return 1;
+    }
+
+    Simulator::Stop(Seconds(config.simTime));
+    auto wallStart = std::chrono::steady_clock::now();
+    Simulator::Run();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    Simulator::Destroy();
+    context.trafficDataLog->Close();
+    double simPerWall = (config.simTime - checkpoint.time) / std::max(wallSeconds, 1e-9);
+
+    const TrafficLightController &lights = controller.Controller();
+    std::cout << "Co-simulation: " << controller.Readings() << " readings reached the controller ("
+              << controller.Dropped() << " dropped at the ring), sensing-to-actuation latency mean "
+              << controller.MeanLatencyMs() << " ms, max " << controller.MaxLatencyMs() << " ms (network "
+              << controller.MeanNetworkMs() << " ms); " << lights.ProgramChanges() << " program changes over "
+              << lights.ControlTicks() << " ticks for " << lights.NumLights() << " lights ("
+              << lights.Policy().Name() << ", " << lights.PhaseCommands() << " phase timing commands)" << std::endl;
+    const LatencySamples &toFpc = context.emergencyToFpc;
+    const LatencySamples &toSwitch = controller.EmergencyToSwitch();
+    if (context.emergencyEvents > 0) {
+        std::cout << "Emergencies: " << context.emergencyEvents << " sensed; sensing-to-FPC p50/p99/max "
+                  << toFpc.PercentileMs(50) << "/" << toFpc.PercentileMs(99) << "/" << toFpc.MaxMs()
+                  << " ms, sensing-to-switch p50/p99/max " << toSwitch.PercentileMs(50) << "/"
+                  << toSwitch.PercentileMs(99) << "/" << toSwitch.MaxMs() << " ms" << std::endl;
+    }
+    std::cout << "Simulated " << config.simTime - checkpoint.time << " s in " << wallSeconds << " s wall-clock ("
+              << simPerWall << " sim-s/wall-s" << (usingGui ? "" : ", headless") << ")" << std::endl;
+
+    std::ofstream summary((config.outputDir + "/cosim-summary.json").c_str());
+    summary << "{\"numRFD\": " << config.numRFD
+            << ", \"numFFD\": " << config.numFFD
+            << ", \"simTime\": " << config.simTime
+            << ", \"controlInterval\": " << controlInterval
+            << ", \"signalPolicy\": \"" << signalPolicy << "\""
+            << ", \"junctionWindow\": " << junctionWindow
+            << ", \"junctionStatistic\": \"" << junctionStatistic << "\""
+            << ", \"emergencyHold\": " << emergencyHold
+            << ", \"reportInterval\": " << config.reportInterval
+            << ", \"packetsSent\": " << context.packetsSent
+            << ", \"packetsReceived\": " << context.packetsReceived
+            << ", \"readings\": " << controller.Readings()
+            << ", \"ringDrops\": " << controller.Dropped()
+            << ", \"meanSensingToActuationMs\": " << controller.MeanLatencyMs()
+            << ", \"maxSensingToActuationMs\": " << controller.MaxLatencyMs()
+            << ", \"meanNetworkMs\": " << controller.MeanNetworkMs()
+            << ", \"programChanges\": " << lights.ProgramChanges()
+            << ", \"phaseCommands\": " << lights.PhaseCommands()
+            << ", \"controlTicks\": " << lights.ControlTicks()
+            << ", \"emergencyEvents\": " << context.emergencyEvents
+            << ", \"emergencyToFpcP50Ms\": " << toFpc.PercentileMs(50)
+            << ", \"emergencyToFpcP99Ms\": " << toFpc.PercentileMs(99)
+            << ", \"emergencyToFpcMaxMs\": " << toFpc.MaxMs()
+            << ", \"emergencyToSwitchP50Ms\": " << toSwitch.PercentileMs(50)
+            << ", \"emergencyToSwitchP99Ms\": " << toSwitch.PercentileMs(99)
+            << ", \"emergencyToSwitchMaxMs\": " << toSwitch.MaxMs()
+            << ", \"wallSeconds\": " << wallSeconds
+            << ", \"simSecondsPerWallSecond\": " << simPerWall
+            << "}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,280 @@
+#ifndef WSN_TRACE_H
+#define WSN_TRACE_H
+
+// Sampled packet trace for WSN runs, a cheap stand-in for NetAnim's
+// AnimationInterface. NetAnim writes every frame as XML while the run goes
+// on, which dominates the runtime of large scenarios and produces gigabyte
+// files; this trace records only the frames picked by the sampling options,
+// as fixed-size binary records, and trace-to-netanim.py turns it into a
+// NetAnim XML file offline.
+//
+// A frame is sampled when its packet UID is a multiple of `every` and it
+// goes on air inside [start, stop). With a node subset, frames transmitted
+// by a listed node are kept along with every reception of them, and frames
+// from other nodes are kept from the moment a listed node receives one.
+// MAC retransmissions of a sampled frame are sampled again.
+//
+// Binary layout ("WSTR", version 1, host byte order):
+//
+//   file header   32 B   magic "WSTR", u16 version, u16 reserved, u32 node count, u32 every,
+//                        f64 start, f64 stop (0: end of run)
+//   node * N      24 B   u32 node ID, u8 role (0 FPC, 1 FFD, 2 RFD), 3 B padding, f32 x, f32 y,
+//                        u64 reserved
+//   event * M     24 B   f64 time, u64 transmission ID, u32 node ID, u16 PSDU bytes,
+//                        u8 kind (0 transmit start, 1 receive end), u8 reserved
+//
+// Events are appended in whole blocks, so a file that is still being written
+// (or was cut short) reads up to its last whole record. They are mostly in
+// time order, but not strictly: with a node subset, the transmit event of a
+// frame from an unlisted node is written when a listed node receives it and
+// keeps its earlier start time. What always holds is that a transmission ID
+// names one sampled transmission and its receive events follow its transmit
+// event, which is all a reader may rely on.
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/lr-wpan-module.h"
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace ns3;
+
+namespace wsntrace {
+
+constexpr uint32_t kFileMagic = 0x52545357;  // "WSTR"
+constexpr uint16_t kVersion = 1;
+constexpr uint32_t kRecordSize = 24;
+constexpr uint32_t kBlockRecords = 2048;
+constexpr uint8_t kTransmit = 0;
+constexpr uint8_t kReceive = 1;
+
+// 2.4 GHz O-QPSK airtime of a PSDU, synchronisation header and PHR included.
+inline double AirtimeSeconds(uint32_t psduBytes) { return (psduBytes + 6) * 32e-6; }
+
+// Reads a decimal node ID at p and moves p past it.
+inline bool ParseId(const char *&p, unsigned long &id) {
+    if (!std::isdigit(static_cast<unsigned char>(*p)))
+        return false;
+    char *end;
+    id = std::strtoul(p, &end, 10);
+    p = end;
+    return true;
+}
+
+} // namespace wsntrace
+
+struct WsnTraceOptions {
+    uint32_t every = 1;          // Sample frames whose packet UID is a multiple of this
+    double start = 0.0;          // Seconds; frames going on air earlier are skipped
+    double stop = 0.0;           // Seconds; 0 traces to the end of the run
+    std::vector<bool> nodes;     // By node ID; empty traces every node
+
+    // Parses "3,7,10-19" into the node subset. Returns false on malformed input.
+    bool ParseNodes(const std::string &list) {
+        nodes.clear();
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t end = list.find(',', pos);
+            if (end == std::string::npos)
+                end = list.size();
+            std::string item = list.substr(pos, end - pos);
+            pos = end + 1;
+            if (item.empty())
+                continue;
+            const char *p = item.c_str();
+            unsigned long first, last;
+            if (!wsntrace::ParseId(p, first))
+                return false;
+            last = first;
+            if (*p == '-' && !wsntrace::ParseId(++p, last))
+                return false;
+            if (*p != '\0' || last < first || last > 0xffffff)
+                return false;
+            if (nodes.size() <= last)
+                nodes.resize(last + 1, false);
+            for (unsigned long id = first; id <= last; id++)
+                nodes[id] = true;
+        }
+        return true;
+    }
+};
+
+class WsnPacketTrace {
+public:
+    explicit WsnPacketTrace(const WsnTraceOptions &options)
+        : m_options(options), m_nextId(0), m_events(0), m_offset(0) {
+        if (m_options.every == 0)
+            m_options.every = 1;
+    }
+    ~WsnPacketTrace() { Close(); }
+
+    WsnPacketTrace(const WsnPacketTrace &) = delete;
+    WsnPacketTrace &operator=(const WsnPacketTrace &) = delete;
+
+    // Adds a node to the node table and hooks its radio; call for every node
+    // before Open().
+    void Attach(Ptr<Node> node, uint8_t role, Ptr<lrwpan::LrWpanNetDevice> dev) {
+        uint8_t entry[wsntrace::kRecordSize] = {};
+        uint32_t id = node->GetId();
+        Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
+        Vector position = mobility ? mobility->GetPosition() : Vector();
+        float x = static_cast<float>(position.x);
+        float y = static_cast<float>(position.y);
+        std::memcpy(entry, &id, 4);
+        entry[4] = role;
+        std::memcpy(entry + 8, &x, 4);
+        std::memcpy(entry + 12, &y, 4);
+        m_nodeTable.insert(m_nodeTable.end(), entry, entry + sizeof(entry));
+
+        if (!dev)
+            return;
+        Ptr<lrwpan::LrWpanPhy> phy = dev->GetPhy();
+        phy->TraceConnectWithoutContext("PhyTxBegin", MakeCallback(&WsnPacketTrace::TxBegin, this).Bind(id));
+        phy->TraceConnectWithoutContext("PhyRxEnd", MakeCallback(&WsnPacketTrace::RxEnd, this).Bind(id));
+    }
+
+    // Writes the header and node table; events are recorded from here on.
+    bool Open(const std::string &path) {
+        m_file.open(path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!m_file.is_open())
+            return false;
+
+        uint8_t header[32] = {};
+        uint32_t nodeCount = static_cast<uint32_t>(m_nodeTable.size() / wsntrace::kRecordSize);
+        std::memcpy(header, &wsntrace::kFileMagic, 4);
+        std::memcpy(header + 4, &wsntrace::kVersion, 2);
+        std::memcpy(header + 8, &nodeCount, 4);
+        std::memcpy(header + 12, &m_options.every, 4);
+        std::memcpy(header + 16, &m_options.start, 8);
+        std::memcpy(header + 24, &m_options.stop, 8);
+        Write(header, sizeof(header));
+        Write(m_nodeTable.data(), m_nodeTable.size());
+        m_file.flush();
+        m_nodeTable.clear();
+        m_block.reserve(wsntrace::kBlockRecords * wsntrace::kRecordSize);
+        return true;
+    }
+
+    void Close() {
+        if (!m_file.is_open())
+            return;
+        WriteBlock();
+        m_file.close();
+    }
+
+    uint64_t Events() const { return m_events; }
+    uint64_t Bytes() const { return m_offset + m_block.size(); }
+
+private:
+    // A sampled transmission still on air. Its transmit event is written at
+    // once, or when the first listed node receives it.
+    struct InFlight {
+        uint64_t id;
+        double start;
+        uint32_t node;
+        uint16_t bytes;
+        bool written;
+    };
+    struct Expiry {
+        double until;  // Last possible reception
+        uint64_t uid;
+        uint64_t id;
+    };
+
+    bool Listed(uint32_t node) const {
+        return m_options.nodes.empty() || (node < m_options.nodes.size() && m_options.nodes[node]);
+    }
+
+    void TxBegin(uint32_t node, Ptr<const Packet> p) {
+        if (!m_file.is_open() || p->GetUid() % m_options.every != 0)
+            return;
+        double now = Simulator::Now().GetSeconds();
+        if (now < m_options.start || (m_options.stop > 0 && now >= m_options.stop))
+            return;
+
+        // No reception ends later than a frame's last bit plus propagation,
+        // so transmissions whose window has passed are forgotten. A MAC
+        // retransmission reuses the packet UID; an expiry only removes the
+        // entry if it still belongs to the transmission that queued it.
+        while (!m_expiry.empty() && m_expiry.front().until < now) {
+            auto it = m_inFlight.find(m_expiry.front().uid);
+            if (it != m_inFlight.end() && it->second.id == m_expiry.front().id)
+                m_inFlight.erase(it);
+            m_expiry.pop_front();
+        }
+
+        uint32_t size = p->GetSize();
+        InFlight &f = m_inFlight[p->GetUid()];
+        f.id = m_nextId++;
+        f.start = now;
+        f.node = node;
+        f.bytes = static_cast<uint16_t>(size > 0xffff ? 0xffff : size);
+        f.written = Listed(node);
+        if (f.written)
+            Append(now, f.id, node, f.bytes, wsntrace::kTransmit);
+        m_expiry.push_back({now + wsntrace::AirtimeSeconds(size) + 0.001, p->GetUid(), f.id});
+    }
+
+    void RxEnd(uint32_t node, Ptr<const Packet> p, double) {
+        if (!m_file.is_open() || p->GetUid() % m_options.every != 0)
+            return;
+        auto it = m_inFlight.find(p->GetUid());
+        if (it == m_inFlight.end())
+            return;
+        InFlight &f = it->second;
+        if (!f.written) {
+            if (!Listed(node))
+                return;
+            Append(f.start, f.id, f.node, f.bytes, wsntrace::kTransmit);
+            f.written = true;
+        }
+        Append(Simulator::Now().GetSeconds(), f.id, node, f.bytes, wsntrace::kReceive);
+    }
+
+    void Append(double time, uint64_t id, uint32_t node, uint16_t bytes, uint8_t kind) {
+        size_t at = m_block.size();
+        m_block.resize(at + wsntrace::kRecordSize, 0);
+        uint8_t *r = m_block.data() + at;
+        std::memcpy(r, &time, 8);
+        std::memcpy(r + 8, &id, 8);
+        std::memcpy(r + 16, &node, 4);
+        std::memcpy(r + 20, &bytes, 2);
+        r[22] = kind;
+        m_events++;
+        if (m_block.size() >= wsntrace::kBlockRecords * wsntrace::kRecordSize)
+            WriteBlock();
+    }
+
+    void WriteBlock() {
+        if (m_block.empty())
+            return;
+        Write(m_block.data(), m_block.size());
+        m_file.flush();
+        m_block.clear();
+    }
+
+    void Write(const void *data, size_t size) {
+        m_file.write(static_cast<const char *>(data), size);
+        m_offset += size;
+    }
+
+    WsnTraceOptions m_options;
+    std::ofstream m_file;
+    std::vector<uint8_t> m_nodeTable;  // Node records until Open()
+    std::vector<uint8_t> m_block;      // Events not yet written
+    std::unordered_map<uint64_t, InFlight> m_inFlight;  // By packet UID
+    std::deque<Expiry> m_expiry;                        // In send order
+    uint64_t m_nextId;
+    uint64_t m_events;
+    uint64_t m_offset;
+};
+
+#endif // WSN_TRACE_H
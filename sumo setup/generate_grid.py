@@ -0,0 +1,303 @@
+#!/usr/bin/env python3
+
+# Scenario generator for many-junction networks.
+#
+# Builds (or reads) an N x M grid of traffic-light junctions, runs netconvert
+# on it and writes everything a city-scale run needs:
+#
+#   <prefix>.nod.xml / .edg.xml   plain network input handed to netconvert
+#   <prefix>.net.xml              netconvert output
+#   <prefix>.tll.xml              normal / heavy_traffic / light_traffic /
+#                                 emergency programs for every traffic light
+#   <prefix>.rou.xml              flows between opposite fringe edges
+#   <prefix>.sumocfg              SUMO configuration tying them together
+#   sensor_map.csv                WSN placement and junction <-> sensor mapping:
+#                                 one RFD per approach lane, one FFD per
+#                                 junction, one FPC per district
+#
+# sensor_map.csv feeds wsn-implementation --topologyFile and
+# sumo-ns3-integration --sensorMap. NodeID is the node's index in the WSN
+# scenario (FPCs first, then FFDs, then RFDs), which is also the ID written
+# to the sensor log.
+#
+#   ./generate_grid.py --rows 32 --cols 32 --output-dir city     # 1024 junctions
+#   ./generate_grid.py --nodes nodes.xml --edges edges.xml --output-dir example
+
+import argparse
+import csv
+import math
+import os
+import random
+import shutil
+import subprocess
+import sys
+import xml.etree.ElementTree as ET
+
+LANE_WIDTH = 3.2
+
+PROGRAMS = {
+    # programID: (green scale, minimum green, maximum green). SUMO starts a
+    # light on the last program loaded, so 'normal' comes last.
+    'heavy_traffic': (1.5, 5, None),
+    'light_traffic': (0.5, 5, None),
+    'emergency': (1.0, 5, 10),  # Short cycle so every approach is served quickly
+    'normal': (1.0, 5, None),
+}
+
+
+def generate_grid(rows, cols, spacing, lanes, speed):
+    """Returns (nodes, edges) for a rows x cols grid of traffic lights with a
+    ring of priority fringe nodes where vehicles enter and leave."""
+    nodes = {}
+    edges = []
+    for r in range(rows):
+        for c in range(cols):
+            nodes[f'J{r}_{c}'] = (c * spacing, r * spacing, 'traffic_light')
+    fringe = []
+    for c in range(cols):
+        fringe.append((f'F_S{c}', c * spacing, -spacing, f'J0_{c}'))
+        fringe.append((f'F_N{c}', c * spacing, rows * spacing, f'J{rows - 1}_{c}'))
+    for r in range(rows):
+        fringe.append((f'F_W{r}', -spacing, r * spacing, f'J{r}_0'))
+        fringe.append((f'F_E{r}', cols * spacing, r * spacing, f'J{r}_{cols - 1}'))
+    for node_id, x, y, _ in fringe:
+        nodes[node_id] = (x, y, 'priority')
+
+    def link(a, b):
+        edges.append((f'{a}_to_{b}', a, b, lanes, speed))
+        edges.append((f'{b}_to_{a}', b, a, lanes, speed))
+
+    for r in range(rows):
+        for c in range(cols):
+            if c + 1 < cols:
+                link(f'J{r}_{c}', f'J{r}_{c + 1}')
+            if r + 1 < rows:
+                link(f'J{r}_{c}', f'J{r + 1}_{c}')
+    for node_id, _, _, junction in fringe:
+        link(node_id, junction)
+    return nodes, edges
+
+
+def read_plain_network(nodes_file, edges_file, default_lanes, default_speed):
+    nodes = {}
+    for node in ET.parse(nodes_file).getroot().iter('node'):
+        nodes[node.get('id')] = (float(node.get('x')), float(node.get('y')), node.get('type', 'priority'))
+    edges = []
+    for edge in ET.parse(edges_file).getroot().iter('edge'):
+        edges.append((edge.get('id'), edge.get('from'), edge.get('to'),
+                      int(edge.get('numLanes', default_lanes)), float(edge.get('speed', default_speed))))
+    return nodes, edges
+
+
+def write_plain_network(nodes, edges, nodes_path, edges_path):
+    with open(nodes_path, 'w') as f:
+        f.write('<?xml version="1.0" encoding="UTF-8"?>\n<nodes>\n')
+        for node_id, (x, y, node_type) in nodes.items():
+            f.write(f'    <node id="{node_id}" x="{x:.2f}" y="{y:.2f}" type="{node_type}"/>\n')
+        f.write('</nodes>\n')
+    with open(edges_path, 'w') as f:
+        f.write('<?xml version="1.0" encoding="UTF-8"?>\n<edges>\n')
+        for edge_id, src, dst, lanes, speed in edges:
+            f.write(f'    <edge id="{edge_id}" from="{src}" to="{dst}" numLanes="{lanes}" speed="{speed}"/>\n')
+        f.write('</edges>\n')
+
+
+def run_netconvert(nodes_path, edges_path, net_path):
+    netconvert = shutil.which('netconvert')
+    if netconvert is None:
+        return False
+    subprocess.run([netconvert, '--node-files', nodes_path, '--edge-files', edges_path,
+                    '--output-file', net_path, '--no-turnarounds', 'true',
+                    '--tls.default-type', 'static', '--offset.disable-normalization', 'true'],
+                   check=True, stdout=subprocess.DEVNULL)
+    return True
+
+
+def read_net(net_path):
+    """Returns (lane shapes by ID, tlLogic phases by TLS ID) from a .net.xml,
+    streaming so city-scale networks stay cheap to read."""
+    lanes = {}
+    tls = {}
+    current_tls = None
+    for event, elem in ET.iterparse(net_path, events=('start', 'end')):
+        if event == 'start':
+            if elem.tag == 'tlLogic' and elem.get('programID') == '0':
+                current_tls = elem.get('id')
+                tls[current_tls] = []
+            continue
+        if elem.tag == 'lane' and not elem.get('id', ':').startswith(':'):
+            lanes[elem.get('id')] = [tuple(map(float, p.split(','))) for p in elem.get('shape', '').split()]
+        elif elem.tag == 'phase' and current_tls is not None:
+            tls[current_tls].append((float(elem.get('duration')), elem.get('state')))
+        elif elem.tag == 'tlLogic':
+            current_tls = None
+        if elem.tag in ('edge', 'tlLogic', 'junction', 'connection'):
+            elem.clear()
+    return lanes, tls
+
+
+def stop_line_point(shape, offset):
+    """Point offset metres before the end of a lane polyline."""
+    (x0, y0), (x1, y1) = shape[-2], shape[-1]
+    length = math.hypot(x1 - x0, y1 - y0)
+    f = max(0.0, 1.0 - offset / length) if length > 0 else 1.0
+    return x0 + f * (x1 - x0), y0 + f * (y1 - y0)
+
+
+def approach_lane_point(nodes, src, dst, lanes, index, offset):
+    """Estimated stop-line point of lane index of edge src -> dst, used when
+    no .net.xml is available: right-hand traffic, lanes spread right of the
+    centre line, stop line lanes * LANE_WIDTH + 4 m from the junction centre."""
+    sx, sy, _ = nodes[src]
+    dx, dy, _ = nodes[dst]
+    length = math.hypot(dx - sx, dy - sy) or 1.0
+    ux, uy = (dx - sx) / length, (dy - sy) / length   # Direction of travel
+    rx, ry = uy, -ux                                   # Right of travel
+    lateral = (lanes - index - 0.5) * LANE_WIDTH
+    back = lanes * LANE_WIDTH + 4.0 + offset
+    return dx - ux * back + rx * lateral, dy - uy * back + ry * lateral
+
+
+def write_tls_programs(tls, path):
+    with open(path, 'w') as f:
+        f.write('<?xml version="1.0" encoding="UTF-8"?>\n<additional>\n')
+        for tls_id, phases in tls.items():
+            for program, (scale, min_green, max_green) in PROGRAMS.items():
+                f.write(f'    <tlLogic id="{tls_id}" type="static" programID="{program}" offset="0">\n')
+                for duration, state in phases:
+                    if 'G' in state or 'g' in state:
+                        duration = max(min_green, round(duration * scale))
+                        if max_green is not None:
+                            duration = min(duration, max_green)
+                    f.write(f'        <phase duration="{duration:g}" state="{state}"/>\n')
+                f.write('    </tlLogic>\n')
+        f.write('</additional>\n')
+
+
+def write_routes(nodes, edges, path, vehicles_per_hour, end, rng):
+    fringe = {n for n, (_, _, t) in nodes.items() if t != 'traffic_light'}
+    entries = [e for e in edges if e[1] in fringe]
+    exits = [e for e in edges if e[2] in fringe]
+    with open(path, 'w') as f:
+        f.write('<?xml version="1.0" encoding="UTF-8"?>\n<routes>\n')
+        f.write('    <vType id="car" accel="2.6" decel="4.5" sigma="0.5" length="5" minGap="2.5" '
+                'maxSpeed="55.56" guiShape="passenger"/>\n')
+        for i, entry in enumerate(entries):
+            ex, ey, _ = nodes[entry[1]]
+            # Leave by the fringe edge farthest from the entry, so flows cross the grid.
+            target = max(exits, key=lambda e: math.hypot(nodes[e[2]][0] - ex, nodes[e[2]][1] - ey)
+                         + rng.random())
+            f.write(f'    <flow id="f{i}" type="car" from="{entry[0]}" to="{target[0]}" begin="0" '
+                    f'end="{end}" vehsPerHour="{vehicles_per_hour}" departLane="best"/>\n')
+        f.write('</routes>\n')
+
+
+def write_sumocfg(path, prefix, end):
+    with open(path, 'w') as f:
+        f.write(f'''<?xml version="1.0" encoding="UTF-8"?>
+<configuration>
+    <input>
+        <net-file value="{prefix}.net.xml"/>
+        <route-files value="{prefix}.rou.xml"/>
+        <additional-files value="{prefix}.tll.xml"/>
+    </input>
+    <time>
+        <begin value="0"/>
+        <end value="{end}"/>
+        <step-length value="0.1"/>
+    </time>
+</configuration>
+''')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate a many-junction SUMO network and matching WSN layout')
+    parser.add_argument('--rows', type=int, default=4, help='Junction rows of a generated grid')
+    parser.add_argument('--cols', type=int, default=4, help='Junction columns of a generated grid')
+    parser.add_argument('--spacing', type=float, default=200.0, help='Metres between neighbouring junctions')
+    parser.add_argument('--lanes', type=int, default=2, help='Lanes per direction')
+    parser.add_argument('--speed', type=float, default=13.89, help='Lane speed limit in m/s')
+    parser.add_argument('--nodes', help='Use this nodes.xml instead of generating a grid (needs --edges)')
+    parser.add_argument('--edges', help='edges.xml to go with --nodes')
+    parser.add_argument('--district-size', type=int, default=4,
+                        help='Junctions per district side; each district gets one FPC')
+    parser.add_argument('--rfd-offset', type=float, default=5.0, help='Metres between RFD and stop line')
+    parser.add_argument('--vehicles-per-hour', type=float, default=300.0, help='Flow per fringe entry')
+    parser.add_argument('--end', type=float, default=3600.0, help='Simulation end time in seconds')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--prefix', default='grid', help='File name prefix for the SUMO files')
+    parser.add_argument('--output-dir', default='.', help='Directory for all generated files')
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    os.makedirs(args.output_dir, exist_ok=True)
+    out = lambda name: os.path.join(args.output_dir, name)
+
+    if args.nodes:
+        if not args.edges:
+            parser.error('--nodes needs --edges')
+        nodes, edges = read_plain_network(args.nodes, args.edges, args.lanes, args.speed)
+    else:
+        nodes, edges = generate_grid(args.rows, args.cols, args.spacing, args.lanes, args.speed)
+    nodes_path, edges_path = out(f'{args.prefix}.nod.xml'), out(f'{args.prefix}.edg.xml')
+    write_plain_network(nodes, edges, nodes_path, edges_path)
+
+    net_path = out(f'{args.prefix}.net.xml')
+    lanes, tls = {}, {}
+    if run_netconvert(nodes_path, edges_path, net_path):
+        lanes, tls = read_net(net_path)
+        write_tls_programs(tls, out(f'{args.prefix}.tll.xml'))
+    else:
+        print('netconvert not found: skipping .net.xml and TLS programs, RFD positions are estimated',
+              file=sys.stderr)
+    write_routes(nodes, edges, out(f'{args.prefix}.rou.xml'), args.vehicles_per_hour, args.end, rng)
+    write_sumocfg(out(f'{args.prefix}.sumocfg'), args.prefix, args.end)
+
+    # WSN layout. Districts are square blocks of district_size x district_size
+    # junction spacings; the FPC sits at the centroid of its district's junctions.
+    junctions = sorted(n for n, (_, _, t) in nodes.items() if t == 'traffic_light')
+    cell = args.district_size * args.spacing
+    minx = min(nodes[j][0] for j in junctions)
+    miny = min(nodes[j][1] for j in junctions)
+    district_of = {j: (int((nodes[j][0] - minx) // cell), int((nodes[j][1] - miny) // cell)) for j in junctions}
+    districts = sorted(set(district_of.values()))
+    district_index = {d: i for i, d in enumerate(districts)}
+
+    rows = []
+    for d in districts:
+        members = [j for j in junctions if district_of[j] == d]
+        cx = sum(nodes[j][0] for j in members) / len(members)
+        cy = sum(nodes[j][1] for j in members) / len(members)
+        rows.append(['FPC', cx + 10.0, cy + 10.0, -1, '', ''])  # Beside, not on, a junction
+    ffd_base = len(rows)
+    ffd_of = {}
+    for j in junctions:
+        ffd_of[j] = len(rows)
+        rows.append(['FFD', nodes[j][0], nodes[j][1], district_index[district_of[j]], j, ''])
+    incoming = {}
+    for edge_id, src, dst, lane_count, _ in edges:
+        incoming.setdefault(dst, []).append((edge_id, src, lane_count))
+    for j in junctions:
+        for edge_id, src, lane_count in incoming.get(j, []):
+            for i in range(lane_count):
+                lane_id = f'{edge_id}_{i}'
+                if lane_id in lanes and len(lanes[lane_id]) >= 2:
+                    x, y = stop_line_point(lanes[lane_id], args.rfd_offset)
+                else:
+                    x, y = approach_lane_point(nodes, src, j, lane_count, i, args.rfd_offset)
+                rows.append(['RFD', x, y, ffd_of[j] - ffd_base, j, lane_id])
+
+    with open(out('sensor_map.csv'), 'w', newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(['NodeID', 'Role', 'X', 'Y', 'Parent', 'Junction', 'Lane'])
+        for node_id, (role, x, y, parent, junction, lane) in enumerate(rows):
+            writer.writerow([node_id, role, f'{x:.2f}', f'{y:.2f}', parent, junction, lane])
+
+    num_rfd = sum(1 for r in rows if r[0] == 'RFD')
+    print(f'{len(junctions)} traffic-light junctions, {len(edges)} edges; WSN: {len(districts)} FPC, '
+          f'{len(junctions)} FFD, {num_rfd} RFD written to {out("sensor_map.csv")}')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
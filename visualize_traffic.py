@@ -6,9 +6,44 @@ import time
 import traci
 import subprocess
 import csv
+import mmap
+import struct
+
+def iter_sensor_log_chunks(file_path):
+    """Yield (time, node_id, vehicle_count, emergency) columns for each chunk of
+    a binary sensor log (see sensor-log.h). The columns are memoryviews into an
+    mmap of the file, so no row data is copied up front."""
+    with open(file_path, 'rb') as f:
+        buf = memoryview(mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ))
+    offset = 16  # File header
+    while offset + 24 <= len(buf):
+        magic, rows = struct.unpack_from('<4sI', buf, offset)
+        if magic != b'TSCK':
+            break  # Index/footer
+        size = (24 + rows * 15 + 7) & ~7
+        if offset + size > len(buf):
+            break  # Chunk still being written
+        base = offset + 24
+        yield (buf[base:base + rows * 8].cast('d'),
+               buf[base + rows * 8:base + rows * 12].cast('I'),
+               buf[base + rows * 12:base + rows * 14].cast('H'),
+               buf[base + rows * 14:base + rows * 15])
+        offset += size
+
+def is_binary_sensor_log(file_path):
+    with open(file_path, 'rb') as f:
+        return f.read(4) == b'TSLG'
 
 def read_traffic_data(file_path):
     data = {}
+    if is_binary_sensor_log(file_path):
+        for times, node_ids, counts, emergencies in iter_sensor_log_chunks(file_path):
+            for time_stamp, node_id, count, emergency in zip(times, node_ids, counts, emergencies):
+                if time_stamp not in data:
+                    data[time_stamp] = {}
+                data[time_stamp][f'J{node_id}'] = count
+        return data
+
     with open(file_path, 'r') as f:
         next(f)  # Skip header
         for line in f:
@@ -23,7 +58,7 @@ def read_traffic_data(file_path):
     return data
 
 def main():
-    traffic_data_file = "/home/vijay/TS&A/traffic_sensor_data.csv"
+    traffic_data_file = "/home/vijay/TS&A/traffic_sensor_data.tslog"
     sumo_config = "/home/vijay/TS&A/sumo setup/example.sumocfg"
     
     # Start SUMO with GUI